@@ -29,10 +29,16 @@
 #include <QDateTime>
 #include <QDebug>
 #include <QMenu>
+#include <QStandardPaths>
+#include <QFile>
+#include <QLoggingCategory>
+#include <QTextStream>
 
 #include "ensembleinfodialog.h"
 #include "ui_ensembleinfodialog.h"
 
+Q_DECLARE_LOGGING_CATEGORY(application)
+
 EnsembleInfoDialog::EnsembleInfoDialog(QWidget *parent) :
     QDialog(parent),
     ui(new Ui::EnsembleInfoDialog)
@@ -49,15 +55,19 @@ EnsembleInfoDialog::EnsembleInfoDialog(QWidget *parent) :
     clearServiceInfo();
     resetFibStat();
     resetMscStat();
+    resetInputTelemetry();
 
     // 16x '_' (max label size is 16 characters)
     int minWidth = 1.7 * ui->service->fontMetrics().boundingRect("________________").width();
     ui->FIBframe->setMinimumWidth(minWidth);
     ui->serviceFrame->setMinimumWidth(minWidth);
     ui->signalFrame->setMinimumWidth(minWidth);
+    ui->inputFrame->setMinimumWidth(minWidth);
 
     ui->FIBframe->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(ui->FIBframe, &QWidget::customContextMenuRequested, this, &EnsembleInfoDialog::fibFrameContextMenu);
+    ui->inputFrame->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(ui->inputFrame, &QWidget::customContextMenuRequested, this, &EnsembleInfoDialog::inputFrameContextMenu);
 
     // set tooltips
     ui->freqLabel->setToolTip(tr("Tuned frequency"));
@@ -97,6 +107,16 @@ EnsembleInfoDialog::EnsembleInfoDialog(QWidget *parent) :
     ui->crcErrRateLabel->setToolTip(tr("Audio frame (AU for DAB+) error rate"));
     ui->crcErrRate->setToolTip(tr("Audio frame (AU for DAB+) error rate"));
 
+    ui->fifoLevelLabel->setToolTip(tr("Input buffer level min/avg/max in last second<br>(high level means that processing is too slow)"));
+    ui->inputWaitLabel->setToolTip(tr("Time spent by processing waiting for input samples in last second<br>(low value means that CPU is close to its limit)"));
+    ui->inputWait->setToolTip(ui->inputWaitLabel->toolTip());
+    ui->inputDroppedLabel->setToolTip(tr("Input data dropped because input buffer was full<br>and number of input device overflows (since reset)"));
+    ui->inputDropped->setToolTip(ui->inputDroppedLabel->toolTip());
+    ui->callbackLabel->setToolTip(tr("Input device data processing time avg/max in last second"));
+    ui->callback->setToolTip(ui->callbackLabel->toolTip());
+    ui->callbackGapLabel->setToolTip(tr("Time between input device data blocks avg/max in last second"));
+    ui->callbackGap->setToolTip(ui->callbackGapLabel->toolTip());
+
     ui->recordButton->setToolTip(tr("Record raw IQ stream to file"));
 
     enableRecording(false);
@@ -142,6 +162,7 @@ void EnsembleInfoDialog::refreshEnsembleConfiguration(const QString & txt)
 
 void EnsembleInfoDialog::updateSnr(uint8_t, float snr)
 {
+    m_snr = snr;
     ui->snr->setText(QString("%1 dB").arg(snr, 0, 'f', 1));
 }
 
@@ -154,7 +175,9 @@ void EnsembleInfoDialog::enableRecording(bool ena)
 {
     ui->recordButton->setVisible(ena);
     ui->dumpSize->setText("");
+    ui->dumpSize->setToolTip("");
     ui->dumpLength->setText("");
+    m_recordingDroppedBytes = 0;
     showRecordingStat(false);
     if (!ena)
     {
@@ -198,12 +221,27 @@ void EnsembleInfoDialog::onRecording(bool isActive)
 
 void EnsembleInfoDialog::updateRecordingStatus(uint64_t bytes, float ms)
 {
-    ui->dumpSize->setText(QString::number(double(bytes/(1024*1024.0)),'f', 1) + " MB");
+    QString size = QString::number(double(bytes/(1024*1024.0)),'f', 1) + " MB";
+    if (m_recordingDroppedBytes > 0)
+    {   // disk is too slow
+        size += " (" + tr("dropped") + " " + QString::number(double(m_recordingDroppedBytes/(1024*1024.0)),'f', 1) + " MB)";
+    }
+    ui->dumpSize->setText(size);
     ui->dumpLength->setText(QString::number(double(ms * 0.001),'f', 1) + tr(" sec"));
 }
 
+void EnsembleInfoDialog::updateRecordingDropped(uint64_t bytes)
+{
+    m_recordingDroppedBytes = bytes;
+    if (bytes > 0)
+    {
+        ui->dumpSize->setToolTip(tr("Disk writing was too slow, part of the data was not recorded"));
+    }
+}
+
 void EnsembleInfoDialog::updateAgcGain(float gain)
 {
+    m_agcGain = gain;
     if (std::isnan(gain))
     {   // gain is not available (input device in HW mode)
         ui->agcGain->setText(tr("N/A"));
@@ -252,6 +290,91 @@ void EnsembleInfoDialog::resetMscStat()
     ui->crcErrRate->setText(tr("N/A"));
 }
 
+void EnsembleInfoDialog::updateInputTelemetry(const InputTelemetryData & data)
+{
+    m_inputDroppedBytes += data.droppedBytes;
+    m_inputDeviceOverflows += data.deviceOverflows;
+
+    if (m_telemetryLog.size() >= ENSEMBLEINFODIALOG_TELEMETRY_LOG_LEN)
+    {
+        m_telemetryLog.removeFirst();
+    }
+    m_telemetryLog.append({ QDateTime::currentDateTime(), data, m_snr, m_agcGain });
+
+    if (!isVisible())
+    {
+        return;
+    }
+
+    if (data.numReads > 0)
+    {
+        ui->fifoLevel->setText(QString("%1/%2/%3 %").arg(double(data.fifoLevelMin), 0, 'f', 0)
+                                                     .arg(double(data.fifoLevelAvg), 0, 'f', 0)
+                                                     .arg(double(data.fifoLevelMax), 0, 'f', 0));
+        QString histogram = tr("Input buffer level histogram:");
+        for (int n = 0; n < INPUTTELEMETRY_HISTOGRAM_BINS; ++n)
+        {
+            histogram += QString("<br>%1-%2 %: %3 %").arg(n * 100 / INPUTTELEMETRY_HISTOGRAM_BINS)
+                                                       .arg((n + 1) * 100 / INPUTTELEMETRY_HISTOGRAM_BINS)
+                                                       .arg(100.0 * data.fifoLevelHistogram[n] / data.numReads, 0, 'f', 1);
+        }
+        ui->fifoLevel->setToolTip(histogram);
+    }
+    else
+    {
+        ui->fifoLevel->setText(tr("N/A"));
+        ui->fifoLevel->setToolTip("");
+    }
+
+    if (data.intervalMs > 0)
+    {
+        ui->inputWait->setText(QString("%1 %").arg(100.0 * data.consumerWaitMs / data.intervalMs, 0, 'f', 1));
+    }
+    else
+    {
+        ui->inputWait->setText(tr("N/A"));
+    }
+
+    QString dropped = QString::number(double(m_inputDroppedBytes/1024.0),'f', 1) + " kB";
+    if (m_inputDeviceOverflows > 0)
+    {
+        dropped += QString(" (%1)").arg(m_inputDeviceOverflows);
+    }
+    ui->inputDropped->setText(dropped);
+
+    if (data.numCallbacks > 0)
+    {
+        ui->callback->setText(QString("%1/%2 µs").arg(double(data.callbackAvgUs), 0, 'f', 0)
+                                                   .arg(double(data.callbackMaxUs), 0, 'f', 0));
+    }
+    else
+    {
+        ui->callback->setText(tr("N/A"));
+    }
+    if (!std::isnan(data.callbackGapAvgMs))
+    {
+        ui->callbackGap->setText(QString("%1/%2 ms").arg(double(data.callbackGapAvgMs), 0, 'f', 1)
+                                                     .arg(double(data.callbackGapMaxMs), 0, 'f', 1));
+    }
+    else
+    {
+        ui->callbackGap->setText(tr("N/A"));
+    }
+}
+
+void EnsembleInfoDialog::resetInputTelemetry()
+{
+    m_inputDroppedBytes = 0;
+    m_inputDeviceOverflows = 0;
+    m_telemetryLog.clear();
+    ui->fifoLevel->setText(tr("N/A"));
+    ui->fifoLevel->setToolTip("");
+    ui->inputWait->setText(tr("N/A"));
+    ui->inputDropped->setText("0.0 kB");
+    ui->callback->setText(tr("N/A"));
+    ui->callbackGap->setText(tr("N/A"));
+}
+
 void EnsembleInfoDialog::newFrequency(quint32 f)
 {
     m_frequency = f;
@@ -336,6 +459,80 @@ void EnsembleInfoDialog::fibFrameContextMenu(const QPoint& pos)
     }
 }
 
+void EnsembleInfoDialog::inputFrameContextMenu(const QPoint& pos)
+{
+    QPoint globalPos = ui->inputFrame->mapToGlobal(pos);
+    QMenu menu(this);
+    QAction * resetAction = menu.addAction(tr("Reset statistics"));
+    QAction * exportAction = menu.addAction(tr("Export statistics..."));
+    exportAction->setEnabled(!m_telemetryLog.isEmpty());
+    QAction * selectedItem = menu.exec(globalPos);
+    if (nullptr == selectedItem)
+    {  // nothing was chosen
+       return;
+    }
+
+    if (selectedItem == resetAction)
+    {
+        resetInputTelemetry();
+    }
+    else
+    {
+        exportInputTelemetry();
+    }
+}
+
+void EnsembleInfoDialog::exportInputTelemetry()
+{
+    QString f = QString("%1/AbracaDABra_input_%2.csv").arg(QStandardPaths::writableLocation(QStandardPaths::HomeLocation),
+                                                          QDateTime::currentDateTime().toString("yyyy-MM-dd_hhmmss"));
+
+    QString fileName = QFileDialog::getSaveFileName(this,
+                                                    tr("Export input statistics"),
+                                                    QDir::toNativeSeparators(f),
+                                                    tr("CSV files")+" (*.csv)");
+
+    if (!fileName.isEmpty())
+    {
+        QFile csvFile(fileName);
+        if (!csvFile.open(QIODevice::WriteOnly))
+        {
+            qCCritical(application) << "Unable to open file: " << fileName;
+            return;
+        }
+
+        qCInfo(application) << "Writing input statistics to:" << fileName;
+
+        QTextStream stream(&csvFile);
+        stream << "time,interval_ms,reads,fifo_min_pct,fifo_avg_pct,fifo_max_pct";
+        for (int n = 0; n < INPUTTELEMETRY_HISTOGRAM_BINS; ++n)
+        {
+            stream << ",fifo_hist_" << (n * 100 / INPUTTELEMETRY_HISTOGRAM_BINS);
+        }
+        stream << ",underruns,wait_ms,wait_max_ms,callbacks,callback_avg_us,callback_max_us,gap_avg_ms,gap_max_ms"
+               << ",dropped_bytes,device_overflows,signal_level,agc_gain_db,snr_db" << Qt::endl;
+        for (const auto & entry : m_telemetryLog)
+        {
+            const InputTelemetryData & d = entry.data;
+            stream << entry.time.toString(Qt::ISODateWithMs) << ',' << d.intervalMs << ',' << d.numReads << ','
+                   << d.fifoLevelMin << ',' << d.fifoLevelAvg << ',' << d.fifoLevelMax;
+            for (int n = 0; n < INPUTTELEMETRY_HISTOGRAM_BINS; ++n)
+            {
+                stream << ',' << d.fifoLevelHistogram[n];
+            }
+            stream << ',' << d.underruns << ',' << d.consumerWaitMs << ',' << d.consumerWaitMaxMs << ','
+                   << d.numCallbacks << ',' << d.callbackAvgUs << ',' << d.callbackMaxUs << ','
+                   << d.callbackGapAvgMs << ',' << d.callbackGapMaxMs << ','
+                   << d.droppedBytes << ',' << d.deviceOverflows << ',' << d.signalLevel << ','
+                   << entry.agcGain << ',' << entry.snr << Qt::endl;
+        }
+        stream.flush();
+        csvFile.close();
+    }
+    else
+    { /* no file selected */ }
+}
+
 void EnsembleInfoDialog::clearServiceInfo()
 {
     ui->service->setText(QString("%1").arg("", 16));
@@ -348,6 +545,7 @@ void EnsembleInfoDialog::clearServiceInfo()
 
 void EnsembleInfoDialog::clearSignalInfo()
 {
+    m_snr = NAN;
     ui->snr->setText(tr("N/A"));
     ui->freqOffset->setText(tr("N/A"));
     //ui->agcGain->setText(tr("N/A"));
@@ -27,9 +27,15 @@
 #ifndef ENSEMBLEINFODIALOG_H
 #define ENSEMBLEINFODIALOG_H
 
+#include <cmath>
 #include <QDialog>
 #include <QCloseEvent>
+#include <QDateTime>
+#include <QList>
 #include "radiocontrol.h"
+#include "inputtelemetry.h"
+
+#define ENSEMBLEINFODIALOG_TELEMETRY_LOG_LEN (3600)    // 1 hour of 1 sec intervals
 
 namespace Ui {
 class EnsembleInfoDialog;
@@ -51,6 +57,7 @@ public:
     void enableRecording(bool ena);
     void onRecording(bool isActive);
     void updateRecordingStatus(uint64_t bytes, float ms);
+    void updateRecordingDropped(uint64_t bytes);
     void updateAgcGain(float gain);
     void updateFIBstatus(int fibCount, int fibErrCount);
     void updateMSCstatus(int crcOkCount, int crcErrCount);
@@ -58,6 +65,8 @@ public:
     void resetMscStat();
     void newFrequency(quint32 f);
     void serviceChanged(const RadioControlServiceComponent &s);
+    void updateInputTelemetry(const InputTelemetryData & data);
+    void resetInputTelemetry();
 
 signals:
     //void recordingStart(const QString & filename);
@@ -69,9 +78,18 @@ protected:
     void showEvent(QShowEvent *event) override;
     void closeEvent(QCloseEvent *event) override;
 private:
+    struct TelemetryLogEntry
+    {
+        QDateTime time;
+        InputTelemetryData data;
+        float snr;
+        float agcGain;
+    };
+
     Ui::EnsembleInfoDialog *ui;
 
     bool m_isRecordingActive = false;
+    uint64_t m_recordingDroppedBytes = 0;
     quint32 m_frequency;
 
     quint32 m_fibCounter;
@@ -79,8 +97,16 @@ private:
     quint32 m_crcCounter;
     quint32 m_crcErrorCounter;
 
+    float m_snr = NAN;
+    float m_agcGain = NAN;
+    uint64_t m_inputDroppedBytes;
+    uint64_t m_inputDeviceOverflows;
+    QList<TelemetryLogEntry> m_telemetryLog;
+
     void onRecordingButtonClicked();
     void fibFrameContextMenu(const QPoint &pos);
+    void inputFrameContextMenu(const QPoint &pos);
+    void exportInputTelemetry();
     void clearServiceInfo();
     void clearSignalInfo();
     void clearFreqInfo();
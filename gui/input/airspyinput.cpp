@@ -31,7 +31,7 @@
 
 Q_LOGGING_CATEGORY(airspyInput, "AirspyInput", QtInfoMsg)
 
-AirspyInput::AirspyInput(bool try4096kHz, QObject *parent) : InputDevice(parent)
+AirspyInput::AirspyInput(fifo_t *inputBuffer, bool try4096kHz, QObject *parent) : InputDevice(inputBuffer, parent)
 {
     m_deviceDescription.id = InputDeviceId::AIRSPY;
 
@@ -39,8 +39,8 @@ AirspyInput::AirspyInput(bool try4096kHz, QObject *parent) : InputDevice(parent)
     m_device = nullptr;
     m_isRecording = false;
     m_signalLevelEmitCntr = 0;
+    m_pipeline = nullptr;
     m_src = nullptr;
-    m_filterOutBuffer = nullptr;
     m_frequency = 0;
     m_biasT = false;
 
@@ -57,13 +57,9 @@ AirspyInput::~AirspyInput()
         airspy_exit();
     }
 
-    if (nullptr != m_filterOutBuffer)
+    if (nullptr != m_pipeline)
     {
-        operator delete [] (m_filterOutBuffer, std::align_val_t(16));
-    }
-    if (nullptr != m_src)
-    {
-        delete m_src;
+        delete m_pipeline;
     }
 }
 
@@ -140,10 +136,11 @@ bool AirspyInput::openDevice()
         }
     }
 
-    // airspy provides 49152 samples in callback in packed modes
-    // we cannot produce more samples in SRC => allocating for worst case
-    m_filterOutBuffer = new ( std::align_val_t(16) ) float[49152*2];
     m_src = new InputDeviceSRC(sampleRate);
+    m_pipeline = new InputDevicePipeline("Airspy", &m_inputBuffer->telemetry());
+    m_pipeline->addStage(new InputPipelineFifoWriter(m_inputBuffer, m_src));
+    m_pipeline->addStage(new InputPipelineRecordTap([this](const uint8_t * buf, uint32_t len) { emit recordBuffer(buf, len); },
+                                                    m_isRecording, (AIRSPY_RECORD_INT16 > 0) ? AIRSPY_RECORD_FLOAT2INT16 : 0));
 
     // set automatic gain
     m_gainMode = AirpyGainMode::Software;
@@ -191,9 +188,9 @@ bool AirspyInput::openDevice()
 void AirspyInput::run()
 {
     // Reset buffer here - airspy is not running, DAB waits for new data
-    inputBuffer.reset();
+    m_inputBuffer->reset();
 
-    m_src->reset();
+    m_pipeline->reset();
 
     if (m_frequency != 0)
     {   // Tune to new frequency
@@ -234,10 +231,7 @@ void AirspyInput::stop()
             qCWarning(airspyInput) << "not finished after timeout - this should not happen :-(";
 
             // reset buffer - and tell the thread it is empty - buffer will be reset in any case
-            pthread_mutex_lock(&inputBuffer.countMutex);
-            inputBuffer.count = 0;
-            pthread_cond_signal(&inputBuffer.countCondition);
-            pthread_mutex_unlock(&inputBuffer.countMutex);
+            m_inputBuffer->reset();
             QThread::msleep(2000);
         }
 
@@ -400,7 +394,7 @@ void AirspyInput::onWatchdogTimeout()
     if (AIRSPY_TRUE != airspy_is_streaming(m_device))
     {
         qCCritical(airspyInput) << "watchdog timeout";
-        inputBuffer.fillDummy();
+        m_inputBuffer->fillDummy();
         emit error(InputDeviceErrorCode::NoDataAvailable);
     }
 }
@@ -434,22 +428,6 @@ void AirspyInput::setDataPacking(bool ena)
     }
 }
 
-void AirspyInput::doRecordBuffer(const float *buf, uint32_t len)
-{
-#if AIRSPY_RECORD_INT16
-    // dumping in int16
-    int16_t int16Buf[len];
-    for (int n = 0; n < len; ++n)
-    {
-        int16Buf[n] = *buf++ * AIRSPY_RECORD_FLOAT2INT16;
-    }
-    emit recordBuffer((const uint8_t *) int16Buf, len * sizeof(int16_t));
-#else
-    // dumping in float
-    emit recordBuffer((const uint8_t *) buf, len * sizeof(float));
-#endif
-}
-
 int AirspyInput::callback(airspy_transfer* transfer)
 {
     static_cast<AirspyInput *>(transfer->ctx)->processInputData(transfer);
@@ -461,56 +439,22 @@ void AirspyInput::processInputData(airspy_transfer *transfer)
     if (transfer->dropped_samples > 0)
     {
         qCWarning(airspyInput) << "Dropping" << transfer->dropped_samples << "samples";
+        m_inputBuffer->telemetry().producerOverflow();
     }
 
-    // len is number of I and Q samples
-    // get FIFO space
-    pthread_mutex_lock(&inputBuffer.countMutex);
-    uint64_t count = inputBuffer.count;
-    pthread_mutex_unlock(&inputBuffer.countMutex);
-
-    Q_ASSERT(count <= INPUT_FIFO_SIZE);
-
     // input samples are IQ = [float float] @ 4096kHz
     // going to transform them to [float float] @ 2048kHz
-    int numIQ = m_src->process((float*) transfer->samples, transfer->sample_count, m_filterOutBuffer);
-    uint64_t bytesToWrite = numIQ * 2 * sizeof(float);
-
-    if ((INPUT_FIFO_SIZE - count) < bytesToWrite)
-    {
-        qCWarning(airspyInput) << "Dropping" << transfer->sample_count << "IQ samples...";
+    if (!m_pipeline->process(transfer->samples, transfer->sample_count, InputFifoSampleFormat::SAMPLE_FORMAT_FLOAT))
+    {   // FIFO full
         return;
     }
 
+    m_inputBuffer->telemetry().setSignalLevel(m_src->signalLevel());
+
 #if (AIRSPY_AGC_ENABLE > 0)
     if (0 == (++m_signalLevelEmitCntr & 0x07))
     {
         emit agcLevel(m_src->signalLevel());
     }
 #endif
-
-    if (m_isRecording)
-    {
-        doRecordBuffer(m_filterOutBuffer, 2*numIQ);
-    }
-
-    // there is enough room in buffer
-    uint64_t bytesTillEnd = INPUT_FIFO_SIZE - inputBuffer.head;
-
-    if (bytesTillEnd >= bytesToWrite)
-    {
-        std::memcpy((inputBuffer.buffer + inputBuffer.head), (uint8_t *) m_filterOutBuffer, bytesToWrite);
-        inputBuffer.head = (inputBuffer.head + bytesToWrite);
-    }
-    else
-    {
-        std::memcpy((inputBuffer.buffer + inputBuffer.head), (uint8_t *) m_filterOutBuffer, bytesTillEnd);
-        std::memcpy((inputBuffer.buffer), ((uint8_t *) m_filterOutBuffer)+bytesTillEnd, bytesToWrite-bytesTillEnd);
-        inputBuffer.head = bytesToWrite-bytesTillEnd;
-    }
-
-    pthread_mutex_lock(&inputBuffer.countMutex);
-    inputBuffer.count = inputBuffer.count + bytesToWrite;
-    pthread_cond_signal(&inputBuffer.countCondition);
-    pthread_mutex_unlock(&inputBuffer.countMutex);
 }
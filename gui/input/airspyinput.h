@@ -34,6 +34,7 @@
 #include <libairspy/airspy_commands.h>
 #include "inputdevice.h"
 #include "inputdevicesrc.h"
+#include "inputdevicepipeline.h"
 
 #define AIRSPY_AGC_ENABLE  1     // enable AGC
 #define AIRSPY_RECORD_INT16  1   // record raw stream in int16 instead of float
@@ -71,7 +72,7 @@ class AirspyInput : public InputDevice
 {
     Q_OBJECT
 public:
-    explicit AirspyInput(bool try4096kHz, QObject *parent = nullptr);
+    explicit AirspyInput(fifo_t * inputBuffer, bool try4096kHz, QObject *parent = nullptr);
     ~AirspyInput();
     bool openDevice() override;
     void tune(uint32_t frequency) override;
@@ -91,8 +92,8 @@ private:
     int m_gainIdx;
     std::atomic<bool> m_isRecording;
     bool m_try4096kHz;
-    float * m_filterOutBuffer;
-    InputDeviceSRC * m_src;
+    InputDevicePipeline * m_pipeline;   // SRC+FIFO -> record tap
+    InputDeviceSRC * m_src;             // owned by pipeline
     uint_fast8_t m_signalLevelEmitCntr;
 
     void run();           
@@ -106,7 +107,6 @@ private:
     void onAgcLevel(float level);
     void onWatchdogTimeout();
 
-    void doRecordBuffer(const float *buf, uint32_t len);
     void processInputData(airspy_transfer* transfer);
     static int callback(airspy_transfer* transfer);
 };
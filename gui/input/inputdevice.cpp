@@ -24,100 +24,241 @@
  * SOFTWARE.
  */
 
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <utility>
 #include "inputdevice.h"
+#include "inputdevicekernels.h"
 
-//input FIFO
-fifo_t inputBuffer;
+#define INPUT_DOC_C (0.05f)
 
+// receivers by slot, dabsdr input functions are thunks dispatching to the receiver in their slot
+static std::atomic<InputReceiver *> receiverSlots[INPUTRECEIVER_MAX_INSTANCES];
 
-void ComplexFifo::reset()
+template <std::size_t N>
+static void inputThunk(float buffer[], uint16_t numSamples)
 {
-    pthread_mutex_lock(&countMutex);
+    receiverSlots[N].load(std::memory_order_acquire)->getSamples(buffer, numSamples);
+}
 
-    count = 0;
-    head = 0;
-    tail = 0;
+template <std::size_t N>
+static void dummyInputThunk(float buffer[], uint16_t numSamples)
+{
+    (void) buffer;
+    receiverSlots[N].load(std::memory_order_acquire)->skipSamples(numSamples);
+}
 
-    pthread_mutex_unlock(&countMutex);
+template <std::size_t... N>
+static constexpr std::array<InputReceiverFunc, sizeof...(N)> makeInputThunks(std::index_sequence<N...>)
+{
+    return {{ inputThunk<N>... }};
 }
 
-void ComplexFifo::fillDummy()
+template <std::size_t... N>
+static constexpr std::array<InputReceiverFunc, sizeof...(N)> makeDummyInputThunks(std::index_sequence<N...>)
 {
-    pthread_mutex_lock(&countMutex);
+    return {{ dummyInputThunk<N>... }};
+}
 
-    count = INPUT_FIFO_SIZE;
+static constexpr auto inputThunks = makeInputThunks(std::make_index_sequence<INPUTRECEIVER_MAX_INSTANCES>{});
+static constexpr auto dummyInputThunks = makeDummyInputThunks(std::make_index_sequence<INPUTRECEIVER_MAX_INSTANCES>{});
 
-    pthread_cond_signal(&countCondition);
-    pthread_mutex_unlock(&countMutex);
+InputReceiver::InputReceiver()
+{
+    for (int n = 0; n < INPUTRECEIVER_MAX_INSTANCES; ++n)
+    {
+        InputReceiver * expected = nullptr;
+        if (receiverSlots[n].compare_exchange_strong(expected, this, std::memory_order_acq_rel))
+        {
+            m_slot = n;
+            break;
+        }
+    }
 }
 
-InputDevice::InputDevice(QObject *parent) : QObject(parent)
+InputReceiver::~InputReceiver()
 {
-    // init empty fifo
-    inputBuffer.count = 0;
-    inputBuffer.head = 0;
-    inputBuffer.tail = 0;
-    pthread_mutex_init(&inputBuffer.countMutex, NULL);
-    pthread_cond_init(&inputBuffer.countCondition, NULL);
+    if (m_slot >= 0)
+    {
+        receiverSlots[m_slot].store(nullptr, std::memory_order_release);
+    }
 }
 
-InputDevice::~InputDevice()
+InputReceiverFunc InputReceiver::inputFcn() const
 {
-    pthread_mutex_destroy(&inputBuffer.countMutex);
-    pthread_cond_destroy(&inputBuffer.countCondition);
+    return (m_slot >= 0) ? inputThunks[m_slot] : nullptr;
 }
 
-void getSamples(float buffer[], uint16_t numSamples)
+InputReceiverFunc InputReceiver::dummyInputFcn() const
 {
-    // input read -> lets store it to FIFO
-    pthread_mutex_lock(&inputBuffer.countMutex);
-    uint64_t count = inputBuffer.count;
-    uint_fast32_t numIQ = numSamples * 2;
-    while (count < numIQ*sizeof(float))
-    {
-        pthread_cond_wait(&inputBuffer.countCondition, &inputBuffer.countMutex);
-        count = inputBuffer.count;
+    return (m_slot >= 0) ? dummyInputThunks[m_slot] : nullptr;
+}
+
+template <typename T>
+void InputReceiver::convertSamples(float * outPtr, const T * inPtr, uint32_t numIQ, bool docEna,
+                                   void (*convert)(float *, const T *, uint32_t, float, float, int64_t *, int64_t *))
+{
+    if (!docEna)
+    {   // convert to float only, sums are not used
+        int64_t sumI = 0;
+        int64_t sumQ = 0;
+        convert(outPtr, inPtr, numIQ, 0.0f, 0.0f, &sumI, &sumQ);
+        return;
+    }
+
+    if (m_docResetCount != m_fifo.resetCount())
+    {   // FIFO was reset (tuning) => reset DOC
+        m_docResetCount = m_fifo.resetCount();
+        m_docDcI = 0.0;
+        m_docDcQ = 0.0;
+        m_docSumI = 0;
+        m_docSumQ = 0;
+        m_docCntIQ = 0;
     }
-    pthread_mutex_unlock(&inputBuffer.countMutex);
 
-    // there is enough samples in input buffer
-    uint64_t bytesTillEnd = INPUT_FIFO_SIZE - inputBuffer.tail;
-    if (bytesTillEnd >= numIQ*sizeof(float))
+    uint32_t docChunk = m_fifo.chunkIQSamples();
+    while (numIQ > 0)
     {
-        memcpy(buffer, inputBuffer.buffer + inputBuffer.tail, numIQ*sizeof(float));
-        inputBuffer.tail = (inputBuffer.tail + numIQ*sizeof(float));
+        // process samples till end of DOC chunk
+        uint32_t n = docChunk - m_docCntIQ;
+        if (n > numIQ)
+        {
+            n = numIQ;
+        }
+
+        // subtract DC
+        float dcI = m_docDcI;
+        float dcQ = m_docDcQ;
+        convert(outPtr, inPtr, n, dcI, dcQ, &m_docSumI, &m_docSumQ);
+        outPtr += 2*n;
+        inPtr += 2*n;
+        m_docCntIQ += n;
+        numIQ -= n;
+
+        if (m_docCntIQ >= docChunk)
+        {   // calculate correction values for next chunk
+            m_docDcI = m_docSumI * INPUT_DOC_C / m_docCntIQ + dcI - INPUT_DOC_C * dcI;
+            m_docDcQ = m_docSumQ * INPUT_DOC_C / m_docCntIQ + dcQ - INPUT_DOC_C * dcQ;
+            m_docSumI = 0;
+            m_docSumQ = 0;
+            m_docCntIQ = 0;
+        }
     }
-    else
+}
+
+const uint8_t * InputReceiver::readSamples(uint16_t numSamples, InputFifoSampleFormat & format, bool & docEna)
+{
+    while (true)
     {
-        memcpy(buffer, inputBuffer.buffer + inputBuffer.tail, bytesTillEnd);
-        Q_ASSERT(2*sizeof(float) == 8);
-        uint64_t numIQtillEnd = bytesTillEnd >> 2;
-        memcpy(buffer+numIQtillEnd, inputBuffer.buffer, (numIQ - numIQtillEnd)*sizeof(float));
-        inputBuffer.tail = (numIQ - numIQtillEnd) * sizeof(float);
+        // sample format is published between two resets of FIFO
+        // => format is valid for data returned by readPtr() if reset count did not change meanwhile
+        uint32_t resetCntr = m_fifo.resetCount();
+        format = m_fifo.sampleFormat();
+        docEna = m_fifo.isDocEnabled();
+        const uint8_t * data = m_fifo.readPtr(numSamples*2*ComplexFifo::sampleSize(format));
+        if (m_fifo.resetCount() == resetCntr)
+        {
+            return data;
+        }
+
+        // FIFO was reset while waiting for data (format could change) => nothing is consumed, read is repeated
+        m_fifo.consume(0);
+    }
+}
+
+void InputReceiver::updateEpoch(uint32_t numSamples, InputFifoSampleFormat format)
+{
+    // tag is loaded first, it is published after epoch start position
+    uint32_t tag = m_fifo.epochTag();
+    uint64_t startPos = m_fifo.epochStart();
+    if ((startPos == m_epochStartPos) && (tag == m_epochFrequency.load(std::memory_order_relaxed)))
+    {   // no new epoch
+        return;
     }
+    m_epochStartPos = startPos;
 
-    pthread_mutex_lock(&inputBuffer.countMutex);
-    inputBuffer.count = inputBuffer.count - numIQ*sizeof(float);
-    pthread_cond_signal(&inputBuffer.countCondition);
-    pthread_mutex_unlock(&inputBuffer.countMutex);
+    // data are passed to dabsdr contiguously since epoch start => FIFO position maps to sample index
+    // epoch started after last read when its start is beyond read data, then it starts with next read
+    int64_t offsetIQ = (int64_t(startPos) - int64_t(m_fifo.readPosition())) / int64_t(2*ComplexFifo::sampleSize(format));
+    if (offsetIQ > numSamples)
+    {
+        offsetIQ = numSamples;
+    }
+    m_epochStartSample.store(m_sampleCount.load(std::memory_order_relaxed) + offsetIQ, std::memory_order_relaxed);
+    m_epochFrequency.store(tag, std::memory_order_release);
 }
 
-void skipSamples(float buffer[], uint16_t numSamples)
+void InputReceiver::getSamples(float buffer[], uint16_t numSamples)
 {
-    (void) buffer;
+    // data of previous frequency are skipped
+    m_fifo.waitForEpoch(m_expectedFrequency.load(std::memory_order_acquire));
 
-    // input read -> lets store it to FIFO
-    pthread_mutex_lock(&inputBuffer.countMutex);
-    uint64_t count = inputBuffer.count;
-    while (count < numSamples*2*sizeof(float))
+    // blocks until there is enough samples in input buffer, waiting time is measured only if data are missing
+    uint64_t fifoCount = m_fifo.count();
+    bool isWaiting = (fifoCount < numSamples*2*m_fifo.sampleSize());
+    std::chrono::steady_clock::time_point waitStart;
+    if (isWaiting)
+    {
+        waitStart = std::chrono::steady_clock::now();
+    }
+    InputFifoSampleFormat format;
+    bool docEna;
+    const uint8_t * data = readSamples(numSamples, format, docEna);
+    uint64_t bytes = numSamples*2*ComplexFifo::sampleSize(format);
+    uint64_t waitNs = 0;
+    if (isWaiting)
+    {
+        waitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - waitStart).count();
+    }
+    m_fifo.telemetry().consumerRead(fifoCount, m_fifo.size(), bytes, waitNs);
+    updateEpoch(numSamples, format);
+    if (nullptr == data)
+    {   // FIFO is not allocated
+        std::memset(buffer, 0, numSamples*2*sizeof(float));
+    }
+    else
     {
-        pthread_cond_wait(&inputBuffer.countCondition, &inputBuffer.countMutex);
-        count = inputBuffer.count;
+        switch (format)
+        {
+        case InputFifoSampleFormat::SAMPLE_FORMAT_FLOAT:
+            std::memcpy(buffer, data, bytes);
+            break;
+        case InputFifoSampleFormat::SAMPLE_FORMAT_S16:
+            convertSamples<int16_t>(buffer, (const int16_t *) data, numSamples, docEna, inputDeviceKernels().convertS16);
+            break;
+        case InputFifoSampleFormat::SAMPLE_FORMAT_U8:
+            convertSamples<uint8_t>(buffer, data, numSamples, docEna, inputDeviceKernels().convertU8);
+            break;
+        case InputFifoSampleFormat::SAMPLE_FORMAT_S8:
+            // not stored in FIFO
+            std::memset(buffer, 0, numSamples*2*sizeof(float));
+            break;
+        }
     }
+    m_fifo.consume(bytes);
+    m_sampleCount.store(m_sampleCount.load(std::memory_order_relaxed) + numSamples, std::memory_order_release);
+}
+
+void InputReceiver::skipSamples(uint16_t numSamples)
+{
+    // data are not copied, skipped size depends on sample format the same way as in getSamples()
+    InputFifoSampleFormat format;
+    bool docEna;
+    readSamples(numSamples, format, docEna);
+    updateEpoch(numSamples, format);
+    m_fifo.consume(numSamples*2*ComplexFifo::sampleSize(format));
+    m_sampleCount.store(m_sampleCount.load(std::memory_order_relaxed) + numSamples, std::memory_order_release);
+}
 
-    inputBuffer.tail = (inputBuffer.tail + numSamples*2*sizeof(float)) % INPUT_FIFO_SIZE;
+InputDevice::InputDevice(fifo_t * inputBuffer, QObject *parent) : QObject(parent)
+{
+    m_inputBuffer = inputBuffer;
+
+    // init empty fifo
+    m_inputBuffer->reset();
+}
 
-    inputBuffer.count = inputBuffer.count - numSamples*2*sizeof(float);
-    pthread_cond_signal(&inputBuffer.countCondition);
-    pthread_mutex_unlock(&inputBuffer.countMutex);
+InputDevice::~InputDevice()
+{
 }
@@ -30,35 +30,12 @@
 #include <QObject>
 #include <QMutex>
 #include <QWaitCondition>
-#include <pthread.h>
-
-// this is chunk that is received from input device to be stored in input FIFO
-#define INPUT_CHUNK_MS            (400)
-#define INPUT_CHUNK_IQ_SAMPLES    (2048 * INPUT_CHUNK_MS)
-
-// Input FIFO size in bytes - FIFO contains float _Complex samples => [float float]
-// total capacity is 8 input chunks
-#define INPUT_FIFO_SIZE           (INPUT_CHUNK_IQ_SAMPLES * (2*sizeof(float)) * 8)
+#include "inputfifo.h"
 
 #define INPUTDEVICE_WDOG_TIMEOUT_SEC 2     // watchdog timeout in seconds (if implemented and enabled)
 
 #define INPUTDEVICE_BANDWIDTH  (1530*1000)
 
-struct ComplexFifo
-{
-    uint64_t count;
-    uint64_t head;
-    uint64_t tail;
-    uint8_t buffer[INPUT_FIFO_SIZE];
-
-    pthread_mutex_t countMutex;
-    pthread_cond_t countCondition;
-
-    void reset();
-    void fillDummy();
-};
-typedef struct ComplexFifo fifo_t;
-
 enum class InputDeviceId { UNDEFINED = 0, RTLSDR, RTLTCP, RAWFILE, AIRSPY, SOAPYSDR};
 
 enum class RtlGainMode
@@ -94,9 +71,9 @@ struct InputDeviceDescription
     } device;
     struct
     {
-        int sampleRate;
-        int channelBits;          // I or Q
-        int containerBits;        // I or Q
+        int sampleRate = 0;
+        int channelBits = 0;      // I or Q
+        int containerBits = 0;    // I or Q
         QString channelContainer; // I or Q
     } sample;
     struct
@@ -116,7 +93,7 @@ class InputDevice : public QObject
 {
     Q_OBJECT    
 public:
-    InputDevice(QObject *parent = nullptr);
+    InputDevice(fifo_t * inputBuffer, QObject *parent = nullptr);
     ~InputDevice();
     virtual bool openDevice() = 0;
     const InputDeviceDescription & deviceDescription() const { return m_deviceDescription; }
@@ -134,10 +111,71 @@ signals:
 
 protected:
     InputDeviceDescription m_deviceDescription;
+    fifo_t * m_inputBuffer;
 };
 
-extern fifo_t inputBuffer;
-void getSamples(float buffer[], uint16_t len);
-void skipSamples(float buffer[], uint16_t numSamples);
+#define INPUTRECEIVER_MAX_INSTANCES 8   // maximum number of receivers in one process
+
+// dabsdr input function (dabsdrInputFunc_t)
+typedef void (*InputReceiverFunc)(float [], uint16_t);
+
+// Input of one receiver: input FIFO filled by InputDevice and read by dabsdr thread
+// dabsdr input function has no context pointer => every instance occupies one slot in fixed table
+// of functions dispatching to the instance, at most INPUTRECEIVER_MAX_INSTANCES instances can exist
+// Instance must outlive dabsdr thread it is registered to
+class InputReceiver
+{
+public:
+    InputReceiver();
+    ~InputReceiver();
+    InputReceiver(const InputReceiver &) = delete;
+    InputReceiver & operator=(const InputReceiver &) = delete;
+
+    // false if all slots are used
+    bool isValid() const { return m_slot >= 0; }
+    fifo_t * fifo() { return &m_fifo; }
+
+    // functions to be registered using dabsdrRegisterInputFcn() and dabsdrRegisterDummyInputFcn()
+    InputReceiverFunc inputFcn() const;
+    InputReceiverFunc dummyInputFcn() const;
+
+    // called from dabsdr thread
+    void getSamples(float buffer[], uint16_t numSamples);
+    void skipSamples(uint16_t numSamples);
+
+    // radio layer sets frequency [kHz] it is tuned to, getSamples() skips data of other FIFO epochs (0 = any data)
+    void setExpectedFrequency(uint32_t freq) { m_expectedFrequency.store(freq, std::memory_order_release); }
+
+    // number of IQ samples passed to dabsdr and index of first sample of current FIFO epoch (frequency)
+    // can be read from any thread
+    uint64_t sampleCount() const { return m_sampleCount.load(std::memory_order_acquire); }
+    uint64_t epochStartSample() const { return m_epochStartSample.load(std::memory_order_acquire); }
+    uint32_t epochFrequency() const { return m_epochFrequency.load(std::memory_order_acquire); }
+private:
+    int m_slot = -1;
+    fifo_t m_fifo;
+
+    std::atomic<uint32_t> m_expectedFrequency{0};
+    std::atomic<uint64_t> m_sampleCount{0};
+    std::atomic<uint64_t> m_epochStartSample{0};
+    std::atomic<uint32_t> m_epochFrequency{0};
+    uint64_t m_epochStartPos = 0;    // FIFO position of current epoch [bytes]
+
+    // DOC memory - DC offset correction of integer samples is done by consumer (dabsdr thread)
+    // correction values are updated once per input chunk, like it was done by device worker threads
+    float m_docDcI = 0.0;
+    float m_docDcQ = 0.0;
+    int64_t m_docSumI = 0;
+    int64_t m_docSumQ = 0;
+    uint32_t m_docCntIQ = 0;
+    uint32_t m_docResetCount = 0;
+
+    const uint8_t * readSamples(uint16_t numSamples, InputFifoSampleFormat & format, bool & docEna);
+    void updateEpoch(uint32_t numSamples, InputFifoSampleFormat format);
+
+    template <typename T>
+    void convertSamples(float * outPtr, const T * inPtr, uint32_t numIQ, bool docEna,
+                        void (*convert)(float *, const T *, uint32_t, float, float, int64_t *, int64_t *));
+};
 
 #endif // INPUTDEVICE_H
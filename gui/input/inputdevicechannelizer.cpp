@@ -0,0 +1,179 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <QLoggingCategory>
+#include "inputdevicechannelizer.h"
+#include "inputdevicekernels.h"
+#include "inputdevicepipeline.h"
+#include "inputdevicesrc.h"
+
+Q_LOGGING_CATEGORY(inputDeviceChannelizer, "InputDeviceChannelizer", QtInfoMsg)
+
+InputDeviceChannelizerWorker::InputDeviceChannelizerWorker(InputDeviceChannelizer *channelizer, float inputSampleRate, int32_t offsetHz,
+                                                           fifo_t *fifo, QObject *parent)
+    : QThread(parent)
+    , m_channelizer(channelizer)
+{
+    // channel is moved from offset to baseband
+    m_omega = -2.0 * M_PI * offsetHz / inputSampleRate;
+    m_nco.resize(2*INPUTDEVICECHANNELIZER_NCO_LEN);
+    for (int k = 0; k < INPUTDEVICECHANNELIZER_NCO_LEN; ++k)
+    {
+        m_nco[2*k] = std::cos(m_omega * k);
+        m_nco[2*k+1] = std::sin(m_omega * k);
+    }
+    m_buffer.resize(2*INPUTDEVICECHANNELIZER_BLOCK_IQ);
+
+    m_telemetry = &fifo->telemetry();
+    m_pipeline = new InputDevicePipeline(QString("Channel %1Hz").arg(offsetHz), m_telemetry);
+    m_fifoWriter = m_pipeline->addStage(new InputPipelineFifoWriter(fifo, new InputDeviceSRC(inputSampleRate)));
+}
+
+InputDeviceChannelizerWorker::~InputDeviceChannelizerWorker()
+{
+    delete m_pipeline;
+}
+
+void InputDeviceChannelizerWorker::stop()
+{
+    m_stopRequest = true;
+}
+
+float InputDeviceChannelizerWorker::signalLevel() const
+{
+    return m_fifoWriter->src()->signalLevel();
+}
+
+void InputDeviceChannelizerWorker::run()
+{
+    double phase = 0.0;   // NCO phase at the beginning of table
+    int idx = 0;
+    while (!m_stopRequest)
+    {
+        if (!m_filledBlocks.tryAcquire(1, 100))
+        {   // checking stop request
+            continue;
+        }
+
+        if (m_resetRequest.exchange(false))
+        {
+            m_pipeline->reset();
+            phase = 0.0;
+        }
+
+        // block is released as soon as it is mixed => producer can reuse it while SRC is running
+        const InputDeviceChannelizer::Block & block = m_channelizer->block(idx);
+        const uint32_t numIQ = block.numIQ;
+        for (uint32_t n = 0; n < numIQ; n += INPUTDEVICECHANNELIZER_NCO_LEN)
+        {
+            uint32_t len = qMin(numIQ - n, uint32_t(INPUTDEVICECHANNELIZER_NCO_LEN));
+            inputDeviceKernels().mixNco(m_buffer.data() + 2*n, block.data.data() + 2*n, m_nco.data(), len, std::cos(phase), std::sin(phase));
+            phase = std::remainder(phase + m_omega * len, 2.0 * M_PI);
+        }
+        m_channelizer->releaseBlock();
+        idx = (idx + 1) % INPUTDEVICECHANNELIZER_BUFFERS;
+
+        if (!m_pipeline->process(m_buffer.data(), numIQ, InputFifoSampleFormat::SAMPLE_FORMAT_FLOAT))
+        {   // FIFO full, producer is not blocked
+            m_droppedIQ += numIQ;
+        }
+        m_telemetry->setSignalLevel(m_fifoWriter->src()->signalLevel());
+    }
+}
+
+//===================================================================================================
+InputDeviceChannelizer::InputDeviceChannelizer(float inputSampleRate, uint32_t centerFrequency, uint32_t frequency, fifo_t *fifo)
+    : m_freeBlocks(INPUTDEVICECHANNELIZER_BUFFERS)
+{
+    Q_ASSERT(isInBand(inputSampleRate, centerFrequency, frequency));
+
+    for (auto & block : m_blocks)
+    {
+        block.data.resize(2*INPUTDEVICECHANNELIZER_BLOCK_IQ);
+    }
+
+    int32_t offsetHz = (int32_t(frequency) - int32_t(centerFrequency)) * 1000;
+    m_worker = new InputDeviceChannelizerWorker(this, inputSampleRate, offsetHz, fifo);
+    qCInfo(inputDeviceChannelizer) << "Channel" << frequency << "kHz, offset" << offsetHz / 1000 << "kHz";
+}
+
+InputDeviceChannelizer::~InputDeviceChannelizer()
+{
+    stop();
+    delete m_worker;
+}
+
+bool InputDeviceChannelizer::isInBand(float inputSampleRate, uint32_t centerFrequency, uint32_t frequency)
+{
+    // whole DAB signal must be inside Nyquist band
+    int64_t offsetHz = (int64_t(frequency) - int64_t(centerFrequency)) * 1000;
+    return (std::abs(offsetHz) + INPUTDEVICECHANNELIZER_HALF_BW) < (0.5 * inputSampleRate);
+}
+
+void InputDeviceChannelizer::start()
+{
+    m_running = true;
+    m_worker->start();
+}
+
+void InputDeviceChannelizer::stop()
+{
+    m_running = false;
+    m_worker->stop();
+    m_worker->wait();
+}
+
+void InputDeviceChannelizer::reset()
+{
+    m_worker->requestReset();
+}
+
+bool InputDeviceChannelizer::process(const float *data, uint32_t numIQ)
+{
+    while (numIQ > 0)
+    {
+        // waiting for block that was mixed by worker
+        while (!m_freeBlocks.tryAcquire(1, 100))
+        {
+            if (!m_running)
+            {
+                return false;
+            }
+        }
+
+        Block & block = m_blocks[m_writeIdx];
+        block.numIQ = qMin(numIQ, uint32_t(INPUTDEVICECHANNELIZER_BLOCK_IQ));
+        std::memcpy(block.data.data(), data, 2*block.numIQ * sizeof(float));
+        m_worker->post();
+        m_writeIdx = (m_writeIdx + 1) % INPUTDEVICECHANNELIZER_BUFFERS;
+
+        data += 2*block.numIQ;
+        numIQ -= block.numIQ;
+    }
+    return true;
+}
@@ -0,0 +1,118 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef INPUTDEVICECHANNELIZER_H
+#define INPUTDEVICECHANNELIZER_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <QSemaphore>
+#include <QThread>
+#include "inputfifo.h"
+
+#define INPUTDEVICECHANNELIZER_BLOCK_IQ     (16384)     // max number of input IQ samples in one block passed to worker
+#define INPUTDEVICECHANNELIZER_BUFFERS      (4)         // number of blocks in flight
+#define INPUTDEVICECHANNELIZER_NCO_LEN      (1024)      // length of NCO phasor table, phase is restarted from accumulator every table
+#define INPUTDEVICECHANNELIZER_HALF_BW      (768000)    // half of DAB signal bandwidth [Hz]
+
+class InputDevicePipeline;
+class InputPipelineFifoWriter;
+class InputDeviceChannelizer;
+
+// Processing of channel in its own thread
+// samples are shifted to baseband by NCO and resampled to 2048kHz by SRC writing to FIFO
+class InputDeviceChannelizerWorker : public QThread
+{
+    Q_OBJECT
+public:
+    InputDeviceChannelizerWorker(InputDeviceChannelizer * channelizer, float inputSampleRate, int32_t offsetHz,
+                                 fifo_t * fifo, QObject *parent = nullptr);
+    ~InputDeviceChannelizerWorker();
+
+    void stop();
+    void requestReset() { m_resetRequest = true; }
+    void post() { m_filledBlocks.release(); }
+    float signalLevel() const;
+    uint64_t droppedIQ() const { return m_droppedIQ; }
+protected:
+    void run() override;
+private:
+    InputDeviceChannelizer * m_channelizer;
+    std::vector<float> m_nco;           // exp(j*omega*k), IQ interleaved
+    double m_omega;                     // NCO phase increment per sample
+    std::vector<float> m_buffer;        // mixed samples
+    InputDevicePipeline * m_pipeline;
+    InputPipelineFifoWriter * m_fifoWriter;
+    InputTelemetry * m_telemetry;
+    QSemaphore m_filledBlocks;
+    std::atomic<bool> m_stopRequest{false};
+    std::atomic<bool> m_resetRequest{false};
+    std::atomic<uint64_t> m_droppedIQ{0};
+};
+
+// Extracts one DAB channel from wideband IQ stream and writes it to FIFO at 2048kHz
+// producer (reader thread) copies input to pool of blocks, mixing and SRC run in worker thread in parallel,
+// producer waits only when all blocks are in flight
+class InputDeviceChannelizer
+{
+public:
+    // frequencies in kHz, the same unit as DabTables channels, channel must be in band (see isInBand())
+    InputDeviceChannelizer(float inputSampleRate, uint32_t centerFrequency, uint32_t frequency, fifo_t * fifo);
+    ~InputDeviceChannelizer();   // worker is stopped
+
+    static bool isInBand(float inputSampleRate, uint32_t centerFrequency, uint32_t frequency);
+
+    void start();
+    void stop();
+    void reset();   // channel restarts from zero state before next block (input discontinuity)
+
+    // passes numIQ float IQ samples to channel, returns false if worker is not running
+    bool process(const float * data, uint32_t numIQ);
+
+    float signalLevel() const { return m_worker->signalLevel(); }
+    uint64_t droppedIQ() const { return m_worker->droppedIQ(); }
+private:
+    friend class InputDeviceChannelizerWorker;
+
+    struct Block
+    {
+        std::vector<float> data;
+        uint32_t numIQ = 0;
+    };
+
+    InputDeviceChannelizerWorker * m_worker;
+    Block m_blocks[INPUTDEVICECHANNELIZER_BUFFERS];
+    QSemaphore m_freeBlocks;
+    int m_writeIdx = 0;
+    std::atomic<bool> m_running{false};
+
+    // worker API
+    const Block & block(int idx) const { return m_blocks[idx]; }
+    void releaseBlock() { m_freeBlocks.release(); }
+};
+
+#endif // INPUTDEVICECHANNELIZER_H
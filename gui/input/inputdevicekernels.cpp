@@ -0,0 +1,1243 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <QLoggingCategory>
+#include "inputdevicekernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INPUTKERNELS_X86 1
+#include <immintrin.h>
+#define INPUTKERNELS_TARGET_SSE2 __attribute__((target("sse2")))
+#define INPUTKERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define INPUTKERNELS_X86 0
+#endif
+
+#if defined(__aarch64__)
+#define INPUTKERNELS_NEON 1
+#include <arm_neon.h>
+#else
+#define INPUTKERNELS_NEON 0
+#endif
+
+// integer sums are accumulated in 32bit lanes => flushed to 64bit every block of IQ samples
+#define INPUTKERNELS_SUM_BLOCK  (32768)
+
+Q_LOGGING_CATEGORY(inputKernels, "InputDeviceKernels", QtInfoMsg)
+
+// ***************************************************************************
+// common functions - used by all implementations to get bit-exact results
+
+static float envelopeReleaseCoef(float cRelease)
+{
+    return 1.0f - std::pow(1.0f - cRelease, float(INPUTKERNELS_ENVELOPE_BLOCK));
+}
+
+static inline float envelopeBlock(float level, int maxAbs, int sumAbs, float cAttack, float cReleaseBlock)
+{
+    if (maxAbs > level)
+    {   // fast attack to block maximum
+        return cAttack * maxAbs + level - cAttack * level;
+    }
+
+    // slow release to block mean
+    float mean = sumAbs * (1.0f / INPUTKERNELS_ENVELOPE_BLOCK);
+    return cReleaseBlock * mean + level - cReleaseBlock * level;
+}
+
+static float envelopeTail(const uint8_t * in, uint32_t len, float level, float cAttack, float cRelease)
+{
+    for (uint32_t k = 0; k < len; ++k)
+    {
+        int absTmp = std::abs(int(*in++) - 128);
+
+        // calculate signal level (rectifier, fast attack slow release)
+        float c = cRelease;
+        if (absTmp > level)
+        {
+            c = cAttack;
+        }
+        level = c * absTmp + level - c * level;
+    }
+    return level;
+}
+
+// ***************************************************************************
+// scalar reference implementation
+
+static void convertU8Scalar(float * out, const uint8_t * in, uint32_t numIQ, float dcI, float dcQ, int64_t * sumI, int64_t * sumQ)
+{
+    int64_t sI = 0;
+    int64_t sQ = 0;
+    for (uint32_t k = 0; k < numIQ; ++k)
+    {
+        int32_t tmpI = int32_t(*in++) - 128;
+        int32_t tmpQ = int32_t(*in++) - 128;
+        sI += tmpI;
+        sQ += tmpQ;
+        *out++ = float(tmpI) - dcI;
+        *out++ = float(tmpQ) - dcQ;
+    }
+    *sumI += sI;
+    *sumQ += sQ;
+}
+
+static void convertS16Scalar(float * out, const int16_t * in, uint32_t numIQ, float dcI, float dcQ, int64_t * sumI, int64_t * sumQ)
+{
+    int64_t sI = 0;
+    int64_t sQ = 0;
+    for (uint32_t k = 0; k < numIQ; ++k)
+    {
+        int32_t tmpI = *in++;
+        int32_t tmpQ = *in++;
+        sI += tmpI;
+        sQ += tmpQ;
+        *out++ = float(tmpI) - dcI;
+        *out++ = float(tmpQ) - dcQ;
+    }
+    *sumI += sI;
+    *sumQ += sQ;
+}
+
+static float envelopeU8Scalar(const uint8_t * in, uint32_t len, float level, float cAttack, float cRelease)
+{
+    float cReleaseBlock = envelopeReleaseCoef(cRelease);
+    uint32_t numBlocks = len / INPUTKERNELS_ENVELOPE_BLOCK;
+    for (uint32_t b = 0; b < numBlocks; ++b)
+    {
+        int maxAbs = 0;
+        int sumAbs = 0;
+        for (int k = 0; k < INPUTKERNELS_ENVELOPE_BLOCK; ++k)
+        {
+            int absTmp = std::abs(int(*in++) - 128);
+            maxAbs = (absTmp > maxAbs) ? absTmp : maxAbs;
+            sumAbs += absTmp;
+        }
+        level = envelopeBlock(level, maxAbs, sumAbs, cAttack, cReleaseBlock);
+    }
+    return envelopeTail(in, len - numBlocks * INPUTKERNELS_ENVELOPE_BLOCK, level, cAttack, cRelease);
+}
+
+static void splitIQScalar(float * even, float * odd, float * abs2Odd, const float * in, uint32_t numPairs)
+{
+    for (uint32_t k = 0; k < numPairs; ++k)
+    {
+        *even++ = *in++;
+        *even++ = *in++;
+        float abs2 = (*in) * (*in);     // I*I
+        *odd++ = *in++;
+        abs2 += (*in) * (*in);          // Q*Q
+        *odd++ = *in++;
+        *abs2Odd++ = abs2;
+    }
+}
+
+static void halfbandDS2Scalar(float * out, const float * even, const float * odd, uint32_t numOutIQ, const float * coef, uint32_t numCoef)
+{
+    uint32_t len = 2*(numCoef - 1) - 1;     // distance of outer taps in even samples
+    for (uint32_t k = 0; k < numOutIQ; ++k)
+    {
+        float accI = 0;
+        float accQ = 0;
+        for (uint32_t c = 0; c < numCoef - 1; ++c)
+        {
+            accI += (even[2*c] + even[2*(len - c)]) * coef[c];
+            accQ += (even[2*c + 1] + even[2*(len - c) + 1]) * coef[c];
+        }
+        accI += odd[2*(numCoef - 2)] * coef[numCoef - 1];
+        accQ += odd[2*(numCoef - 2) + 1] * coef[numCoef - 1];
+        *out++ = accI;
+        *out++ = accQ;
+        even += 2;
+        odd += 2;
+    }
+}
+
+static uint32_t farrowIntegrateScalar(float * x, uint32_t stride, float * acc, const float * in, const float * mu, const uint8_t * dump, uint32_t numIQ)
+{
+    uint32_t numOut = 0;
+    for (uint32_t k = 0; k < numIQ; ++k)
+    {
+        if (dump[k])
+        {
+            for (int m = 0; m < INPUTKERNELS_FARROW_COEFS; ++m)
+            {
+                x[m*stride + 2*numOut] = acc[2*m];
+                x[m*stride + 2*numOut + 1] = acc[2*m + 1];
+                acc[2*m] = 0.0f;
+                acc[2*m + 1] = 0.0f;
+            }
+            numOut += 1;
+        }
+        float p[INPUTKERNELS_FARROW_COEFS] = { 1.0f, mu[k], mu[k] * mu[k], mu[k] * mu[k] * mu[k] };
+        for (int m = 0; m < INPUTKERNELS_FARROW_COEFS; ++m)
+        {
+            acc[2*m] += in[2*k] * p[m];
+            acc[2*m + 1] += in[2*k + 1] * p[m];
+        }
+    }
+    return numOut;
+}
+
+static void farrowFirScalar(float * out, const float * x, uint32_t stride, uint32_t numOutIQ, const float * coef, uint32_t numPoly, float gain)
+{
+    for (uint32_t j = 0; j < numOutIQ; ++j)
+    {
+        float accI = 0;
+        float accQ = 0;
+        for (int n = numPoly - 1; n >= 0; --n)
+        {
+            const float * xn = x + 2*(j + numPoly - 1 - n);
+            float tI = 0;
+            float tQ = 0;
+            for (int m = 0; m < INPUTKERNELS_FARROW_COEFS; ++m)
+            {
+                tI += xn[m*stride] * coef[n*INPUTKERNELS_FARROW_COEFS + m];
+                tQ += xn[m*stride + 1] * coef[n*INPUTKERNELS_FARROW_COEFS + m];
+            }
+            accI += tI;
+            accQ += tQ;
+        }
+        *out++ = gain * accI;
+        *out++ = gain * accQ;
+    }
+}
+
+static void convertF32ToS16Scalar(int16_t * out, const float * in, uint32_t len, float scale)
+{
+    for (uint32_t n = 0; n < len; ++n)
+    {
+        float v = in[n] * scale;
+        v = (v > 32767.0f) ? 32767.0f : v;
+        v = (v < -32768.0f) ? -32768.0f : v;
+        out[n] = int16_t(v);
+    }
+}
+
+static void convertS16ToF32Scalar(float * out, const int16_t * in, uint32_t len, float scale)
+{
+    for (uint32_t n = 0; n < len; ++n)
+    {
+        out[n] = float(in[n]) * scale;
+    }
+}
+
+static void convertS8ToF32Scalar(float * out, const int8_t * in, uint32_t len, float scale)
+{
+    for (uint32_t n = 0; n < len; ++n)
+    {
+        out[n] = float(in[n]) * scale;
+    }
+}
+
+static void mixNcoScalar(float * out, const float * in, const float * rot, uint32_t numIQ, float baseRe, float baseIm)
+{
+    for (uint32_t n = 0; n < numIQ; ++n)
+    {
+        float cRe = baseRe * rot[2*n] - baseIm * rot[2*n+1];
+        float cIm = baseRe * rot[2*n+1] + baseIm * rot[2*n];
+        float xRe = in[2*n];
+        float xIm = in[2*n+1];
+        out[2*n] = xRe * cRe - xIm * cIm;
+        out[2*n+1] = xRe * cIm + xIm * cRe;
+    }
+}
+
+#if INPUTKERNELS_X86
+// ***************************************************************************
+// SSE2 implementation
+
+INPUTKERNELS_TARGET_SSE2
+static void convertU8Sse2(float * out, const uint8_t * in, uint32_t numIQ, float dcI, float dcQ, int64_t * sumI, int64_t * sumQ)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i offset = _mm_set1_epi16(128);
+    const __m128 dc = _mm_setr_ps(dcI, dcQ, dcI, dcQ);
+    while (numIQ >= 8)
+    {
+        uint32_t n = (numIQ > INPUTKERNELS_SUM_BLOCK) ? INPUTKERNELS_SUM_BLOCK : (numIQ & ~7u);
+        __m128i acc = zero;   // [I Q I Q]
+        for (uint32_t k = 0; k < n; k += 8)
+        {   // 8 IQ samples
+            __m128i x = _mm_loadu_si128((const __m128i *) in);
+            __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(x, zero), offset);
+            __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(x, zero), offset);
+            __m128i v0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16);
+            __m128i v1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16);
+            __m128i v2 = _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16);
+            __m128i v3 = _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16);
+            acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_add_epi32(v0, v1), _mm_add_epi32(v2, v3)));
+            _mm_storeu_ps(out, _mm_sub_ps(_mm_cvtepi32_ps(v0), dc));
+            _mm_storeu_ps(out + 4, _mm_sub_ps(_mm_cvtepi32_ps(v1), dc));
+            _mm_storeu_ps(out + 8, _mm_sub_ps(_mm_cvtepi32_ps(v2), dc));
+            _mm_storeu_ps(out + 12, _mm_sub_ps(_mm_cvtepi32_ps(v3), dc));
+            in += 16;
+            out += 16;
+        }
+        int32_t s[4];
+        _mm_storeu_si128((__m128i *) s, acc);
+        *sumI += int64_t(s[0]) + s[2];
+        *sumQ += int64_t(s[1]) + s[3];
+        numIQ -= n;
+    }
+    convertU8Scalar(out, in, numIQ, dcI, dcQ, sumI, sumQ);
+}
+
+INPUTKERNELS_TARGET_SSE2
+static void convertS16Sse2(float * out, const int16_t * in, uint32_t numIQ, float dcI, float dcQ, int64_t * sumI, int64_t * sumQ)
+{
+    const __m128 dc = _mm_setr_ps(dcI, dcQ, dcI, dcQ);
+    while (numIQ >= 4)
+    {
+        uint32_t n = (numIQ > INPUTKERNELS_SUM_BLOCK) ? INPUTKERNELS_SUM_BLOCK : (numIQ & ~3u);
+        __m128i acc = _mm_setzero_si128();   // [I Q I Q]
+        for (uint32_t k = 0; k < n; k += 4)
+        {   // 4 IQ samples
+            __m128i x = _mm_loadu_si128((const __m128i *) in);
+            __m128i v0 = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+            __m128i v1 = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+            acc = _mm_add_epi32(acc, _mm_add_epi32(v0, v1));
+            _mm_storeu_ps(out, _mm_sub_ps(_mm_cvtepi32_ps(v0), dc));
+            _mm_storeu_ps(out + 4, _mm_sub_ps(_mm_cvtepi32_ps(v1), dc));
+            in += 8;
+            out += 8;
+        }
+        int32_t s[4];
+        _mm_storeu_si128((__m128i *) s, acc);
+        *sumI += int64_t(s[0]) + s[2];
+        *sumQ += int64_t(s[1]) + s[3];
+        numIQ -= n;
+    }
+    convertS16Scalar(out, in, numIQ, dcI, dcQ, sumI, sumQ);
+}
+
+INPUTKERNELS_TARGET_SSE2
+static float envelopeU8Sse2(const uint8_t * in, uint32_t len, float level, float cAttack, float cRelease)
+{
+    static_assert(INPUTKERNELS_ENVELOPE_BLOCK == 16, "SSE2 envelope expects 16 values per block");
+
+    float cReleaseBlock = envelopeReleaseCoef(cRelease);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i offset = _mm_set1_epi8(char(0x80));
+    uint32_t numBlocks = len / INPUTKERNELS_ENVELOPE_BLOCK;
+    for (uint32_t b = 0; b < numBlocks; ++b)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *) in);
+        __m128i a = _mm_or_si128(_mm_subs_epu8(x, offset), _mm_subs_epu8(offset, x));  // |x - 128|
+        __m128i m = _mm_max_epu8(a, _mm_srli_si128(a, 8));
+        m = _mm_max_epu8(m, _mm_srli_si128(m, 4));
+        m = _mm_max_epu8(m, _mm_srli_si128(m, 2));
+        m = _mm_max_epu8(m, _mm_srli_si128(m, 1));
+        __m128i s = _mm_sad_epu8(a, zero);
+        int maxAbs = _mm_cvtsi128_si32(m) & 0xFF;
+        int sumAbs = _mm_cvtsi128_si32(s) + _mm_extract_epi16(s, 4);
+        level = envelopeBlock(level, maxAbs, sumAbs, cAttack, cReleaseBlock);
+        in += INPUTKERNELS_ENVELOPE_BLOCK;
+    }
+    return envelopeTail(in, len - numBlocks * INPUTKERNELS_ENVELOPE_BLOCK, level, cAttack, cRelease);
+}
+
+INPUTKERNELS_TARGET_SSE2
+static void splitIQSse2(float * even, float * odd, float * abs2Odd, const float * in, uint32_t numPairs)
+{
+    uint32_t k = 0;
+    for ( ; k + 2 <= numPairs; k += 2)
+    {   // IQ sample is handled as one 64bit value
+        __m128d a = _mm_loadu_pd((const double *) in);          // [x0 x1]
+        __m128d b = _mm_loadu_pd((const double *) (in + 4));    // [x2 x3]
+        __m128 e = _mm_castpd_ps(_mm_unpacklo_pd(a, b));        // [x0 x2]
+        __m128 o = _mm_castpd_ps(_mm_unpackhi_pd(a, b));        // [x1 x3]
+        _mm_storeu_ps(even, e);
+        _mm_storeu_ps(odd, o);
+        __m128 sq = _mm_mul_ps(o, o);
+        __m128 abs2 = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+        _mm_storel_pi((__m64 *) abs2Odd, _mm_shuffle_ps(abs2, abs2, _MM_SHUFFLE(2, 0, 2, 0)));
+        in += 8;
+        even += 4;
+        odd += 4;
+        abs2Odd += 2;
+    }
+    splitIQScalar(even, odd, abs2Odd, in, numPairs - k);
+}
+
+INPUTKERNELS_TARGET_SSE2
+static void halfbandDS2Sse2(float * out, const float * even, const float * odd, uint32_t numOutIQ, const float * coef, uint32_t numCoef)
+{
+    uint32_t len = 2*(numCoef - 1) - 1;
+    const __m128 center = _mm_set1_ps(coef[numCoef - 1]);
+    uint32_t k = 0;
+    for ( ; k + 2 <= numOutIQ; k += 2)
+    {   // 2 IQ output samples
+        __m128 acc = _mm_setzero_ps();
+        for (uint32_t c = 0; c < numCoef - 1; ++c)
+        {
+            __m128 sum = _mm_add_ps(_mm_loadu_ps(even + 2*c), _mm_loadu_ps(even + 2*(len - c)));
+            acc = _mm_add_ps(acc, _mm_mul_ps(sum, _mm_set1_ps(coef[c])));
+        }
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(odd + 2*(numCoef - 2)), center));
+        _mm_storeu_ps(out, acc);
+        out += 4;
+        even += 4;
+        odd += 4;
+    }
+    halfbandDS2Scalar(out, even, odd, numOutIQ - k, coef, numCoef);
+}
+
+INPUTKERNELS_TARGET_SSE2
+static uint32_t farrowIntegrateSse2(float * x, uint32_t stride, float * acc, const float * in, const float * mu, const uint8_t * dump, uint32_t numIQ)
+{
+    static_assert(INPUTKERNELS_FARROW_COEFS == 4, "SSE2 Farrow expects 4 coefficients");
+
+    __m128 acc01 = _mm_loadu_ps(acc);        // [I*1 Q*1 I*mu Q*mu]
+    __m128 acc23 = _mm_loadu_ps(acc + 4);    // [I*mu^2 Q*mu^2 I*mu^3 Q*mu^3]
+    uint32_t numOut = 0;
+    for (uint32_t k = 0; k < numIQ; ++k)
+    {
+        if (dump[k])
+        {
+            float * xj = x + 2*numOut;
+            _mm_storel_pi((__m64 *) xj, acc01);
+            _mm_storeh_pi((__m64 *) (xj + stride), acc01);
+            _mm_storel_pi((__m64 *) (xj + 2*stride), acc23);
+            _mm_storeh_pi((__m64 *) (xj + 3*stride), acc23);
+            acc01 = _mm_setzero_ps();
+            acc23 = _mm_setzero_ps();
+            numOut += 1;
+        }
+        float mu2 = mu[k] * mu[k];
+        __m128 iq = _mm_castpd_ps(_mm_load1_pd((const double *) (in + 2*k)));
+        acc01 = _mm_add_ps(acc01, _mm_mul_ps(iq, _mm_setr_ps(1.0f, 1.0f, mu[k], mu[k])));
+        acc23 = _mm_add_ps(acc23, _mm_mul_ps(iq, _mm_setr_ps(mu2, mu2, mu2 * mu[k], mu2 * mu[k])));
+    }
+    _mm_storeu_ps(acc, acc01);
+    _mm_storeu_ps(acc + 4, acc23);
+    return numOut;
+}
+
+INPUTKERNELS_TARGET_SSE2
+static void farrowFirSse2(float * out, const float * x, uint32_t stride, uint32_t numOutIQ, const float * coef, uint32_t numPoly, float gain)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    uint32_t j = 0;
+    for ( ; j + 2 <= numOutIQ; j += 2)
+    {   // 2 IQ output samples
+        __m128 acc = _mm_setzero_ps();
+        for (int n = numPoly - 1; n >= 0; --n)
+        {
+            const float * xn = x + 2*(j + numPoly - 1 - n);
+            const float * cn = coef + n*INPUTKERNELS_FARROW_COEFS;
+            __m128 t = _mm_mul_ps(_mm_loadu_ps(xn), _mm_set1_ps(cn[0]));
+            t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(xn + stride), _mm_set1_ps(cn[1])));
+            t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(xn + 2*stride), _mm_set1_ps(cn[2])));
+            t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(xn + 3*stride), _mm_set1_ps(cn[3])));
+            acc = _mm_add_ps(acc, t);
+        }
+        _mm_storeu_ps(out, _mm_mul_ps(g, acc));
+        out += 4;
+    }
+    farrowFirScalar(out, x + 2*j, stride, numOutIQ - j, coef, numPoly, gain);
+}
+
+INPUTKERNELS_TARGET_SSE2
+static void convertF32ToS16Sse2(int16_t * out, const float * in, uint32_t len, float scale)
+{
+    const __m128 s = _mm_set1_ps(scale);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+    const __m128 lo = _mm_set1_ps(-32768.0f);
+    uint32_t n = 0;
+    for ( ; n + 8 <= len; n += 8)
+    {   // clamp in float => pack saturation is never used
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + n), s), lo), hi);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + n + 4), s), lo), hi);
+        _mm_storeu_si128((__m128i *) (out + n), _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b)));
+    }
+    convertF32ToS16Scalar(out + n, in + n, len - n, scale);
+}
+
+INPUTKERNELS_TARGET_SSE2
+static void convertS16ToF32Sse2(float * out, const int16_t * in, uint32_t len, float scale)
+{
+    const __m128 s = _mm_set1_ps(scale);
+    uint32_t n = 0;
+    for ( ; n + 8 <= len; n += 8)
+    {   // sign extension: value is moved to upper half of 32bit lane and shifted back
+        __m128i x = _mm_loadu_si128((const __m128i *) (in + n));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(out + n, _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+        _mm_storeu_ps(out + n + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), s));
+    }
+    convertS16ToF32Scalar(out + n, in + n, len - n, scale);
+}
+
+INPUTKERNELS_TARGET_SSE2
+static void convertS8ToF32Sse2(float * out, const int8_t * in, uint32_t len, float scale)
+{
+    const __m128 s = _mm_set1_ps(scale);
+    uint32_t n = 0;
+    for ( ; n + 16 <= len; n += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *) (in + n));
+        __m128i x16lo = _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8);
+        __m128i x16hi = _mm_srai_epi16(_mm_unpackhi_epi8(x, x), 8);
+        _mm_storeu_ps(out + n, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x16lo, x16lo), 16)), s));
+        _mm_storeu_ps(out + n + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x16lo, x16lo), 16)), s));
+        _mm_storeu_ps(out + n + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x16hi, x16hi), 16)), s));
+        _mm_storeu_ps(out + n + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x16hi, x16hi), 16)), s));
+    }
+    convertS8ToF32Scalar(out + n, in + n, len - n, scale);
+}
+
+// complex multiplication of 2 IQ samples, the same operation order as scalar code
+INPUTKERNELS_TARGET_SSE2
+static inline __m128 complexMulSse2(__m128 a, __m128 b)
+{
+    const __m128 signRe = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+    __m128 aRe = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 0, 0));
+    __m128 aIm = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 1, 1));
+    __m128 bSwap = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_add_ps(_mm_mul_ps(aRe, b), _mm_xor_ps(_mm_mul_ps(aIm, bSwap), signRe));
+}
+
+INPUTKERNELS_TARGET_SSE2
+static void mixNcoSse2(float * out, const float * in, const float * rot, uint32_t numIQ, float baseRe, float baseIm)
+{
+    const __m128 base = _mm_set_ps(baseIm, baseRe, baseIm, baseRe);
+    uint32_t n = 0;
+    for ( ; n + 2 <= numIQ; n += 2)
+    {
+        __m128 c = complexMulSse2(base, _mm_loadu_ps(rot + 2*n));
+        _mm_storeu_ps(out + 2*n, complexMulSse2(_mm_loadu_ps(in + 2*n), c));
+    }
+    mixNcoScalar(out + 2*n, in + 2*n, rot + 2*n, numIQ - n, baseRe, baseIm);
+}
+
+// ***************************************************************************
+// AVX2 implementation
+
+INPUTKERNELS_TARGET_AVX2
+static void convertU8Avx2(float * out, const uint8_t * in, uint32_t numIQ, float dcI, float dcQ, int64_t * sumI, int64_t * sumQ)
+{
+    const __m256i offset = _mm256_set1_epi32(128);
+    const __m256 dc = _mm256_setr_ps(dcI, dcQ, dcI, dcQ, dcI, dcQ, dcI, dcQ);
+    while (numIQ >= 8)
+    {
+        uint32_t n = (numIQ > INPUTKERNELS_SUM_BLOCK) ? INPUTKERNELS_SUM_BLOCK : (numIQ & ~7u);
+        __m256i acc = _mm256_setzero_si256();   // [I Q I Q I Q I Q]
+        for (uint32_t k = 0; k < n; k += 8)
+        {   // 8 IQ samples
+            __m256i v0 = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) in)), offset);
+            __m256i v1 = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (in + 8))), offset);
+            acc = _mm256_add_epi32(acc, _mm256_add_epi32(v0, v1));
+            _mm256_storeu_ps(out, _mm256_sub_ps(_mm256_cvtepi32_ps(v0), dc));
+            _mm256_storeu_ps(out + 8, _mm256_sub_ps(_mm256_cvtepi32_ps(v1), dc));
+            in += 16;
+            out += 16;
+        }
+        int32_t s[8];
+        _mm256_storeu_si256((__m256i *) s, acc);
+        *sumI += int64_t(s[0]) + s[2] + s[4] + s[6];
+        *sumQ += int64_t(s[1]) + s[3] + s[5] + s[7];
+        numIQ -= n;
+    }
+    convertU8Scalar(out, in, numIQ, dcI, dcQ, sumI, sumQ);
+}
+
+INPUTKERNELS_TARGET_AVX2
+static void convertS16Avx2(float * out, const int16_t * in, uint32_t numIQ, float dcI, float dcQ, int64_t * sumI, int64_t * sumQ)
+{
+    const __m256 dc = _mm256_setr_ps(dcI, dcQ, dcI, dcQ, dcI, dcQ, dcI, dcQ);
+    while (numIQ >= 8)
+    {
+        uint32_t n = (numIQ > INPUTKERNELS_SUM_BLOCK) ? INPUTKERNELS_SUM_BLOCK : (numIQ & ~7u);
+        __m256i acc = _mm256_setzero_si256();   // [I Q I Q I Q I Q]
+        for (uint32_t k = 0; k < n; k += 8)
+        {   // 8 IQ samples
+            __m256i v0 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) in));
+            __m256i v1 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + 8)));
+            acc = _mm256_add_epi32(acc, _mm256_add_epi32(v0, v1));
+            _mm256_storeu_ps(out, _mm256_sub_ps(_mm256_cvtepi32_ps(v0), dc));
+            _mm256_storeu_ps(out + 8, _mm256_sub_ps(_mm256_cvtepi32_ps(v1), dc));
+            in += 16;
+            out += 16;
+        }
+        int32_t s[8];
+        _mm256_storeu_si256((__m256i *) s, acc);
+        *sumI += int64_t(s[0]) + s[2] + s[4] + s[6];
+        *sumQ += int64_t(s[1]) + s[3] + s[5] + s[7];
+        numIQ -= n;
+    }
+    convertS16Scalar(out, in, numIQ, dcI, dcQ, sumI, sumQ);
+}
+
+INPUTKERNELS_TARGET_AVX2
+static float envelopeU8Avx2(const uint8_t * in, uint32_t len, float level, float cAttack, float cRelease)
+{
+    float cReleaseBlock = envelopeReleaseCoef(cRelease);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i offset = _mm256_set1_epi8(char(0x80));
+    uint32_t numPairs = len / (2*INPUTKERNELS_ENVELOPE_BLOCK);
+    for (uint32_t b = 0; b < numPairs; ++b)
+    {   // two blocks, one in each 128bit lane
+        __m256i x = _mm256_loadu_si256((const __m256i *) in);
+        __m256i a = _mm256_or_si256(_mm256_subs_epu8(x, offset), _mm256_subs_epu8(offset, x));  // |x - 128|
+        __m256i m = _mm256_max_epu8(a, _mm256_srli_si256(a, 8));
+        m = _mm256_max_epu8(m, _mm256_srli_si256(m, 4));
+        m = _mm256_max_epu8(m, _mm256_srli_si256(m, 2));
+        m = _mm256_max_epu8(m, _mm256_srli_si256(m, 1));
+        __m256i s = _mm256_sad_epu8(a, zero);
+
+        int64_t sums[4];
+        _mm256_storeu_si256((__m256i *) sums, s);
+        int max0 = _mm_cvtsi128_si32(_mm256_castsi256_si128(m)) & 0xFF;
+        int max1 = _mm_cvtsi128_si32(_mm256_extracti128_si256(m, 1)) & 0xFF;
+        level = envelopeBlock(level, max0, int(sums[0] + sums[1]), cAttack, cReleaseBlock);
+        level = envelopeBlock(level, max1, int(sums[2] + sums[3]), cAttack, cReleaseBlock);
+        in += 2*INPUTKERNELS_ENVELOPE_BLOCK;
+    }
+    return envelopeU8Sse2(in, len - numPairs * 2*INPUTKERNELS_ENVELOPE_BLOCK, level, cAttack, cRelease);
+}
+
+INPUTKERNELS_TARGET_AVX2
+static void splitIQAvx2(float * even, float * odd, float * abs2Odd, const float * in, uint32_t numPairs)
+{
+    const __m256i abs2Idx = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    uint32_t k = 0;
+    for ( ; k + 4 <= numPairs; k += 4)
+    {   // IQ sample is handled as one 64bit value
+        __m256d a = _mm256_loadu_pd((const double *) in);               // [x0 x1 x2 x3]
+        __m256d b = _mm256_loadu_pd((const double *) (in + 8));         // [x4 x5 x6 x7]
+        __m256d lo = _mm256_unpacklo_pd(a, b);                          // [x0 x4 x2 x6]
+        __m256d hi = _mm256_unpackhi_pd(a, b);                          // [x1 x5 x3 x7]
+        __m256 e = _mm256_castpd_ps(_mm256_permute4x64_pd(lo, 0xD8));   // [x0 x2 x4 x6]
+        __m256 o = _mm256_castpd_ps(_mm256_permute4x64_pd(hi, 0xD8));   // [x1 x3 x5 x7]
+        _mm256_storeu_ps(even, e);
+        _mm256_storeu_ps(odd, o);
+        __m256 sq = _mm256_mul_ps(o, o);
+        __m256 abs2 = _mm256_add_ps(sq, _mm256_permute_ps(sq, _MM_SHUFFLE(2, 3, 0, 1)));
+        _mm_storeu_ps(abs2Odd, _mm256_castps256_ps128(_mm256_permutevar8x32_ps(abs2, abs2Idx)));
+        in += 16;
+        even += 8;
+        odd += 8;
+        abs2Odd += 4;
+    }
+    splitIQSse2(even, odd, abs2Odd, in, numPairs - k);
+}
+
+INPUTKERNELS_TARGET_AVX2
+static void halfbandDS2Avx2(float * out, const float * even, const float * odd, uint32_t numOutIQ, const float * coef, uint32_t numCoef)
+{
+    uint32_t len = 2*(numCoef - 1) - 1;
+    const __m256 center = _mm256_set1_ps(coef[numCoef - 1]);
+    uint32_t k = 0;
+    for ( ; k + 8 <= numOutIQ; k += 8)
+    {   // 8 IQ output samples, two independent accumulators
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        for (uint32_t c = 0; c < numCoef - 1; ++c)
+        {
+            __m256 cf = _mm256_set1_ps(coef[c]);
+            __m256 sum0 = _mm256_add_ps(_mm256_loadu_ps(even + 2*c), _mm256_loadu_ps(even + 2*(len - c)));
+            __m256 sum1 = _mm256_add_ps(_mm256_loadu_ps(even + 2*c + 8), _mm256_loadu_ps(even + 2*(len - c) + 8));
+            acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(sum0, cf));
+            acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(sum1, cf));
+        }
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(odd + 2*(numCoef - 2)), center));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(odd + 2*(numCoef - 2) + 8), center));
+        _mm256_storeu_ps(out, acc0);
+        _mm256_storeu_ps(out + 8, acc1);
+        out += 16;
+        even += 16;
+        odd += 16;
+    }
+    halfbandDS2Sse2(out, even, odd, numOutIQ - k, coef, numCoef);
+}
+
+INPUTKERNELS_TARGET_AVX2
+static uint32_t farrowIntegrateAvx2(float * x, uint32_t stride, float * acc, const float * in, const float * mu, const uint8_t * dump, uint32_t numIQ)
+{
+    static_assert(INPUTKERNELS_FARROW_COEFS == 4, "AVX2 Farrow expects 4 coefficients");
+
+    __m256 a = _mm256_loadu_ps(acc);     // [I*1 Q*1 I*mu Q*mu I*mu^2 Q*mu^2 I*mu^3 Q*mu^3]
+    uint32_t numOut = 0;
+    for (uint32_t k = 0; k < numIQ; ++k)
+    {
+        if (dump[k])
+        {
+            float * xj = x + 2*numOut;
+            __m128 a01 = _mm256_castps256_ps128(a);
+            __m128 a23 = _mm256_extractf128_ps(a, 1);
+            _mm_storel_pi((__m64 *) xj, a01);
+            _mm_storeh_pi((__m64 *) (xj + stride), a01);
+            _mm_storel_pi((__m64 *) (xj + 2*stride), a23);
+            _mm_storeh_pi((__m64 *) (xj + 3*stride), a23);
+            a = _mm256_setzero_ps();
+            numOut += 1;
+        }
+        float mu2 = mu[k] * mu[k];
+        __m256 iq = _mm256_castpd_ps(_mm256_broadcast_sd((const double *) (in + 2*k)));
+        __m256 p = _mm256_setr_ps(1.0f, 1.0f, mu[k], mu[k], mu2, mu2, mu2 * mu[k], mu2 * mu[k]);
+        a = _mm256_add_ps(a, _mm256_mul_ps(iq, p));
+    }
+    _mm256_storeu_ps(acc, a);
+    return numOut;
+}
+
+INPUTKERNELS_TARGET_AVX2
+static void farrowFirAvx2(float * out, const float * x, uint32_t stride, uint32_t numOutIQ, const float * coef, uint32_t numPoly, float gain)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    uint32_t j = 0;
+    for ( ; j + 4 <= numOutIQ; j += 4)
+    {   // 4 IQ output samples
+        __m256 acc = _mm256_setzero_ps();
+        for (int n = numPoly - 1; n >= 0; --n)
+        {
+            const float * xn = x + 2*(j + numPoly - 1 - n);
+            const float * cn = coef + n*INPUTKERNELS_FARROW_COEFS;
+            __m256 t = _mm256_mul_ps(_mm256_loadu_ps(xn), _mm256_set1_ps(cn[0]));
+            t = _mm256_add_ps(t, _mm256_mul_ps(_mm256_loadu_ps(xn + stride), _mm256_set1_ps(cn[1])));
+            t = _mm256_add_ps(t, _mm256_mul_ps(_mm256_loadu_ps(xn + 2*stride), _mm256_set1_ps(cn[2])));
+            t = _mm256_add_ps(t, _mm256_mul_ps(_mm256_loadu_ps(xn + 3*stride), _mm256_set1_ps(cn[3])));
+            acc = _mm256_add_ps(acc, t);
+        }
+        _mm256_storeu_ps(out, _mm256_mul_ps(g, acc));
+        out += 8;
+    }
+    farrowFirSse2(out, x + 2*j, stride, numOutIQ - j, coef, numPoly, gain);
+}
+
+INPUTKERNELS_TARGET_AVX2
+static void convertF32ToS16Avx2(int16_t * out, const float * in, uint32_t len, float scale)
+{
+    const __m256 s = _mm256_set1_ps(scale);
+    const __m256 hi = _mm256_set1_ps(32767.0f);
+    const __m256 lo = _mm256_set1_ps(-32768.0f);
+    uint32_t n = 0;
+    for ( ; n + 16 <= len; n += 16)
+    {
+        __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + n), s), lo), hi);
+        __m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + n + 8), s), lo), hi);
+
+        // pack works within 128bit lanes => restore order of 64bit blocks
+        __m256i p = _mm256_packs_epi32(_mm256_cvttps_epi32(a), _mm256_cvttps_epi32(b));
+        _mm256_storeu_si256((__m256i *) (out + n), _mm256_permute4x64_epi64(p, 0xD8));
+    }
+    convertF32ToS16Sse2(out + n, in + n, len - n, scale);
+}
+
+INPUTKERNELS_TARGET_AVX2
+static void convertS16ToF32Avx2(float * out, const int16_t * in, uint32_t len, float scale)
+{
+    const __m256 s = _mm256_set1_ps(scale);
+    uint32_t n = 0;
+    for ( ; n + 16 <= len; n += 16)
+    {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + n)));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + n + 8)));
+        _mm256_storeu_ps(out + n, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), s));
+        _mm256_storeu_ps(out + n + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), s));
+    }
+    convertS16ToF32Sse2(out + n, in + n, len - n, scale);
+}
+
+INPUTKERNELS_TARGET_AVX2
+static void convertS8ToF32Avx2(float * out, const int8_t * in, uint32_t len, float scale)
+{
+    const __m256 s = _mm256_set1_ps(scale);
+    uint32_t n = 0;
+    for ( ; n + 16 <= len; n += 16)
+    {
+        __m256i lo = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *) (in + n)));
+        __m256i hi = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *) (in + n + 8)));
+        _mm256_storeu_ps(out + n, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), s));
+        _mm256_storeu_ps(out + n + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), s));
+    }
+    convertS8ToF32Sse2(out + n, in + n, len - n, scale);
+}
+
+// complex multiplication of 4 IQ samples, addsub gives the same operation order as scalar code
+INPUTKERNELS_TARGET_AVX2
+static inline __m256 complexMulAvx2(__m256 a, __m256 b)
+{
+    __m256 aRe = _mm256_moveldup_ps(a);
+    __m256 aIm = _mm256_movehdup_ps(a);
+    __m256 bSwap = _mm256_permute_ps(b, 0xB1);
+    return _mm256_addsub_ps(_mm256_mul_ps(aRe, b), _mm256_mul_ps(aIm, bSwap));
+}
+
+INPUTKERNELS_TARGET_AVX2
+static void mixNcoAvx2(float * out, const float * in, const float * rot, uint32_t numIQ, float baseRe, float baseIm)
+{
+    const __m256 base = _mm256_set_ps(baseIm, baseRe, baseIm, baseRe, baseIm, baseRe, baseIm, baseRe);
+    uint32_t n = 0;
+    for ( ; n + 4 <= numIQ; n += 4)
+    {
+        __m256 c = complexMulAvx2(base, _mm256_loadu_ps(rot + 2*n));
+        _mm256_storeu_ps(out + 2*n, complexMulAvx2(_mm256_loadu_ps(in + 2*n), c));
+    }
+    mixNcoSse2(out + 2*n, in + 2*n, rot + 2*n, numIQ - n, baseRe, baseIm);
+}
+#endif // INPUTKERNELS_X86
+
+#if INPUTKERNELS_NEON
+// ***************************************************************************
+// NEON implementation
+
+static void convertU8Neon(float * out, const uint8_t * in, uint32_t numIQ, float dcI, float dcQ, int64_t * sumI, int64_t * sumQ)
+{
+    const uint16x8_t offset = vdupq_n_u16(128);
+    const float dcArr[4] = { dcI, dcQ, dcI, dcQ };
+    const float32x4_t dc = vld1q_f32(dcArr);
+    while (numIQ >= 8)
+    {
+        uint32_t n = (numIQ > INPUTKERNELS_SUM_BLOCK) ? INPUTKERNELS_SUM_BLOCK : (numIQ & ~7u);
+        int32x4_t acc = vdupq_n_s32(0);   // [I Q I Q]
+        for (uint32_t k = 0; k < n; k += 8)
+        {   // 8 IQ samples
+            uint8x16_t x = vld1q_u8(in);
+            int16x8_t lo = vreinterpretq_s16_u16(vsubq_u16(vmovl_u8(vget_low_u8(x)), offset));
+            int16x8_t hi = vreinterpretq_s16_u16(vsubq_u16(vmovl_u8(vget_high_u8(x)), offset));
+            int32x4_t v0 = vmovl_s16(vget_low_s16(lo));
+            int32x4_t v1 = vmovl_s16(vget_high_s16(lo));
+            int32x4_t v2 = vmovl_s16(vget_low_s16(hi));
+            int32x4_t v3 = vmovl_s16(vget_high_s16(hi));
+            acc = vaddq_s32(acc, vaddq_s32(vaddq_s32(v0, v1), vaddq_s32(v2, v3)));
+            vst1q_f32(out, vsubq_f32(vcvtq_f32_s32(v0), dc));
+            vst1q_f32(out + 4, vsubq_f32(vcvtq_f32_s32(v1), dc));
+            vst1q_f32(out + 8, vsubq_f32(vcvtq_f32_s32(v2), dc));
+            vst1q_f32(out + 12, vsubq_f32(vcvtq_f32_s32(v3), dc));
+            in += 16;
+            out += 16;
+        }
+        *sumI += int64_t(vgetq_lane_s32(acc, 0)) + vgetq_lane_s32(acc, 2);
+        *sumQ += int64_t(vgetq_lane_s32(acc, 1)) + vgetq_lane_s32(acc, 3);
+        numIQ -= n;
+    }
+    convertU8Scalar(out, in, numIQ, dcI, dcQ, sumI, sumQ);
+}
+
+static void convertS16Neon(float * out, const int16_t * in, uint32_t numIQ, float dcI, float dcQ, int64_t * sumI, int64_t * sumQ)
+{
+    const float dcArr[4] = { dcI, dcQ, dcI, dcQ };
+    const float32x4_t dc = vld1q_f32(dcArr);
+    while (numIQ >= 4)
+    {
+        uint32_t n = (numIQ > INPUTKERNELS_SUM_BLOCK) ? INPUTKERNELS_SUM_BLOCK : (numIQ & ~3u);
+        int32x4_t acc = vdupq_n_s32(0);   // [I Q I Q]
+        for (uint32_t k = 0; k < n; k += 4)
+        {   // 4 IQ samples
+            int16x8_t x = vld1q_s16(in);
+            int32x4_t v0 = vmovl_s16(vget_low_s16(x));
+            int32x4_t v1 = vmovl_s16(vget_high_s16(x));
+            acc = vaddq_s32(acc, vaddq_s32(v0, v1));
+            vst1q_f32(out, vsubq_f32(vcvtq_f32_s32(v0), dc));
+            vst1q_f32(out + 4, vsubq_f32(vcvtq_f32_s32(v1), dc));
+            in += 8;
+            out += 8;
+        }
+        *sumI += int64_t(vgetq_lane_s32(acc, 0)) + vgetq_lane_s32(acc, 2);
+        *sumQ += int64_t(vgetq_lane_s32(acc, 1)) + vgetq_lane_s32(acc, 3);
+        numIQ -= n;
+    }
+    convertS16Scalar(out, in, numIQ, dcI, dcQ, sumI, sumQ);
+}
+
+static float envelopeU8Neon(const uint8_t * in, uint32_t len, float level, float cAttack, float cRelease)
+{
+    static_assert(INPUTKERNELS_ENVELOPE_BLOCK == 16, "NEON envelope expects 16 values per block");
+
+    float cReleaseBlock = envelopeReleaseCoef(cRelease);
+    const uint8x16_t offset = vdupq_n_u8(128);
+    uint32_t numBlocks = len / INPUTKERNELS_ENVELOPE_BLOCK;
+    for (uint32_t b = 0; b < numBlocks; ++b)
+    {
+        uint8x16_t a = vabdq_u8(vld1q_u8(in), offset);  // |x - 128|
+        level = envelopeBlock(level, vmaxvq_u8(a), vaddlvq_u8(a), cAttack, cReleaseBlock);
+        in += INPUTKERNELS_ENVELOPE_BLOCK;
+    }
+    return envelopeTail(in, len - numBlocks * INPUTKERNELS_ENVELOPE_BLOCK, level, cAttack, cRelease);
+}
+
+static void splitIQNeon(float * even, float * odd, float * abs2Odd, const float * in, uint32_t numPairs)
+{
+    uint32_t k = 0;
+    for ( ; k + 2 <= numPairs; k += 2)
+    {   // IQ sample is handled as one 64bit value
+        float64x2x2_t x = vld2q_f64((const float64_t *) in);   // [x0 x2] [x1 x3]
+        float32x4_t o = vreinterpretq_f32_f64(x.val[1]);
+        vst1q_f32(even, vreinterpretq_f32_f64(x.val[0]));
+        vst1q_f32(odd, o);
+        float32x4_t sq = vmulq_f32(o, o);
+        vst1_f32(abs2Odd, vget_low_f32(vpaddq_f32(sq, sq)));
+        in += 8;
+        even += 4;
+        odd += 4;
+        abs2Odd += 2;
+    }
+    splitIQScalar(even, odd, abs2Odd, in, numPairs - k);
+}
+
+static void halfbandDS2Neon(float * out, const float * even, const float * odd, uint32_t numOutIQ, const float * coef, uint32_t numCoef)
+{
+    uint32_t len = 2*(numCoef - 1) - 1;
+    const float32x4_t center = vdupq_n_f32(coef[numCoef - 1]);
+    uint32_t k = 0;
+    for ( ; k + 4 <= numOutIQ; k += 4)
+    {   // 4 IQ output samples, two independent accumulators
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        for (uint32_t c = 0; c < numCoef - 1; ++c)
+        {
+            float32x4_t sum0 = vaddq_f32(vld1q_f32(even + 2*c), vld1q_f32(even + 2*(len - c)));
+            float32x4_t sum1 = vaddq_f32(vld1q_f32(even + 2*c + 4), vld1q_f32(even + 2*(len - c) + 4));
+            acc0 = vaddq_f32(acc0, vmulq_n_f32(sum0, coef[c]));
+            acc1 = vaddq_f32(acc1, vmulq_n_f32(sum1, coef[c]));
+        }
+        acc0 = vaddq_f32(acc0, vmulq_f32(vld1q_f32(odd + 2*(numCoef - 2)), center));
+        acc1 = vaddq_f32(acc1, vmulq_f32(vld1q_f32(odd + 2*(numCoef - 2) + 4), center));
+        vst1q_f32(out, acc0);
+        vst1q_f32(out + 4, acc1);
+        out += 8;
+        even += 8;
+        odd += 8;
+    }
+    halfbandDS2Scalar(out, even, odd, numOutIQ - k, coef, numCoef);
+}
+
+static uint32_t farrowIntegrateNeon(float * x, uint32_t stride, float * acc, const float * in, const float * mu, const uint8_t * dump, uint32_t numIQ)
+{
+    static_assert(INPUTKERNELS_FARROW_COEFS == 4, "NEON Farrow expects 4 coefficients");
+
+    float32x4_t acc01 = vld1q_f32(acc);        // [I*1 Q*1 I*mu Q*mu]
+    float32x4_t acc23 = vld1q_f32(acc + 4);    // [I*mu^2 Q*mu^2 I*mu^3 Q*mu^3]
+    uint32_t numOut = 0;
+    for (uint32_t k = 0; k < numIQ; ++k)
+    {
+        if (dump[k])
+        {
+            float * xj = x + 2*numOut;
+            vst1_f32(xj, vget_low_f32(acc01));
+            vst1_f32(xj + stride, vget_high_f32(acc01));
+            vst1_f32(xj + 2*stride, vget_low_f32(acc23));
+            vst1_f32(xj + 3*stride, vget_high_f32(acc23));
+            acc01 = vdupq_n_f32(0.0f);
+            acc23 = vdupq_n_f32(0.0f);
+            numOut += 1;
+        }
+        float mu2 = mu[k] * mu[k];
+        float32x2_t iq2 = vld1_f32(in + 2*k);
+        float32x4_t iq = vcombine_f32(iq2, iq2);
+        acc01 = vaddq_f32(acc01, vmulq_f32(iq, vcombine_f32(vdup_n_f32(1.0f), vdup_n_f32(mu[k]))));
+        acc23 = vaddq_f32(acc23, vmulq_f32(iq, vcombine_f32(vdup_n_f32(mu2), vdup_n_f32(mu2 * mu[k]))));
+    }
+    vst1q_f32(acc, acc01);
+    vst1q_f32(acc + 4, acc23);
+    return numOut;
+}
+
+static void farrowFirNeon(float * out, const float * x, uint32_t stride, uint32_t numOutIQ, const float * coef, uint32_t numPoly, float gain)
+{
+    uint32_t j = 0;
+    for ( ; j + 2 <= numOutIQ; j += 2)
+    {   // 2 IQ output samples
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (int n = numPoly - 1; n >= 0; --n)
+        {
+            const float * xn = x + 2*(j + numPoly - 1 - n);
+            const float * cn = coef + n*INPUTKERNELS_FARROW_COEFS;
+            float32x4_t t = vmulq_n_f32(vld1q_f32(xn), cn[0]);
+            t = vaddq_f32(t, vmulq_n_f32(vld1q_f32(xn + stride), cn[1]));
+            t = vaddq_f32(t, vmulq_n_f32(vld1q_f32(xn + 2*stride), cn[2]));
+            t = vaddq_f32(t, vmulq_n_f32(vld1q_f32(xn + 3*stride), cn[3]));
+            acc = vaddq_f32(acc, t);
+        }
+        vst1q_f32(out, vmulq_n_f32(acc, gain));
+        out += 4;
+    }
+    farrowFirScalar(out, x + 2*j, stride, numOutIQ - j, coef, numPoly, gain);
+}
+
+static void convertF32ToS16Neon(int16_t * out, const float * in, uint32_t len, float scale)
+{
+    const float32x4_t hi = vdupq_n_f32(32767.0f);
+    const float32x4_t lo = vdupq_n_f32(-32768.0f);
+    uint32_t n = 0;
+    for ( ; n + 8 <= len; n += 8)
+    {
+        float32x4_t a = vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(in + n), scale), lo), hi);
+        float32x4_t b = vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(in + n + 4), scale), lo), hi);
+        vst1q_s16(out + n, vcombine_s16(vqmovn_s32(vcvtq_s32_f32(a)), vqmovn_s32(vcvtq_s32_f32(b))));
+    }
+    convertF32ToS16Scalar(out + n, in + n, len - n, scale);
+}
+
+static void convertS16ToF32Neon(float * out, const int16_t * in, uint32_t len, float scale)
+{
+    uint32_t n = 0;
+    for ( ; n + 8 <= len; n += 8)
+    {
+        int16x8_t x = vld1q_s16(in + n);
+        vst1q_f32(out + n, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), scale));
+        vst1q_f32(out + n + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), scale));
+    }
+    convertS16ToF32Scalar(out + n, in + n, len - n, scale);
+}
+
+static void convertS8ToF32Neon(float * out, const int8_t * in, uint32_t len, float scale)
+{
+    uint32_t n = 0;
+    for ( ; n + 8 <= len; n += 8)
+    {
+        int16x8_t x = vmovl_s8(vld1_s8(in + n));
+        vst1q_f32(out + n, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), scale));
+        vst1q_f32(out + n + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), scale));
+    }
+    convertS8ToF32Scalar(out + n, in + n, len - n, scale);
+}
+
+static void mixNcoNeon(float * out, const float * in, const float * rot, uint32_t numIQ, float baseRe, float baseIm)
+{
+    uint32_t n = 0;
+    for ( ; n + 4 <= numIQ; n += 4)
+    {   // deinterleaving load => I and Q in separate registers
+        float32x4x2_t r = vld2q_f32(rot + 2*n);
+        float32x4x2_t x = vld2q_f32(in + 2*n);
+        float32x4_t cRe = vsubq_f32(vmulq_n_f32(r.val[0], baseRe), vmulq_n_f32(r.val[1], baseIm));
+        float32x4_t cIm = vaddq_f32(vmulq_n_f32(r.val[1], baseRe), vmulq_n_f32(r.val[0], baseIm));
+        float32x4x2_t y;
+        y.val[0] = vsubq_f32(vmulq_f32(x.val[0], cRe), vmulq_f32(x.val[1], cIm));
+        y.val[1] = vaddq_f32(vmulq_f32(x.val[0], cIm), vmulq_f32(x.val[1], cRe));
+        vst2q_f32(out + 2*n, y);
+    }
+    mixNcoScalar(out + 2*n, in + 2*n, rot + 2*n, numIQ - n, baseRe, baseIm);
+}
+#endif // INPUTKERNELS_NEON
+
+// ***************************************************************************
+// runtime selection
+
+static const InputDeviceKernels kernelsScalar = { convertU8Scalar, convertS16Scalar, envelopeU8Scalar,
+                                                  splitIQScalar, halfbandDS2Scalar, farrowIntegrateScalar, farrowFirScalar,
+                                                  convertF32ToS16Scalar, convertS16ToF32Scalar, convertS8ToF32Scalar,
+                                                  mixNcoScalar, "scalar" };
+#if INPUTKERNELS_X86
+static const InputDeviceKernels kernelsSse2 = { convertU8Sse2, convertS16Sse2, envelopeU8Sse2,
+                                                splitIQSse2, halfbandDS2Sse2, farrowIntegrateSse2, farrowFirSse2,
+                                                convertF32ToS16Sse2, convertS16ToF32Sse2, convertS8ToF32Sse2,
+                                                mixNcoSse2, "SSE2" };
+static const InputDeviceKernels kernelsAvx2 = { convertU8Avx2, convertS16Avx2, envelopeU8Avx2,
+                                                splitIQAvx2, halfbandDS2Avx2, farrowIntegrateAvx2, farrowFirAvx2,
+                                                convertF32ToS16Avx2, convertS16ToF32Avx2, convertS8ToF32Avx2,
+                                                mixNcoAvx2, "AVX2" };
+#endif
+#if INPUTKERNELS_NEON
+static const InputDeviceKernels kernelsNeon = { convertU8Neon, convertS16Neon, envelopeU8Neon,
+                                                splitIQNeon, halfbandDS2Neon, farrowIntegrateNeon, farrowFirNeon,
+                                                convertF32ToS16Neon, convertS16ToF32Neon, convertS8ToF32Neon,
+                                                mixNcoNeon, "NEON" };
+#endif
+
+// float results that can differ in rounding only
+static bool isClose(const float * ref, const float * val, size_t len)
+{
+    for (size_t n = 0; n < len; ++n)
+    {
+        if (std::fabs(val[n] - ref[n]) > 1e-5f * (1.0f + std::fabs(ref[n])))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// compares results with scalar reference
+static bool verifyKernels(const InputDeviceKernels & k)
+{
+    // odd length to test tail processing
+    const uint32_t numIQ = 2*INPUTKERNELS_SUM_BLOCK + 77;
+    std::vector<uint8_t> inU8(2*numIQ);
+    std::vector<int16_t> inS16(2*numIQ);
+    uint32_t lcg = 12345;
+    for (uint32_t n = 0; n < 2*numIQ; ++n)
+    {
+        lcg = lcg * 1664525 + 1013904223;
+        inU8[n] = uint8_t(lcg >> 24);
+        inS16[n] = int16_t(lcg >> 16);
+    }
+
+    std::vector<float> outRef(2*numIQ);
+    std::vector<float> out(2*numIQ);
+    int64_t sumRef[2] = { 0, 0 };
+    int64_t sum[2] = { 0, 0 };
+
+    convertU8Scalar(outRef.data(), inU8.data(), numIQ, 1.25f, -0.5f, &sumRef[0], &sumRef[1]);
+    k.convertU8(out.data(), inU8.data(), numIQ, 1.25f, -0.5f, &sum[0], &sum[1]);
+    if ((0 != memcmp(outRef.data(), out.data(), out.size() * sizeof(float))) || (sumRef[0] != sum[0]) || (sumRef[1] != sum[1]))
+    {
+        return false;
+    }
+
+    convertS16Scalar(outRef.data(), inS16.data(), numIQ, 1.25f, -0.5f, &sumRef[0], &sumRef[1]);
+    k.convertS16(out.data(), inS16.data(), numIQ, 1.25f, -0.5f, &sum[0], &sum[1]);
+    if ((0 != memcmp(outRef.data(), out.data(), out.size() * sizeof(float))) || (sumRef[0] != sum[0]) || (sumRef[1] != sum[1]))
+    {
+        return false;
+    }
+
+    float levelRef = envelopeU8Scalar(inU8.data(), inU8.size() - 3, 10.0f, 0.1f, 0.00005f);
+    float level = k.envelopeU8(inU8.data(), inU8.size() - 3, 10.0f, 0.1f, 0.00005f);
+    if (levelRef != level)
+    {
+        return false;
+    }
+
+    // float input, odd number of pairs to test tail processing
+    const uint32_t numPairs = 1001;
+    std::vector<float> inF(4*numPairs);
+    for (uint32_t n = 0; n < inF.size(); ++n)
+    {
+        inF[n] = float(inS16[n]);
+    }
+    std::vector<float> evenRef(2*numPairs), oddRef(2*numPairs), abs2Ref(numPairs);
+    std::vector<float> even(2*numPairs), odd(2*numPairs), abs2(numPairs);
+    splitIQScalar(evenRef.data(), oddRef.data(), abs2Ref.data(), inF.data(), numPairs);
+    k.splitIQ(even.data(), odd.data(), abs2.data(), inF.data(), numPairs);
+    if ((evenRef != even) || (oddRef != odd) || !isClose(abs2Ref.data(), abs2.data(), numPairs))
+    {
+        return false;
+    }
+
+    // filter output can differ in rounding only (multiply-add contraction)
+    const float coef[] = { 0.01f, -0.05f, 0.3f, 0.5f };
+    const uint32_t numOut = numPairs - 2*(sizeof(coef)/sizeof(coef[0]));
+    k.halfbandDS2(out.data(), even.data(), odd.data(), numOut, coef, sizeof(coef)/sizeof(coef[0]));
+    halfbandDS2Scalar(outRef.data(), even.data(), odd.data(), numOut, coef, sizeof(coef)/sizeof(coef[0]));
+    if (!isClose(outRef.data(), out.data(), 2*numOut))
+    {
+        return false;
+    }
+
+    // Farrow: phases from LCG, dump every 2nd or 3rd sample
+    std::vector<float> mu(numPairs);
+    std::vector<uint8_t> dump(numPairs);
+    for (uint32_t n = 0; n < numPairs; ++n)
+    {
+        mu[n] = float(inU8[n]) / 256.0f;
+        dump[n] = (0 == (n % 3)) || (0 == (inU8[n] & 1));
+    }
+    const uint32_t stride = 2*numPairs;
+    std::vector<float> accRef(2*INPUTKERNELS_FARROW_COEFS, 1.0f), acc(2*INPUTKERNELS_FARROW_COEFS, 1.0f);
+    std::vector<float> xRef(INPUTKERNELS_FARROW_COEFS * stride), x(INPUTKERNELS_FARROW_COEFS * stride);
+    uint32_t numDumpRef = farrowIntegrateScalar(xRef.data(), stride, accRef.data(), inF.data(), mu.data(), dump.data(), numPairs);
+    uint32_t numDump = k.farrowIntegrate(x.data(), stride, acc.data(), inF.data(), mu.data(), dump.data(), numPairs);
+    if ((numDumpRef != numDump) || !isClose(xRef.data(), x.data(), xRef.size()) || !isClose(accRef.data(), acc.data(), acc.size()))
+    {
+        return false;
+    }
+
+    const float coefF[3*INPUTKERNELS_FARROW_COEFS] = { 0.1f, 0.2f, -0.3f, 0.05f, 0.7f, 0.1f, -0.2f, 0.3f, 0.2f, -0.4f, 0.1f, -0.06f };
+    k.farrowFir(out.data(), x.data(), stride, numDump - 2, coefF, 3, 0.8f);
+    farrowFirScalar(outRef.data(), x.data(), stride, numDump - 2, coefF, 3, 0.8f);
+    if (!isClose(outRef.data(), out.data(), 2*(numDump - 2)))
+    {
+        return false;
+    }
+
+    // values out of int16 range test saturation
+    std::vector<int16_t> outS16Ref(inF.size() - 3), outS16(inF.size() - 3);
+    convertF32ToS16Scalar(outS16Ref.data(), inF.data(), outS16Ref.size(), 1.7f);
+    k.convertF32ToS16(outS16.data(), inF.data(), outS16.size(), 1.7f);
+    if (outS16Ref != outS16)
+    {
+        return false;
+    }
+
+    // int to float conversion is exact, multiplication is single rounding => bit-exact results
+    const float scale = 1.0f / 32768.0f;
+    convertS16ToF32Scalar(outRef.data(), inS16.data(), inS16.size() - 5, scale);
+    k.convertS16ToF32(out.data(), inS16.data(), inS16.size() - 5, scale);
+    if (0 != memcmp(outRef.data(), out.data(), (inS16.size() - 5) * sizeof(float)))
+    {
+        return false;
+    }
+    convertS8ToF32Scalar(outRef.data(), (const int8_t *) inU8.data(), inU8.size() - 5, scale);
+    k.convertS8ToF32(out.data(), (const int8_t *) inU8.data(), inU8.size() - 5, scale);
+    if (0 != memcmp(outRef.data(), out.data(), (inU8.size() - 5) * sizeof(float)))
+    {
+        return false;
+    }
+
+    // NCO mixing, normalized input => rounding differences stay within tolerance also near zero
+    std::vector<float> rot(2*numPairs);
+    for (uint32_t n = 0; n < numPairs; ++n)
+    {
+        rot[2*n] = std::cos(0.01f * n);
+        rot[2*n+1] = std::sin(0.01f * n);
+        inF[2*n] *= scale;
+        inF[2*n+1] *= scale;
+    }
+    mixNcoScalar(outRef.data(), inF.data(), rot.data(), numPairs, std::cos(0.3f), std::sin(0.3f));
+    k.mixNco(out.data(), inF.data(), rot.data(), numPairs, std::cos(0.3f), std::sin(0.3f));
+    return isClose(outRef.data(), out.data(), 2*numPairs);
+}
+
+static const InputDeviceKernels & selectKernels()
+{
+    const InputDeviceKernels * k = &kernelsScalar;
+#if INPUTKERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        k = &kernelsAvx2;
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        k = &kernelsSse2;
+    }
+#endif
+#if INPUTKERNELS_NEON
+    k = &kernelsNeon;
+#endif
+
+    if ((k != &kernelsScalar) && !verifyKernels(*k))
+    {
+        qCWarning(inputKernels) << k->name << "kernels do not match scalar reference, using scalar kernels";
+        k = &kernelsScalar;
+    }
+    qCInfo(inputKernels) << "Using" << k->name << "kernels";
+
+    return *k;
+}
+
+const InputDeviceKernels & inputDeviceKernels()
+{
+    static const InputDeviceKernels & kernels = selectKernels();
+    return kernels;
+}
@@ -0,0 +1,93 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef INPUTDEVICEKERNELS_H
+#define INPUTDEVICEKERNELS_H
+
+#include <cstdint>
+
+// Number of values (I or Q) processed as one block by envelope estimation
+#define INPUTKERNELS_ENVELOPE_BLOCK  (16)
+
+// Number of polynomial coefficients of Farrow resampler kernels
+#define INPUTKERNELS_FARROW_COEFS    (4)
+
+// Sample processing kernels used by input devices
+// Vectorized implementation (SSE2/AVX2 on x86, NEON on ARM64) is selected at runtime,
+// scalar implementation is reference and fallback. All implementations give bit-exact results,
+// except for halfband and Farrow filters and NCO mixing where rounding can differ.
+struct InputDeviceKernels
+{
+    // converts numIQ uint8 IQ samples (offset 128) to float and subtracts DC
+    // sum of I and Q values before DC subtraction is added to sumI and sumQ
+    void (*convertU8)(float * out, const uint8_t * in, uint32_t numIQ, float dcI, float dcQ, int64_t * sumI, int64_t * sumQ);
+
+    // the same for int16 IQ samples
+    void (*convertS16)(float * out, const int16_t * in, uint32_t numIQ, float dcI, float dcQ, int64_t * sumI, int64_t * sumQ);
+
+    // signal level estimation of len uint8 values (rectifier, fast attack slow release)
+    // level is updated once per INPUTKERNELS_ENVELOPE_BLOCK values: block maximum is used for attack,
+    // block mean for release with release coefficient compounded over the block
+    // this follows per-sample estimator within 2% for noise-like signals
+    float (*envelopeU8)(const uint8_t * in, uint32_t len, float level, float cAttack, float cRelease);
+
+    // splits numPairs pairs of float IQ samples to even and odd samples (IQ interleaved)
+    // squared magnitude of odd samples is stored to abs2Odd
+    void (*splitIQ)(float * even, float * odd, float * abs2Odd, const float * in, uint32_t numPairs);
+
+    // halfband decimation by 2 of even and odd samples prepared by splitIQ, symmetric filter with zero taps
+    // coef[0 .. numCoef-2] are nonzero taps from the outer one, coef[numCoef-1] is center tap
+    // output k = sum(coef[c] * (even[k+c] + even[k+2*numCoef-3-c])) + coef[numCoef-1] * odd[k+numCoef-2]
+    void (*halfbandDS2)(float * out, const float * even, const float * odd, uint32_t numOutIQ, const float * coef, uint32_t numCoef);
+
+    // integrate and dump part of transposed Farrow resampler
+    // input sample k multiplied by powers of mu[k] is accumulated to acc (IQ interleaved, power 0 first)
+    // if dump[k] is set, acc is stored to x[m*stride + 2*j] (j is output index, m is power) and cleared before sample k is integrated
+    // returns number of dumps
+    uint32_t (*farrowIntegrate)(float * x, uint32_t stride, float * acc, const float * in, const float * mu, const uint8_t * dump, uint32_t numIQ);
+
+    // polynomial filter of dumped values, x contains numPoly-1 previous values in front
+    // output j = gain * sum over n of (sum over m of coef[n][m] * x[m*stride + 2*(j+numPoly-1-n)]), n from numPoly-1 down to 0
+    void (*farrowFir)(float * out, const float * x, uint32_t stride, uint32_t numOutIQ, const float * coef, uint32_t numPoly, float gain);
+
+    // converts len float values multiplied by scale to int16 (truncation, saturation to int16 range)
+    void (*convertF32ToS16)(int16_t * out, const float * in, uint32_t len, float scale);
+
+    // converts len int16 or int8 values to float multiplied by scale
+    void (*convertS16ToF32)(float * out, const int16_t * in, uint32_t len, float scale);
+    void (*convertS8ToF32)(float * out, const int8_t * in, uint32_t len, float scale);
+
+    // frequency shift of numIQ float IQ samples: out[k] = in[k] * (base * rot[k])
+    // rot is table of NCO phasors, base is phasor of the block start, in-place operation is allowed
+    void (*mixNco)(float * out, const float * in, const float * rot, uint32_t numIQ, float baseRe, float baseIm);
+
+    const char * name;
+};
+
+// returns kernels for this CPU, selection is done on the first call
+const InputDeviceKernels & inputDeviceKernels();
+
+#endif // INPUTDEVICEKERNELS_H
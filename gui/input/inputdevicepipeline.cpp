@@ -0,0 +1,324 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <chrono>
+#include <cstring>
+#include <QLoggingCategory>
+#include "inputdevicepipeline.h"
+#include "inputdevice.h"
+#include "inputdevicechannelizer.h"
+#include "inputdevicekernels.h"
+#include "inputdevicesrc.h"
+
+Q_LOGGING_CATEGORY(inputDevicePipeline, "InputDevicePipeline", QtInfoMsg)
+
+InputPipelineStageStats InputPipelineStage::statistics() const
+{
+    return InputPipelineStageStats { name(),
+                                     m_numBlocks.load(std::memory_order_relaxed),
+                                     m_numIQ.load(std::memory_order_relaxed),
+                                     m_timeNs.load(std::memory_order_relaxed) };
+}
+
+InputDevicePipeline::InputDevicePipeline(const QString &name, InputTelemetry *telemetry) : m_name(name), m_telemetry(telemetry)
+{
+}
+
+InputDevicePipeline::~InputDevicePipeline()
+{
+    logStatistics();
+    for (auto stage : m_stages)
+    {
+        delete stage;
+    }
+}
+
+bool InputDevicePipeline::process(const void * data, uint32_t numIQ, InputFifoSampleFormat format)
+{
+    InputPipelineBlock block { static_cast<const uint8_t *>(data), numIQ, format };
+    auto blockStart = std::chrono::steady_clock::now();
+    bool isDropped = false;
+    for (auto stage : m_stages)
+    {
+        uint32_t numInIQ = block.numIQ;
+        auto start = std::chrono::steady_clock::now();
+        bool ret = stage->process(block);
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        // single writer => relaxed load and store are sufficient
+        stage->m_numBlocks.store(stage->m_numBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        stage->m_numIQ.store(stage->m_numIQ.load(std::memory_order_relaxed) + numInIQ, std::memory_order_relaxed);
+        stage->m_timeNs.store(stage->m_timeNs.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+
+        if (!ret)
+        {
+            qCWarning(inputDevicePipeline) << m_name << "dropping" << numIQ << "IQ samples...";
+            isDropped = true;
+            break;
+        }
+    }
+
+    if (nullptr != m_telemetry)
+    {
+        auto end = std::chrono::steady_clock::now();
+        uint64_t gapNs = m_isFirst ? 0 : std::chrono::duration_cast<std::chrono::nanoseconds>(blockStart - m_lastStart).count();
+        m_telemetry->producerCallback(std::chrono::duration_cast<std::chrono::nanoseconds>(end - blockStart).count(), gapNs);
+        m_lastStart = blockStart;
+        m_isFirst = false;
+    }
+
+    return !isDropped;
+}
+
+void InputDevicePipeline::reset()
+{
+    m_isFirst = true;
+    for (auto stage : m_stages)
+    {
+        stage->reset();
+    }
+}
+
+QList<InputPipelineStageStats> InputDevicePipeline::statistics() const
+{
+    QList<InputPipelineStageStats> list;
+    for (auto stage : m_stages)
+    {
+        list.append(stage->statistics());
+    }
+    return list;
+}
+
+void InputDevicePipeline::logStatistics() const
+{
+    for (const auto & stat : statistics())
+    {
+        if (0 == stat.numIQ)
+        {
+            continue;
+        }
+        qCInfo(inputDevicePipeline, "%s %s: %llu blocks, %llu IQ samples, %.1f ms, %.2f ns/IQ",
+               m_name.toLatin1().data(), stat.name.toLatin1().data(),
+               (unsigned long long) stat.numBlocks, (unsigned long long) stat.numIQ, stat.timeNs * 1e-6, double(stat.timeNs) / stat.numIQ);
+    }
+}
+
+//===================================================================================================
+bool InputPipelineLevelU8::process(InputPipelineBlock &block)
+{
+    Q_ASSERT(InputFifoSampleFormat::SAMPLE_FORMAT_U8 == block.format);
+
+    m_level = inputDeviceKernels().envelopeU8(block.data, 2*block.numIQ, m_level, m_cAttack, m_cRelease);
+    return true;
+}
+
+//===================================================================================================
+bool InputPipelineConvertToFloat::process(InputPipelineBlock &block)
+{
+    m_buffer.resize(2*block.numIQ);
+    switch (block.format)
+    {
+    case InputFifoSampleFormat::SAMPLE_FORMAT_S16:
+        inputDeviceKernels().convertS16ToF32(m_buffer.data(), (const int16_t *) block.data, 2*block.numIQ, m_scale);
+        break;
+    case InputFifoSampleFormat::SAMPLE_FORMAT_S8:
+        inputDeviceKernels().convertS8ToF32(m_buffer.data(), (const int8_t *) block.data, 2*block.numIQ, m_scale);
+        break;
+    case InputFifoSampleFormat::SAMPLE_FORMAT_U8:
+    {   // offset is removed by DC subtraction kernel, sums are not used
+        int64_t sumI = 0;
+        int64_t sumQ = 0;
+        inputDeviceKernels().convertU8(m_buffer.data(), block.data, block.numIQ, 0.0f, 0.0f, &sumI, &sumQ);
+        if (1.0f != m_scale)
+        {
+            for (auto & val : m_buffer)
+            {
+                val *= m_scale;
+            }
+        }
+    }
+        break;
+    case InputFifoSampleFormat::SAMPLE_FORMAT_FLOAT:
+        Q_ASSERT(false);   // not supported by this stage
+        return true;
+    }
+    block.data = (const uint8_t *) m_buffer.data();
+    block.format = InputFifoSampleFormat::SAMPLE_FORMAT_FLOAT;
+    return true;
+}
+
+//===================================================================================================
+InputPipelineFifoWriter::InputPipelineFifoWriter(fifo_t *fifo, InputDeviceSRC *src) : m_fifo(fifo), m_src(src)
+{
+}
+
+InputPipelineFifoWriter::~InputPipelineFifoWriter()
+{
+    delete m_src;
+}
+
+void InputPipelineFifoWriter::reset()
+{
+    if (nullptr != m_src)
+    {
+        m_src->reset();
+    }
+}
+
+void InputPipelineFifoWriter::retune(uint32_t frequency, uint64_t staleIQ)
+{
+    std::lock_guard<std::mutex> guard(m_retuneMutex);
+    m_retuneFrequency = frequency;
+    m_retunePos = m_inputIQ.load(std::memory_order_acquire) + staleIQ;
+    m_retunePending.store(true, std::memory_order_release);
+}
+
+uint32_t InputPipelineFifoWriter::staleIQ(const InputPipelineBlock &block)
+{
+    // block covers stream positions [blockPos, blockPos + numIQ)
+    uint64_t blockPos = m_inputIQ.load(std::memory_order_relaxed);
+    m_inputIQ.store(blockPos + block.numIQ, std::memory_order_release);
+    if (!m_retunePending.load(std::memory_order_acquire))
+    {   // no retune pending
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> guard(m_retuneMutex);
+    if (m_retunePos >= blockPos + block.numIQ)
+    {   // whole block is stale
+        return block.numIQ;
+    }
+
+    // first sample after retune is in this block
+    // new FIFO epoch starts exactly at this sample, SRC history is stale too
+    m_retunePending.store(false, std::memory_order_relaxed);
+    reset();
+    m_fifo->startEpoch(m_retuneFrequency);
+    return (m_retunePos > blockPos) ? uint32_t(m_retunePos - blockPos) : 0;
+}
+
+bool InputPipelineFifoWriter::process(InputPipelineBlock &block)
+{
+    uint32_t stale = staleIQ(block);
+    if (stale > 0)
+    {   // stale samples are not written to FIFO
+        block.data += stale * 2 * ComplexFifo::sampleSize(block.format);
+        block.numIQ -= stale;
+        if (0 == block.numIQ)
+        {
+            return true;
+        }
+    }
+
+    if (nullptr != m_src)
+    {   // float IQ samples are resampled to 2048kHz, SRC writes directly to reserved FIFO space
+        Q_ASSERT(InputFifoSampleFormat::SAMPLE_FORMAT_FLOAT == block.format);
+
+        uint64_t maxBytes = m_src->maxOutputSamples(block.numIQ) * 2 * sizeof(float);
+        float * outPtr = (float *) m_fifo->reserve(maxBytes);
+        if (nullptr == outPtr)
+        {   // output size is not known, maximum is reported
+            m_fifo->telemetry().producerDropped(maxBytes);
+            return false;
+        }
+        block.numIQ = m_src->process((float *) block.data, block.numIQ, outPtr);
+        block.data = (const uint8_t *) outPtr;
+        m_fifo->commit(block.numIQ * 2 * sizeof(float));
+        return true;
+    }
+
+    // samples are stored in FIFO as they are, conversion to float and DOC is done by consumer
+    uint64_t bytes = block.numIQ * 2 * ComplexFifo::sampleSize(block.format);
+    uint8_t * outPtr = m_fifo->reserve(bytes);
+    if (nullptr == outPtr)
+    {
+        m_fifo->telemetry().producerDropped(bytes);
+        return false;
+    }
+    if (outPtr != block.data)
+    {   // data were not written in place by device (raw file reader)
+        // source can overlap when beginning of in-place block was stale
+        std::memmove(outPtr, block.data, bytes);
+        block.data = outPtr;
+    }
+    m_fifo->commit(bytes);
+
+    return true;
+}
+
+//===================================================================================================
+InputPipelineChannelizer::InputPipelineChannelizer(InputDeviceChannelizer *channelizer) : m_channelizer(channelizer)
+{
+    m_channelizer->start();
+}
+
+InputPipelineChannelizer::~InputPipelineChannelizer()
+{
+    delete m_channelizer;
+}
+
+void InputPipelineChannelizer::reset()
+{
+    m_channelizer->reset();
+}
+
+bool InputPipelineChannelizer::process(InputPipelineBlock &block)
+{
+    Q_ASSERT(InputFifoSampleFormat::SAMPLE_FORMAT_FLOAT == block.format);
+
+    return m_channelizer->process((const float *) block.data, block.numIQ);
+}
+
+//===================================================================================================
+InputPipelineRecordTap::InputPipelineRecordTap(const std::function<void (const uint8_t *, uint32_t)> &record,
+                                               const std::atomic<bool> &enabled, float int16Scale)
+    : m_record(record)
+    , m_enabled(enabled)
+    , m_int16Scale(int16Scale)
+{
+}
+
+bool InputPipelineRecordTap::process(InputPipelineBlock &block)
+{
+    if (!m_enabled)
+    {
+        return true;
+    }
+
+    if ((InputFifoSampleFormat::SAMPLE_FORMAT_FLOAT == block.format) && (m_int16Scale > 0))
+    {   // dumping in int16
+        m_int16Buf.resize(2*block.numIQ);
+        inputDeviceKernels().convertF32ToS16(m_int16Buf.data(), (const float *) block.data, 2*block.numIQ, m_int16Scale);
+        m_record((const uint8_t *) m_int16Buf.data(), 2*block.numIQ * sizeof(int16_t));
+    }
+    else
+    {   // dumping as it is
+        m_record(block.data, 2*block.numIQ * ComplexFifo::sampleSize(block.format));
+    }
+
+    return true;
+}
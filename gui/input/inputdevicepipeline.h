@@ -0,0 +1,217 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef INPUTDEVICEPIPELINE_H
+#define INPUTDEVICEPIPELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <QList>
+#include <QString>
+#include "inputfifo.h"
+
+// signal level estimation of uint8 samples (RTL-SDR AGC)
+#define INPUTPIPELINE_LEVEL_U8_ATTACK   (0.1)
+#define INPUTPIPELINE_LEVEL_U8_RELEASE  (0.00005)
+
+class InputDeviceSRC;
+class InputDeviceChannelizer;
+
+// Block of samples passed through pipeline stages
+// stage can replace data by its output (e.g. SRC output written to FIFO)
+struct InputPipelineBlock
+{
+    const uint8_t * data;
+    uint32_t numIQ;
+    InputFifoSampleFormat format;
+};
+
+// Statistics of one pipeline stage
+struct InputPipelineStageStats
+{
+    QString name;
+    uint64_t numBlocks;
+    uint64_t numIQ;         // number of input IQ samples
+    uint64_t timeNs;        // processing time
+};
+
+// Common block interface of input processing stages
+class InputPipelineStage
+{
+public:
+    virtual ~InputPipelineStage() {}
+    virtual const char * name() const = 0;
+
+    // resets stage memory
+    virtual void reset() {}
+
+    // processes block of samples, returns false if block was dropped (following stages are not executed)
+    virtual bool process(InputPipelineBlock & block) = 0;
+
+    InputPipelineStageStats statistics() const;
+
+private:
+    friend class InputDevicePipeline;
+
+    // counters are updated by producer thread and can be read from any thread
+    std::atomic<uint64_t> m_numBlocks{0};
+    std::atomic<uint64_t> m_numIQ{0};
+    std::atomic<uint64_t> m_timeNs{0};
+};
+
+// Chain of stages that every input device feeds with raw buffers from its thread
+// the same stages are used by all devices => optimizations land once for all of them,
+// processing time of every stage is measured
+class InputDevicePipeline
+{
+public:
+    // duration of every process() call and time between calls are reported to telemetry if provided
+    explicit InputDevicePipeline(const QString & name, InputTelemetry * telemetry = nullptr);
+    ~InputDevicePipeline();   // statistics are logged
+
+    // adds stage to the end of the chain, pipeline takes ownership
+    template <class T> T * addStage(T * stage) { m_stages.push_back(stage); return stage; }
+
+    // feeds block of numIQ samples, returns false if block was dropped
+    bool process(const void * data, uint32_t numIQ, InputFifoSampleFormat format);
+
+    void reset();
+    QList<InputPipelineStageStats> statistics() const;
+    void logStatistics() const;
+
+private:
+    QString m_name;
+    std::vector<InputPipelineStage *> m_stages;
+    InputTelemetry * m_telemetry;
+    std::chrono::steady_clock::time_point m_lastStart;
+    bool m_isFirst = true;
+};
+
+//===================================================================================================
+// Signal level estimation of uint8 samples (rectifier, fast attack slow release)
+class InputPipelineLevelU8 : public InputPipelineStage
+{
+public:
+    InputPipelineLevelU8(float cAttack = INPUTPIPELINE_LEVEL_U8_ATTACK, float cRelease = INPUTPIPELINE_LEVEL_U8_RELEASE)
+        : m_cAttack(cAttack), m_cRelease(cRelease) {}
+    const char * name() const override { return "LevelU8"; }
+    void reset() override { m_level = 0.0; }
+    bool process(InputPipelineBlock & block) override;
+
+    float signalLevel() const { return m_level; }
+private:
+    float m_level = 0.0;
+    float m_cAttack;
+    float m_cRelease;
+};
+
+//===================================================================================================
+// Converts int16, int8 or uint8 (offset 128) samples to float multiplied by scale (full scale of device => 1.0)
+class InputPipelineConvertToFloat : public InputPipelineStage
+{
+public:
+    explicit InputPipelineConvertToFloat(float scale) : m_scale(scale) {}
+    const char * name() const override { return "ToFloat"; }
+    bool process(InputPipelineBlock & block) override;
+private:
+    float m_scale;
+    std::vector<float> m_buffer;
+};
+
+//===================================================================================================
+// Writes block to input FIFO, optionally through SRC that writes its output directly to FIFO
+// block is replaced by data written to FIFO, following stages see samples exactly as consumer does
+// After retune, stale samples still on their way from device are not written and new FIFO epoch
+// tagged by frequency starts exactly at the first sample after them
+class InputPipelineFifoWriter : public InputPipelineStage
+{
+public:
+    explicit InputPipelineFifoWriter(fifo_t * fifo, InputDeviceSRC * src = nullptr);   // takes ownership of SRC
+    ~InputPipelineFifoWriter();
+    const char * name() const override { return (nullptr != m_src) ? "SRC+FIFO" : "FIFO"; }
+    void reset() override;
+    bool process(InputPipelineBlock & block) override;
+
+    // device was retuned to frequency [kHz], next staleIQ samples entering this stage are stale
+    // (samples buffered or in flight when device was retuned), can be called from any thread
+    void retune(uint32_t frequency, uint64_t staleIQ);
+
+    InputDeviceSRC * src() const { return m_src; }
+private:
+    fifo_t * m_fifo;
+    InputDeviceSRC * m_src;
+
+    // stream position [IQ samples] counts all samples entering this stage
+    std::atomic<uint64_t> m_inputIQ{0};
+
+    // first sample after retune, frequency and position are updated together under mutex
+    std::atomic<bool> m_retunePending{false};
+    std::mutex m_retuneMutex;
+    uint64_t m_retunePos = 0;
+    uint32_t m_retuneFrequency = 0;
+
+    uint32_t staleIQ(const InputPipelineBlock & block);
+};
+
+//===================================================================================================
+// Passes float samples to wideband channelizer, extracted channel is written to FIFO by channelizer
+// this is the last stage of pipeline, block is not modified
+class InputPipelineChannelizer : public InputPipelineStage
+{
+public:
+    explicit InputPipelineChannelizer(InputDeviceChannelizer * channelizer);   // takes ownership, channel worker is started
+    ~InputPipelineChannelizer();
+    const char * name() const override { return "Channelizer"; }
+    void reset() override;
+    bool process(InputPipelineBlock & block) override;
+
+    InputDeviceChannelizer * channelizer() const { return m_channelizer; }
+private:
+    InputDeviceChannelizer * m_channelizer;
+};
+
+//===================================================================================================
+// Recording tap, passes block to recorder when enabled
+// float samples can be converted to int16 (scale > 0)
+class InputPipelineRecordTap : public InputPipelineStage
+{
+public:
+    InputPipelineRecordTap(const std::function<void(const uint8_t *, uint32_t)> & record, const std::atomic<bool> & enabled, float int16Scale = 0);
+    const char * name() const override { return "Record"; }
+    bool process(InputPipelineBlock & block) override;
+private:
+    std::function<void(const uint8_t *, uint32_t)> m_record;
+    const std::atomic<bool> & m_enabled;
+    float m_int16Scale;
+    std::vector<int16_t> m_int16Buf;
+};
+
+#endif // INPUTDEVICEPIPELINE_H
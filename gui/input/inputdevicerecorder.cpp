@@ -27,21 +27,63 @@
 #include <QDir>
 #include <QFileDialog>
 #include <QLoggingCategory>
+#include <cstring>
+#include <limits>
+#include <new>
 #include "inputdevicerecorder.h"
 #include "dabtables.h"
 #include "config.h"
 
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <unistd.h>
+#define INPUTDEVICERECORDER_HAVE_LINUX_IO 1
+#else
+#define INPUTDEVICERECORDER_HAVE_LINUX_IO 0
+#endif
+
+#if defined(Q_OS_WIN)
+#ifndef NOMINMAX
+#define NOMINMAX    // std::numeric_limits<>::max() is used
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
 Q_LOGGING_CATEGORY(inputDeviceRecorder, "InputDeviceRecorder", QtInfoMsg)
 
+// returns size of physical memory in bytes, 0 if it is not known
+static uint64_t physicalMemorySize()
+{
+#if defined(Q_OS_WIN)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status))
+    {
+        return status.ullTotalPhys;
+    }
+    return 0;
+#else
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if ((pages <= 0) || (pageSize <= 0))
+    {
+        return 0;
+    }
+    return uint64_t(pages) * uint64_t(pageSize);
+#endif
+}
+
 InputDeviceRecorder::InputDeviceRecorder()
 {
-    m_file = nullptr;
     m_recordingPath = QDir::homePath();
 }
 
 InputDeviceRecorder::~InputDeviceRecorder()
 {
     stop();
+    delete [] m_ring;
 }
 
 const QString InputDeviceRecorder::recordingPath() const
@@ -56,10 +98,28 @@ void InputDeviceRecorder::setRecordingPath(const QString &recordingPath)
 
 void InputDeviceRecorder::setDeviceDescription(const InputDeviceDescription &desc)
 {
+    std::lock_guard<std::mutex> guard(m_writerMutex);
     m_deviceDescription = desc;
 
-    // 1 / (2 channels(IQ) * channel containerBits/8.0 * sampleRate/1000.0)
-    m_bytes2ms = 8*1000.0/(2 * m_deviceDescription.sample.containerBits * m_deviceDescription.sample.sampleRate);
+    if ((0 == m_deviceDescription.sample.containerBits) || (0 == m_deviceDescription.sample.sampleRate))
+    {   // no device
+        m_bytes2ms = 0.0;
+    }
+    else
+    {
+        // 1 / (2 channels(IQ) * channel containerBits/8.0 * sampleRate/1000.0)
+        m_bytes2ms = 8*1000.0/(2 * m_deviceDescription.sample.containerBits * m_deviceDescription.sample.sampleRate);
+    }
+
+    // ring size depends on sample format
+    if (nullptr == m_writer)
+    {
+        allocRing();
+    }
+    else
+    {
+        m_ringRealloc = true;
+    }
 
     qCDebug(inputDeviceRecorder) << "name:" << m_deviceDescription.device.name;
     qCDebug(inputDeviceRecorder) << "model:" << m_deviceDescription.device.model;
@@ -68,105 +128,383 @@ void InputDeviceRecorder::setDeviceDescription(const InputDeviceDescription &des
     qCDebug(inputDeviceRecorder) << "channelContainer:" << m_deviceDescription.sample.channelContainer;
 }
 
-void InputDeviceRecorder::start(QWidget * callerWidget)
-{  
-    std::lock_guard<std::mutex> guard(m_fileMutex);
-    if (nullptr == m_file)
+void InputDeviceRecorder::setCurrentFrequency(uint32_t frequency)
+{
+    std::lock_guard<std::mutex> guard(m_writerMutex);
+    if ((frequency != m_frequency) && (nullptr == m_writer))
+    {   // pre-trigger data from other channel are not useful
+        m_ringPos = 0;
+        m_ringLen = 0;
+    }
+    m_frequency = frequency;
+}
+
+void InputDeviceRecorder::setPreTriggerSeconds(int sec)
+{
+    sec = qBound(0, sec, INPUTDEVICERECORDER_PRETRIGGER_MAX);
+    bool wasRequired = isCaptureRequired();
     {
-        // dialog needs parrent => prvided from caller widget
-        QString fileName;
-        if (m_xmlHeaderEna)
+        std::lock_guard<std::mutex> guard(m_writerMutex);
+        if (sec == m_preTriggerSec)
         {
-            QString f = QString("%1/%2_%3.uff").arg(m_recordingPath,
-                                                    QDateTime::currentDateTime().toString("yyyy-MM-dd_hhmmss"),
-                                                    DabTables::channelList.value(m_frequency));
-
-            fileName = QFileDialog::getSaveFileName(callerWidget,
-                                                    tr("Record IQ stream (Raw File XML Header)"),
-                                                    QDir::toNativeSeparators(f),
-                                                    tr("Binary XML files")+" (*.uff)");
+            return;
         }
-        else
+        m_preTriggerSec = sec;
+        if (nullptr == m_writer)
         {
-            QString f = QString("%1/%2_%3.raw").arg(m_recordingPath,
-                                                    QDateTime::currentDateTime().toString("yyyy-MM-dd_hhmmss"),
-                                                    DabTables::channelList.value(m_frequency));
-
-            fileName = QFileDialog::getSaveFileName(callerWidget,
-                                                    tr("Record IQ stream"),
-                                                    QDir::toNativeSeparators(f),
-                                                    tr("Binary files")+" (*.raw)");
+            allocRing();
+        }
+        else
+        {   // ring is being written to file
+            m_ringRealloc = true;
         }
-        if (!fileName.isEmpty())
+    }
+    if (wasRequired != isCaptureRequired())
+    {
+        emit captureRequest(isCaptureRequired());
+    }
+}
+
+void InputDeviceRecorder::allocRing()
+{
+    // called with m_writerMutex locked when recording is not running
+    delete [] m_ring;
+    m_ring = nullptr;
+    m_ringSize = 0;
+    m_ringPos = 0;
+    m_ringLen = 0;
+    m_ringRealloc = false;
+
+    bool isLive = (InputDeviceId::UNDEFINED != m_deviceDescription.id) && (InputDeviceId::RAWFILE != m_deviceDescription.id);
+    if ((m_preTriggerSec > 0) && isLive && (m_deviceDescription.sample.containerBits > 0))
+    {
+        uint64_t sampleBytes = 2 * (m_deviceDescription.sample.containerBits / 8);
+        uint64_t size = uint64_t(m_preTriggerSec) * m_deviceDescription.sample.sampleRate * sampleBytes;
+
+        // ring is limited to a fraction of physical memory, it would be swapped out otherwise
+        uint64_t maxSize = physicalMemorySize() / INPUTDEVICERECORDER_PRETRIGGER_MEM_DIV;
+        if ((maxSize > 0) && (size > maxSize))
         {
-            m_bytesRecorded = 0;
-            m_recordingPath = QFileInfo(fileName).path(); // store path for next time
+            size = (maxSize / sampleBytes) * sampleBytes;
+            qCWarning(inputDeviceRecorder) << "Pre-trigger buffer limited to" << (size >> 20) << "MB ("
+                                           << (size / (sampleBytes * m_deviceDescription.sample.sampleRate)) << "sec )";
+        }
 
-            m_file = fopen(QDir::toNativeSeparators(fileName).toUtf8().data(), "wb");
-            if (nullptr != m_file)
-            {
-                startXmlHeader();
-                emit recording(true);
-            }
-            else
-            {   // error
-                emit recording(false);
-            }
+        m_ring = new (std::nothrow) uint8_t[size];
+        if (nullptr == m_ring)
+        {
+            qCWarning(inputDeviceRecorder) << "Unable to allocate pre-trigger buffer of" << (size >> 20) << "MB";
         }
         else
-        {
-            emit recording(false);
+        {   // memory is committed now so that it is not missing later when device thread fills the ring
+            std::memset(m_ring, 0, size);
+            m_ringSize = size;
+            qCInfo(inputDeviceRecorder) << "Pre-trigger buffer" << m_preTriggerSec << "sec," << (size >> 20) << "MB";
         }
     }
+}
+
+void InputDeviceRecorder::writeRing(const uint8_t *buf, uint32_t len)
+{
+    if (len >= m_ringSize)
+    {   // only the newest data fit
+        std::memcpy(m_ring, buf + len - m_ringSize, m_ringSize);
+        m_ringPos = 0;
+        m_ringLen = m_ringSize;
+        return;
+    }
+    uint64_t n = qMin(uint64_t(len), m_ringSize - m_ringPos);
+    std::memcpy(m_ring + m_ringPos, buf, n);
+    std::memcpy(m_ring, buf + n, len - n);
+    m_ringPos = (m_ringPos + len) % m_ringSize;
+    m_ringLen = qMin(m_ringLen + len, m_ringSize);
+}
+
+void InputDeviceRecorder::start(QWidget * callerWidget)
+{  
+    if (nullptr != m_writer)
+    {   /* file is already opened */
+        return;
+    }
+
+    // compression is supported for integer samples only
+    m_isCompressed = m_compressionEna
+                     && ((8 == m_deviceDescription.sample.containerBits) || (16 == m_deviceDescription.sample.containerBits));
+
+    // dialog needs parrent => prvided from caller widget
+    QString fileName;
+    if (m_isCompressed)
+    {
+        QString f = QString("%1/%2_%3.iqz").arg(m_recordingPath,
+                                                QDateTime::currentDateTime().toString("yyyy-MM-dd_hhmmss"),
+                                                DabTables::channelList.value(m_frequency));
+
+        fileName = QFileDialog::getSaveFileName(callerWidget,
+                                                tr("Record IQ stream (Compressed)"),
+                                                QDir::toNativeSeparators(f),
+                                                tr("Compressed IQ files")+" (*.iqz)");
+    }
+    else if (m_xmlHeaderEna)
+    {
+        QString f = QString("%1/%2_%3.uff").arg(m_recordingPath,
+                                                QDateTime::currentDateTime().toString("yyyy-MM-dd_hhmmss"),
+                                                DabTables::channelList.value(m_frequency));
+
+        fileName = QFileDialog::getSaveFileName(callerWidget,
+                                                tr("Record IQ stream (Raw File XML Header)"),
+                                                QDir::toNativeSeparators(f),
+                                                tr("Binary XML files")+" (*.uff)");
+    }
     else
-    { /* file is already opened */ }
+    {
+        QString f = QString("%1/%2_%3.raw").arg(m_recordingPath,
+                                                QDateTime::currentDateTime().toString("yyyy-MM-dd_hhmmss"),
+                                                DabTables::channelList.value(m_frequency));
+
+        fileName = QFileDialog::getSaveFileName(callerWidget,
+                                                tr("Record IQ stream"),
+                                                QDir::toNativeSeparators(f),
+                                                tr("Binary files")+" (*.raw)");
+    }
+    if (fileName.isEmpty())
+    {
+        emit recording(false);
+        return;
+    }
 
-    return;
+    m_recordingPath = QFileInfo(fileName).path(); // store path for next time
+    m_fileName = fileName;
+
+    // all buffers are empty
+    m_buffers.pool = static_cast<uint8_t *>(::operator new[](INPUTDEVICERECORDER_NUM_BUFFERS * INPUTDEVICERECORDER_BUFFER_SIZE,
+                                                             std::align_val_t(INPUTDEVICERECORDER_IO_ALIGN)));
+    m_buffers.fullQueue.clear();
+    m_buffers.freeQueue.clear();
+    m_buffers.fullSem.tryAcquire(m_buffers.fullSem.available());
+    for (int n = 0; n < INPUTDEVICERECORDER_NUM_BUFFERS; ++n)
+    {
+        m_buffers.freeQueue.push(n);
+    }
+
+    InputDeviceRecorderWriter * writer = new InputDeviceRecorderWriter(&m_buffers);
+    if (m_isCompressed)
+    {   // compression runs in writer thread
+        writer->setCompression(m_deviceDescription.sample.containerBits / 8, m_deviceDescription.sample.sampleRate);
+    }
+    if (!writer->open(fileName))
+    {   // error
+        qCWarning(inputDeviceRecorder) << "Unable to open file:" << fileName;
+        delete writer;
+        ::operator delete[](m_buffers.pool, std::align_val_t(INPUTDEVICERECORDER_IO_ALIGN));
+        m_buffers.pool = nullptr;
+        emit recording(false);
+        return;
+    }
+    connect(writer, &InputDeviceRecorderWriter::bytesWrittenChanged, this, &InputDeviceRecorder::onBytesWritten, Qt::QueuedConnection);
+
+    std::lock_guard<std::mutex> guard(m_writerMutex);
+    m_bytesDropped = 0;
+    m_isDropping = false;
+    m_fillIdx = -1;
+    m_fillLen = 0;
+    m_headerBytes = (m_xmlHeaderEna && !m_isCompressed) ? INPUTDEVICERECORDER_XML_PADDING : 0;
+    if (m_xmlHeaderEna || m_isCompressed)
+    {
+        startXmlHeader(m_ringLen);
+    }
+
+    // space for XML header and pre-trigger data precede recorded stream, ring is not modified while recording
+    m_buffers.prefixPadding = m_headerBytes;
+    m_buffers.prefixRing = m_ring;
+    m_buffers.prefixRingSize = m_ringSize;
+    m_buffers.prefixRingStart = (m_ringLen < m_ringSize) ? 0 : m_ringPos;
+    m_buffers.prefixRingLen = m_ringLen;
+    uint64_t prefixLen = m_headerBytes + m_ringLen;
+    m_buffers.prefixWriterLen = prefixLen - prefixLen % INPUTDEVICERECORDER_BUFFER_SIZE;
+    if (prefixLen > m_buffers.prefixWriterLen)
+    {   // the rest is written as part of first buffer => all file writes stay aligned
+        m_buffers.freeQueue.pop(m_fillIdx);
+        m_fillLen = prefixLen - m_buffers.prefixWriterLen;
+        m_buffers.copyPrefix(m_buffers.pool + m_fillIdx * INPUTDEVICERECORDER_BUFFER_SIZE, m_buffers.prefixWriterLen, m_fillLen);
+    }
+    if (m_ringLen > 0)
+    {
+        qCInfo(inputDeviceRecorder) << "Recording starts with" << m_ringLen * m_bytes2ms / 1000.0 << "sec of pre-trigger data";
+    }
+    writer->start(QThread::HighPriority);
+    m_writer = writer;
+
+    emit recording(true);
+    emit captureRequest(true);
 }
 
 void InputDeviceRecorder::stop()
 {
-    std::lock_guard<std::mutex> guard(m_fileMutex);
-    if (nullptr != m_file)
+    InputDeviceRecorderWriter * writer;
     {
-        if (m_xmlHeaderEna)
+        std::lock_guard<std::mutex> guard(m_writerMutex);
+        if (nullptr == m_writer)
         {
-            finishXmlHeader();
+            return;
+        }
+        if ((m_fillIdx >= 0) && (m_fillLen > 0))
+        {   // write partially filled buffer
+            flushFillBuffer();
+        }
+        writer = m_writer;
+        m_writer = nullptr;
+    }
+
+    // writer writes all pending buffers and closes the file
+    writer->stop();
+    writer->wait();
+    uint64_t bytesRecorded = writer->bytesWritten() - m_headerBytes;
+    delete writer;
 
-            // write xml header
+    ::operator delete[](m_buffers.pool, std::align_val_t(INPUTDEVICERECORDER_IO_ALIGN));
+    m_buffers.pool = nullptr;
+
+    QFile file(m_fileName);
+    if (file.open(QIODevice::ReadWrite))
+    {
+        if (m_isCompressed)
+        {   // XML header is always present in compressed container, it follows container header
+            finishXmlHeader(bytesRecorded);
             QByteArray bytearray = m_xmlHeader.toByteArray();
-            fseek(m_file, 0, SEEK_SET);
-            fwrite(bytearray.data(), 1, bytearray.size(), m_file);
+            file.seek(RAWFILECODEC_HEADER_SIZE);
+            file.write(bytearray.data(), qMin(int(bytearray.size()), RAWFILECODEC_XML_SIZE));
+        }
+        else if (m_xmlHeaderEna)
+        {
+            // remove alignment padding of the last write and preallocated space
+            file.resize(m_headerBytes + bytesRecorded);
+            finishXmlHeader(bytesRecorded);
 
-            // add padding
-            int paddingBytes = INPUTDEVICERECORDER_XML_PADDING - bytearray.size();
-            char * padding = new char[paddingBytes];
-            memset(padding, 0, paddingBytes);
-            fwrite(padding, 1, paddingBytes, m_file);
-            delete [] padding;
+            // write xml header, padding was already written
+            QByteArray bytearray = m_xmlHeader.toByteArray();
+            file.seek(0);
+            file.write(bytearray.data(), qMin(int(bytearray.size()), INPUTDEVICERECORDER_XML_PADDING));
+        }
+        else
+        {   // remove alignment padding of the last write and preallocated space
+            file.resize(bytesRecorded);
         }
-        else { /* XML header is not enabled */ }
-        fflush(m_file);
-        fclose(m_file);
-        m_file = nullptr;
+        file.close();
+    }
+    else
+    {
+        qCWarning(inputDeviceRecorder) << "Unable to finish file:" << m_fileName;
+    }
 
-        emit recording(false);
+    if (m_bytesDropped > 0)
+    {
+        qCWarning(inputDeviceRecorder) << "Recording finished," << m_bytesDropped << "bytes were dropped";
     }
+
+    {   // pre-trigger ring starts again, recorded data were saved
+        std::lock_guard<std::mutex> guard(m_writerMutex);
+        if (m_ringRealloc)
+        {
+            allocRing();
+        }
+        m_ringPos = 0;
+        m_ringLen = 0;
+    }
+
+    emit recording(false);
+    emit captureRequest(isCaptureRequired());
 }
 
 void InputDeviceRecorder::writeBuffer(const uint8_t *buf, uint32_t len)
 {
-    std::lock_guard<std::mutex> guard(m_fileMutex);
+    // called from device thread, it never waits for file I/O
+    std::lock_guard<std::mutex> guard(m_writerMutex);
+
+    if (nullptr == m_writer)
+    {
+        if (nullptr != m_ring)
+        {   // not recording => keep recent samples
+            writeRing(buf, len);
+        }
+        return;
+    }
+
+    // whole input buffer is stored or dropped => IQ samples stay aligned in file
+    uint64_t space = m_buffers.freeQueue.size() * uint64_t(INPUTDEVICERECORDER_BUFFER_SIZE);
+    if (m_fillIdx >= 0)
+    {
+        space += INPUTDEVICERECORDER_BUFFER_SIZE - m_fillLen;
+    }
+    if (space < len)
+    {   // writer is late => data are dropped instead of blocking the device
+        m_bytesDropped += len;
+        if (!m_isDropping)
+        {
+            m_isDropping = true;
+            qCWarning(inputDeviceRecorder) << "Disk writing is too slow, dropping recorded data";
+        }
+        return;
+    }
+    m_isDropping = false;
+
+    while (len > 0)
+    {
+        if (m_fillIdx < 0)
+        {
+            m_buffers.freeQueue.pop(m_fillIdx);
+            m_fillLen = 0;
+        }
+        uint32_t n = qMin(len, INPUTDEVICERECORDER_BUFFER_SIZE - m_fillLen);
+        std::memcpy(m_buffers.pool + m_fillIdx * INPUTDEVICERECORDER_BUFFER_SIZE + m_fillLen, buf, n);
+        m_fillLen += n;
+        buf += n;
+        len -= n;
+        if (INPUTDEVICERECORDER_BUFFER_SIZE == m_fillLen)
+        {
+            flushFillBuffer();
+        }
+    }
+}
+
+void InputDeviceRecorder::flushFillBuffer()
+{
+    m_buffers.length[m_fillIdx] = m_fillLen;
+    m_buffers.fullQueue.push(m_fillIdx);
+    m_buffers.fullSem.release();
+    m_fillIdx = -1;
+    m_fillLen = 0;
+}
 
-    if (nullptr != m_file)
+void InputDeviceRecorderBuffers::copyPrefix(uint8_t *dst, uint64_t offset, uint32_t len) const
+{
+    while (len > 0)
     {
-        ssize_t bytes = fwrite(buf, 1, len, m_file);
-        m_bytesRecorded += bytes;
-        emit bytesRecorded(m_bytesRecorded, m_bytesRecorded * m_bytes2ms);
+        uint32_t n;
+        if (offset < prefixPadding)
+        {
+            n = qMin(uint64_t(len), prefixPadding - offset);
+            std::memset(dst, 0, n);
+        }
+        else
+        {
+            uint64_t pos = (prefixRingStart + offset - prefixPadding) % prefixRingSize;
+            n = qMin(uint64_t(len), prefixRingSize - pos);
+            std::memcpy(dst, prefixRing + pos, n);
+        }
+        dst += n;
+        offset += n;
+        len -= n;
     }
 }
 
-void InputDeviceRecorder::startXmlHeader()
+void InputDeviceRecorder::onBytesWritten(uint64_t bytes)
+{
+    uint64_t bytesRecorded = (bytes > m_headerBytes) ? (bytes - m_headerBytes) : 0;
+    emit bytesDropped(m_bytesDropped);
+    emit bytesRecorded(bytesRecorded, bytesRecorded * m_bytes2ms);
+}
+
+void InputDeviceRecorder::startXmlHeader(uint64_t preTriggerBytes)
 {
     QDomDocument xmlHeader;
     QDomProcessingInstruction header = xmlHeader.createProcessingInstruction("xml", "version=\"1.0\" encoding=\"utf-8\"");
@@ -185,7 +523,7 @@ void InputDeviceRecorder::startXmlHeader()
     root.appendChild(device);
 
     QDomElement time = xmlHeader.createElement("Time");
-    time.setAttribute("Value", QDateTime::currentDateTimeUtc().toString("yyyy-MM-dd hh:mm:ss"));
+    time.setAttribute("Value", QDateTime::currentDateTimeUtc().addMSecs(-qint64(preTriggerBytes * m_bytes2ms)).toString("yyyy-MM-dd hh:mm:ss"));
     time.setAttribute("Unit", "UTC");
     root.appendChild(time);
 
@@ -216,12 +554,12 @@ void InputDeviceRecorder::startXmlHeader()
     m_xmlHeader = xmlHeader;
 }
 
-void InputDeviceRecorder::finishXmlHeader()
+void InputDeviceRecorder::finishXmlHeader(uint64_t bytesRecorded)
 {
     QDomElement datablocks = m_xmlHeader.createElement("Datablocks");
     QDomElement datablock = m_xmlHeader.createElement("Datablock");
     datablock.setAttribute("Number", "1");
-    datablock.setAttribute("Count", QString("%1").arg(8 * m_bytesRecorded/m_deviceDescription.sample.containerBits));
+    datablock.setAttribute("Count", QString("%1").arg(8 * bytesRecorded/m_deviceDescription.sample.containerBits));
     datablock.setAttribute("Unit", "Channel");
     datablock.setAttribute("Offset", QString("%1").arg(INPUTDEVICERECORDER_XML_PADDING));
 
@@ -235,3 +573,263 @@ void InputDeviceRecorder::finishXmlHeader()
     datablocks.appendChild(datablock);
     m_xmlHeader.childNodes().at(1).appendChild(datablocks);
 }
+
+InputDeviceRecorderWriter::InputDeviceRecorderWriter(InputDeviceRecorderBuffers *buffers, QObject *parent)
+    : QThread(parent)
+    , m_buffers(buffers)
+{
+}
+
+InputDeviceRecorderWriter::~InputDeviceRecorderWriter()
+{
+    m_file.close();
+    delete m_encoder;
+}
+
+void InputDeviceRecorderWriter::setCompression(int sampleSize, uint32_t sampleRate)
+{
+    delete m_encoder;
+    m_encoder = new RawFileEncoder(sampleSize);
+    m_codecHeader = RawFileCodecHeader();
+    m_codecHeader.sampleSize = sampleSize;
+    m_codecHeader.sampleRate = sampleRate;
+    m_blockBuffer.resize(RAWFILECODEC_BLOCK_IQ * 2 * sampleSize);
+    m_blockBytes = 0;
+    m_blockOffsets.clear();
+}
+
+bool InputDeviceRecorderWriter::open(const QString &fileName)
+{
+    m_bytesWritten = 0;
+    m_bytesAllocated = 0;
+    m_isDirectIO = false;
+
+#if INPUTDEVICERECORDER_HAVE_LINUX_IO
+    QByteArray name = QFile::encodeName(fileName);
+    int fd = -1;
+#if INPUTDEVICERECORDER_DIRECT_IO
+    if (nullptr == m_encoder)
+    {   // page cache is bypassed => long recordings do not push other data out of memory
+        // compressed blocks have variable size, they are written through page cache
+        fd = ::open(name.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+        m_isDirectIO = (fd >= 0);
+    }
+#endif
+    if (fd < 0)
+    {   // O_DIRECT is not supported by file system
+        fd = ::open(name.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (!m_file.open(fd, QIODevice::WriteOnly | QIODevice::Unbuffered, QFileDevice::AutoCloseHandle))
+    {
+        ::close(fd);
+        return false;
+    }
+    qCInfo(inputDeviceRecorder) << "Recording to" << fileName << (m_isDirectIO ? "using direct I/O" : "");
+#else
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered))
+    {
+        return false;
+    }
+#endif
+
+    if (nullptr != m_encoder)
+    {   // container header and XML header are written when recording is finished
+        QByteArray header(RAWFILECODEC_DATA_OFFSET, 0);
+        m_filePos = m_file.write(header);
+        return (RAWFILECODEC_DATA_OFFSET == m_filePos);
+    }
+    return true;
+}
+
+void InputDeviceRecorderWriter::stop()
+{
+    m_stopRequest = true;
+    m_buffers->fullSem.release();
+}
+
+void InputDeviceRecorderWriter::run()
+{
+    bool isError = !writePrefix();
+    if (isError)
+    {
+        qCCritical(inputDeviceRecorder) << "Error writing file:" << m_file.errorString();
+    }
+    while (1)
+    {
+        m_buffers->fullSem.acquire();
+
+        int idx;
+        if (!m_buffers->fullQueue.pop(idx))
+        {   // all buffers are written
+            if (m_stopRequest)
+            {
+                break;
+            }
+            continue;
+        }
+
+        uint8_t * buf = m_buffers->pool + idx * INPUTDEVICERECORDER_BUFFER_SIZE;
+        uint32_t len = m_buffers->length[idx];
+        if (!isError)
+        {
+            isError = (nullptr != m_encoder) ? !writeCompressed(buf, len) : !writeBuffer(buf, len);
+            if (isError)
+            {
+                qCCritical(inputDeviceRecorder) << "Error writing file:" << m_file.errorString();
+            }
+        }
+        else { /* data are discarded after error */ }
+
+        m_buffers->freeQueue.push(idx);
+        emit bytesWrittenChanged(m_bytesWritten);
+    }
+
+    if ((nullptr != m_encoder) && !isError && !finishCompressed())
+    {
+        qCCritical(inputDeviceRecorder) << "Error writing file:" << m_file.errorString();
+    }
+    m_file.close();
+}
+
+bool InputDeviceRecorderWriter::writePrefix()
+{
+    if (0 == m_buffers->prefixWriterLen)
+    {
+        return true;
+    }
+
+    // pre-trigger data are copied from ring to aligned buffer, whole buffers are written
+    uint8_t * buf = static_cast<uint8_t *>(::operator new[](INPUTDEVICERECORDER_BUFFER_SIZE, std::align_val_t(INPUTDEVICERECORDER_IO_ALIGN)));
+    bool isOK = true;
+    for (uint64_t offset = 0; isOK && (offset < m_buffers->prefixWriterLen); offset += INPUTDEVICERECORDER_BUFFER_SIZE)
+    {
+        m_buffers->copyPrefix(buf, offset, INPUTDEVICERECORDER_BUFFER_SIZE);
+        isOK = (nullptr != m_encoder) ? writeCompressed(buf, INPUTDEVICERECORDER_BUFFER_SIZE) : writeBuffer(buf, INPUTDEVICERECORDER_BUFFER_SIZE);
+        emit bytesWrittenChanged(m_bytesWritten);
+    }
+    ::operator delete[](buf, std::align_val_t(INPUTDEVICERECORDER_IO_ALIGN));
+
+    return isOK;
+}
+
+bool InputDeviceRecorderWriter::writeBuffer(uint8_t *buf, uint32_t len)
+{
+#if INPUTDEVICERECORDER_HAVE_LINUX_IO
+    if (m_bytesAllocated < qint64(m_bytesWritten + len))
+    {   // preallocation reduces file fragmentation and metadata updates, failure is not an error
+        // file is truncated to recorded size when recording is finished
+        if (0 == fallocate(m_file.handle(), 0, m_bytesAllocated, INPUTDEVICERECORDER_PREALLOC))
+        {
+            m_bytesAllocated += INPUTDEVICERECORDER_PREALLOC;
+        }
+        else
+        {   // not supported => do not try again
+            m_bytesAllocated = std::numeric_limits<qint64>::max();
+        }
+    }
+#endif
+
+    uint32_t writeLen = len;
+    if (m_isDirectIO && (len % INPUTDEVICERECORDER_IO_ALIGN))
+    {   // last buffer, O_DIRECT needs aligned size => padding is removed when recording is finished
+        writeLen = (len + INPUTDEVICERECORDER_IO_ALIGN - 1) & ~(INPUTDEVICERECORDER_IO_ALIGN - 1);
+        std::memset(buf + len, 0, writeLen - len);
+    }
+
+    qint64 written = m_file.write(reinterpret_cast<const char *>(buf), writeLen);
+#if INPUTDEVICERECORDER_HAVE_LINUX_IO
+    if ((written < 0) && m_isDirectIO)
+    {   // file system rejected direct I/O => continue with buffered I/O
+        qCInfo(inputDeviceRecorder) << "Direct I/O not supported, using buffered I/O";
+        m_isDirectIO = false;
+        int flags = fcntl(m_file.handle(), F_GETFL);
+        fcntl(m_file.handle(), F_SETFL, flags & ~O_DIRECT);
+        writeLen = len;
+        written = m_file.write(reinterpret_cast<const char *>(buf), writeLen);
+    }
+#endif
+    if (written != qint64(writeLen))
+    {
+        return false;
+    }
+    m_bytesWritten += len;
+    return true;
+}
+
+bool InputDeviceRecorderWriter::writeCompressed(const uint8_t *buf, uint32_t len)
+{
+    while (len > 0)
+    {
+        uint32_t n = qMin(len, uint32_t(m_blockBuffer.size()) - m_blockBytes);
+        std::memcpy(m_blockBuffer.data() + m_blockBytes, buf, n);
+        m_blockBytes += n;
+        buf += n;
+        len -= n;
+        m_bytesWritten += n;
+        if ((m_blockBytes == m_blockBuffer.size()) && !encodeBlock())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool InputDeviceRecorderWriter::encodeBlock()
+{
+    uint32_t numIQ = m_blockBytes / (2 * m_codecHeader.sampleSize);
+    if (0 == numIQ)
+    {
+        return true;
+    }
+
+    m_encoded.clear();
+    uint32_t bytes = m_encoder->encodeBlock(m_blockBuffer.data(), numIQ, m_encoded);
+    if (m_file.write(reinterpret_cast<const char *>(m_encoded.data()), bytes) != qint64(bytes))
+    {
+        return false;
+    }
+    m_blockOffsets.push_back(m_filePos);
+    m_filePos += bytes;
+    m_codecHeader.numIQ += numIQ;
+    m_blockBytes = 0;
+
+    return true;
+}
+
+bool InputDeviceRecorderWriter::finishCompressed()
+{
+    // last incomplete block
+    if (!encodeBlock())
+    {
+        return false;
+    }
+
+    // block index
+    std::vector<uint8_t> index(m_blockOffsets.size() * sizeof(uint64_t));
+    for (size_t n = 0; n < m_blockOffsets.size(); ++n)
+    {
+        for (int b = 0; b < 8; ++b)
+        {
+            index[n * sizeof(uint64_t) + b] = uint8_t(m_blockOffsets[n] >> (8*b));
+        }
+    }
+    if (m_file.write(reinterpret_cast<const char *>(index.data()), index.size()) != qint64(index.size()))
+    {
+        return false;
+    }
+    m_codecHeader.numBlocks = m_blockOffsets.size();
+    m_codecHeader.indexOffset = m_filePos;
+
+    qCInfo(inputDeviceRecorder) << "Compressed recording:" << uint64_t(m_bytesWritten) << "bytes =>" << m_filePos + index.size() << "bytes";
+
+    // container header
+    uint8_t header[RAWFILECODEC_HEADER_SIZE];
+    m_codecHeader.serialize(header);
+    return m_file.seek(0) && (m_file.write(reinterpret_cast<const char *>(header), RAWFILECODEC_HEADER_SIZE) == RAWFILECODEC_HEADER_SIZE);
+}
+
@@ -28,11 +28,117 @@
 #define INPUTDEVICERECORDER_H
 
 #include <QObject>
+#include <QThread>
+#include <QSemaphore>
+#include <QFile>
 #include <mutex>
+#include <atomic>
 #include <QDomDocument>
 #include "inputdevice.h"
+#include "rawfilecodec.h"
 
 #define INPUTDEVICERECORDER_XML_PADDING 2048
+#define INPUTDEVICERECORDER_BUFFER_SIZE (1 << 20)       // recorded data are written to file in blocks of this size
+#define INPUTDEVICERECORDER_NUM_BUFFERS (32)            // must be power of 2, writer can be late by NUM_BUFFERS * BUFFER_SIZE bytes
+#define INPUTDEVICERECORDER_PREALLOC    (256 << 20)     // file space is preallocated in steps (Linux)
+#define INPUTDEVICERECORDER_DIRECT_IO   1               // write with O_DIRECT if supported by file system (Linux)
+#define INPUTDEVICERECORDER_IO_ALIGN    (4096)          // alignment of buffers and write size for O_DIRECT
+#define INPUTDEVICERECORDER_PRETRIGGER_MAX (600)        // maximum pre-trigger buffer length in seconds
+#define INPUTDEVICERECORDER_PRETRIGGER_MEM_DIV (4)      // pre-trigger buffer can use at most 1/DIV of physical memory
+
+// Lock-free single producer single consumer queue of buffer indexes
+class InputDeviceRecorderQueue
+{
+public:
+    bool push(int idx)
+    {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if ((head - m_tail.load(std::memory_order_acquire)) >= INPUTDEVICERECORDER_NUM_BUFFERS)
+        {   // full
+            return false;
+        }
+        m_items[head & (INPUTDEVICERECORDER_NUM_BUFFERS - 1)] = idx;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    bool pop(int & idx)
+    {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (m_head.load(std::memory_order_acquire) == tail)
+        {   // empty
+            return false;
+        }
+        idx = m_items[tail & (INPUTDEVICERECORDER_NUM_BUFFERS - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    uint32_t size() const { return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire); }
+
+    // only when neither producer nor consumer is running
+    void clear() { m_head = 0; m_tail = 0; }
+private:
+    std::atomic<uint32_t> m_head{0};
+    std::atomic<uint32_t> m_tail{0};
+    int m_items[INPUTDEVICERECORDER_NUM_BUFFERS];
+};
+
+// Buffers shared by device thread (producer) and writer thread (consumer)
+struct InputDeviceRecorderBuffers
+{
+    uint8_t * pool = nullptr;                           // NUM_BUFFERS * BUFFER_SIZE bytes
+    uint32_t length[INPUTDEVICERECORDER_NUM_BUFFERS];   // valid bytes in buffer
+    InputDeviceRecorderQueue fullQueue;                 // buffers to be written
+    InputDeviceRecorderQueue freeQueue;                 // empty buffers
+    QSemaphore fullSem;                                 // number of buffers in fullQueue
+
+    // data preceding the recorded stream: [XML header padding][pre-trigger ring]
+    // writer writes first prefixWriterLen bytes (whole buffers), the rest is copied to first buffer in the pool
+    uint32_t prefixPadding = 0;
+    const uint8_t * prefixRing = nullptr;
+    uint64_t prefixRingSize = 0;                        // ring capacity
+    uint64_t prefixRingStart = 0;                       // position of the oldest byte in ring
+    uint64_t prefixRingLen = 0;                         // valid bytes in ring
+    uint64_t prefixWriterLen = 0;
+    void copyPrefix(uint8_t * dst, uint64_t offset, uint32_t len) const;
+};
+
+class InputDeviceRecorderWriter : public QThread
+{
+    Q_OBJECT
+public:
+    explicit InputDeviceRecorderWriter(InputDeviceRecorderBuffers * buffers, QObject *parent = nullptr);
+    ~InputDeviceRecorderWriter();
+    void setCompression(int sampleSize, uint32_t sampleRate);
+    bool open(const QString & fileName);
+    void stop();
+    uint64_t bytesWritten() const { return m_bytesWritten; }
+protected:
+    void run() override;
+signals:
+    void bytesWrittenChanged(uint64_t bytes);
+private:
+    InputDeviceRecorderBuffers * m_buffers;
+    QFile m_file;
+    bool m_isDirectIO = false;
+    std::atomic<bool> m_stopRequest = false;
+    std::atomic<uint64_t> m_bytesWritten = 0;
+    qint64 m_bytesAllocated = 0;
+
+    // compressed container
+    RawFileEncoder * m_encoder = nullptr;
+    RawFileCodecHeader m_codecHeader;
+    std::vector<uint8_t> m_blockBuffer;
+    uint32_t m_blockBytes = 0;
+    std::vector<uint8_t> m_encoded;
+    std::vector<uint64_t> m_blockOffsets;
+    qint64 m_filePos = 0;
+
+    bool writeBuffer(uint8_t * buf, uint32_t len);
+    bool writePrefix();
+    bool writeCompressed(const uint8_t * buf, uint32_t len);
+    bool encodeBlock();
+    bool finishCompressed();
+};
 
 class InputDeviceRecorder : public QObject
 {
@@ -46,24 +152,50 @@ public:
     void start(QWidget *callerWidget);
     void stop();
     void writeBuffer(const uint8_t *buf, uint32_t len);
-    void setCurrentFrequency(uint32_t frequency) { m_frequency = frequency; }
+    void setCurrentFrequency(uint32_t frequency);
     void setXmlHeaderEnabled(bool ena) { m_xmlHeaderEna = ena; }
+    void setCompressionEnabled(bool ena) { m_compressionEna = ena; }
+    void setPreTriggerSeconds(int sec);
+    bool isCaptureRequired() const { return (nullptr != m_writer) || (nullptr != m_ring); }
 signals:
     void recording(bool isActive);
+    void captureRequest(bool ena);      // device shall provide samples (recording or pre-trigger buffer)
     void bytesRecorded(uint64_t bytes, uint64_t ms);
+    void bytesDropped(uint64_t bytes);
 
 private:
     InputDeviceDescription m_deviceDescription;
-    FILE * m_file;
-    std::mutex m_fileMutex;
-    uint64_t m_bytesRecorded = 0;
-    float m_bytes2ms;
-    uint32_t m_frequency;
+    QString m_fileName;
+    InputDeviceRecorderWriter * m_writer = nullptr;
+    InputDeviceRecorderBuffers m_buffers;
+    std::mutex m_writerMutex;       // protects writer start/stop, never locked during file I/O
+    int m_fillIdx = -1;             // buffer that is being filled by device thread
+    uint32_t m_fillLen = 0;
+    uint32_t m_headerBytes = 0;     // XML header padding at the beginning of file
+    std::atomic<uint64_t> m_bytesDropped = 0;
+    bool m_isDropping = false;
+    float m_bytes2ms = 0.0;
+    uint32_t m_frequency = 0;
     QString m_recordingPath;
     bool m_xmlHeaderEna = true;
+    bool m_compressionEna = false;
+    bool m_isCompressed = false;    // current recording is compressed
     QDomDocument m_xmlHeader;
-    void startXmlHeader();
-    void finishXmlHeader();
+
+    // pre-trigger ring of recent samples, filled by device thread when not recording
+    int m_preTriggerSec = 0;
+    uint8_t * m_ring = nullptr;
+    uint64_t m_ringSize = 0;
+    uint64_t m_ringPos = 0;         // write position
+    uint64_t m_ringLen = 0;         // valid bytes
+    bool m_ringRealloc = false;     // ring size changed during recording
+
+    void allocRing();
+    void writeRing(const uint8_t * buf, uint32_t len);
+    void startXmlHeader(uint64_t preTriggerBytes);
+    void finishXmlHeader(uint64_t bytesRecorded);
+    void flushFillBuffer();
+    void onBytesWritten(uint64_t bytes);
 };
 
 #endif // INPUTDEVICERECORDER_H
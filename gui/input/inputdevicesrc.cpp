@@ -24,174 +24,205 @@
  * SOFTWARE.
  */
 
-#include <QDebug>
+#include <QLoggingCategory>
 #include "inputdevicesrc.h"
+#include "inputdevicekernels.h"
 #include <cmath>
 #include <cstring>
 
+Q_LOGGING_CATEGORY(inputDeviceSRC, "InputDeviceSRC", QtInfoMsg)
+
 InputDeviceSRC::InputDeviceSRC(float inputSampleRate)
 {
-    if (2048e3 == inputSampleRate)
+    // decimation planner: halfband stages while rate is at least 2x output rate
+    // halfband stage is cheap (symmetric, every other coefficient is zero) => fractional resampling is done at the lowest possible rate
+    m_ratio = INPUTDEVICESRC_OUTPUT_RATE / inputSampleRate;
+    float rate = inputSampleRate;
+    QString plan = QString::number(rate*0.001) + "kHz";
+    while (rate >= 2*INPUTDEVICESRC_OUTPUT_RATE)
     {
-        m_filter = new InputDeviceSRCPassthrough();
+        m_stages.push_back(new InputDeviceSRCFilterDS2(rate));
+        rate = rate / 2;
+        plan += QString(" -> DS2 -> %1kHz").arg(rate*0.001);
     }
-    else if (2*2048e3 == inputSampleRate)
+
+    if (INPUTDEVICESRC_OUTPUT_RATE != rate)
     {
-        m_filter = new InputDeviceSRCFilterDS2();
+        m_stages.push_back(new InputDeviceSRCFilterFarrow(rate));
+        plan += QString(" -> Farrow -> %1kHz").arg(INPUTDEVICESRC_OUTPUT_RATE*0.001);
+    }
+    else if (m_stages.empty())
+    {   // input rate is equal to output rate, level estimation only
+        m_stages.push_back(new InputDeviceSRCPassthrough());
+        plan += " -> Passthrough";
     }
-    else
+    else { /* decimation by power of 2 */ }
+
+    if (m_stages.size() > 1)
     {
-        m_filter = new InputDeviceSRCFilterFarrow(inputSampleRate);
+        m_stageBuffer[0] = new float[CHUNK];
+        m_stageBuffer[1] = new float[CHUNK];
     }
+    qCInfo(inputDeviceSRC) << "Resampling:" << plan.toLatin1().data();
 }
 
 InputDeviceSRC::~InputDeviceSRC()
 {
-    delete m_filter;
+    for (auto stage : m_stages)
+    {
+        delete stage;
+    }
+    delete [] m_stageBuffer[0];
+    delete [] m_stageBuffer[1];
 }
 
 void InputDeviceSRC::reset()
 {
-    m_filter->reset();
+    for (auto stage : m_stages)
+    {
+        stage->reset();
+    }
 }
 
 void InputDeviceSRC::resetSignalLevel(float resetVal)
 {
-    m_filter->resetSignalLevel(resetVal);
+    m_stages.front()->resetSignalLevel(resetVal);
 }
 
 float InputDeviceSRC::signalLevel() const
 {
-    return m_filter->signalLevel();
+    return m_stages.front()->signalLevel();
+}
+
+int InputDeviceSRC::maxOutputSamples(int numInDataIQ) const
+{
+    // every stage can produce one extra sample depending on its state (DS2 carry, Farrow phase)
+    return static_cast<int>(std::ceil(numInDataIQ * m_ratio)) + static_cast<int>(m_stages.size());
 }
 
 int InputDeviceSRC::process(float inDataIQ[], int numInDataIQ, float outDataIQ[])
 {
-    return m_filter->process(inDataIQ, numInDataIQ, outDataIQ);
+    if (1 == m_stages.size())
+    {   // single stage, no intermediate buffers
+        return m_stages.front()->process(inDataIQ, numInDataIQ, outDataIQ);
+    }
+
+    int numOutDataIQ = 0;
+    for (int n = 0; n < numInDataIQ; n += CHUNK)
+    {
+        int len = (numInDataIQ - n < CHUNK) ? (numInDataIQ - n) : CHUNK;
+
+        // output of every stage is input of next one, last stage writes to output buffer
+        float * in = inDataIQ + 2*n;
+        for (size_t s = 0; s < m_stages.size(); ++s)
+        {
+            float * out = (s + 1 < m_stages.size()) ? m_stageBuffer[s & 1] : (outDataIQ + 2*numOutDataIQ);
+            len = m_stages[s]->process(in, len, out);
+            in = out;
+        }
+        numOutDataIQ += len;
+    }
+
+    return numOutDataIQ;
 }
 
 //===================================================================================================
 // DS2 filter designed for downsampling from 4096kHz to 2048kHz
 
-InputDeviceSRCFilterDS2::InputDeviceSRCFilterDS2()
+InputDeviceSRCFilterDS2::InputDeviceSRCFilterDS2(float inputSampleRate)
 {
-    m_bufferI = new float[2*m_taps];
-    m_bufferQ = new float[2*m_taps];
-    m_bufferPtrI = m_bufferI;
-    m_bufferPtrQ = m_bufferQ;
+    m_even = new float[2*(HISTORY + BLOCK)];
+    m_odd = new float[2*(HISTORY + BLOCK)];
+    m_abs2 = new float[BLOCK];
 
-    m_catt = 1 - std::exp(-1/(INPUTDEVICESRC_LEVEL_ATTACK * 2048e3));
-    m_crel = 1 - std::exp(-1/(INPUTDEVICESRC_LEVEL_RELEASE * 2048e3));
+    // level is estimated from odd samples => rate is inputSampleRate/2
+    m_catt = 1 - std::exp(-1/(INPUTDEVICESRC_LEVEL_ATTACK * inputSampleRate/2));
+    m_crel = 1 - std::exp(-1/(INPUTDEVICESRC_LEVEL_RELEASE * inputSampleRate/2));
 
     InputDeviceSRCFilterDS2::reset();
 }
 
 InputDeviceSRCFilterDS2::~InputDeviceSRCFilterDS2()
 {
-    delete [] m_bufferI;
-    delete [] m_bufferQ;
+    delete [] m_even;
+    delete [] m_odd;
+    delete [] m_abs2;
 }
 
 void InputDeviceSRCFilterDS2::reset()
 {
     resetSignalLevel();
 
-    m_bufferPtrI = m_bufferI;
-    m_bufferPtrQ = m_bufferQ;
-    for (int n = 0; n < 2*m_taps; ++n)
-    {
-        m_bufferI[n] = 0;
-        m_bufferQ[n] = 0;
-    }
+    std::memset(m_even, 0, 2*HISTORY*sizeof(float));
+    std::memset(m_odd, 0, 2*HISTORY*sizeof(float));
+    m_hasCarry = false;
 }
 
 int InputDeviceSRCFilterDS2::process(float inDataIQ[], int numInDataIQ, float outDataIQ[])
 {
-    float level = m_signalLevel;
-
-    float * bufPtrI = m_bufferPtrI;
-    float * bufPtrQ = m_bufferPtrQ;
-
-    for (int n = 0; n<numInDataIQ/2; ++n)
+    if (numInDataIQ <= 0)
     {
-        float * fwdI = bufPtrI;
-        float * revI = bufPtrI + m_taps;
-        float * fwdQ = bufPtrQ;
-        float * revQ = bufPtrQ + m_taps;
-
-
-        *fwdI++ = *inDataIQ;
-        *revI = *inDataIQ++;
-        *fwdQ++ = *inDataIQ;
-        *revQ = *inDataIQ++;
+        return 0;
+    }
 
-        float accI = 0;
-        float accQ = 0;
+    const InputDeviceKernels & kernels = inputDeviceKernels();
+    float level = m_signalLevel;
 
-        for (int c = 0; c < (m_taps+1)/4; ++c)
-        {
-            accI += (*fwdI + *revI) * m_coef[c];
-            fwdI += 2;  // every other coeff is zero
-            revI -= 2;  // every other coeff is zero
-            accQ += (*fwdQ + *revQ) * m_coef[c];
-            fwdQ += 2;  // every other coeff is zero
-            revQ -= 2;  // every other coeff is zero
+    int carry = m_hasCarry ? 1 : 0;
+    int numOutDataIQ = (numInDataIQ + carry)/2;
+    for (int n = 0; n < numOutDataIQ; n += BLOCK)
+    {
+        int len = (numOutDataIQ - n < BLOCK) ? (numOutDataIQ - n) : BLOCK;
+
+        if (carry)
+        {   // first pair is completed by sample kept from previous call
+            m_even[2*HISTORY] = m_carry[0];
+            m_even[2*HISTORY + 1] = m_carry[1];
+            m_odd[2*HISTORY] = inDataIQ[0];
+            m_odd[2*HISTORY + 1] = inDataIQ[1];
+            m_abs2[0] = inDataIQ[0] * inDataIQ[0] + inDataIQ[1] * inDataIQ[1];
+            inDataIQ += 2;
         }
 
-        accI += *(fwdI-1) * m_coef[(m_taps+1)/4];
-        accQ += *(fwdQ-1) * m_coef[(m_taps+1)/4];
-
-        *outDataIQ++ = accI;
-        *outDataIQ++ = accQ;
-
-        bufPtrQ += 1;
-        if (++bufPtrI == m_bufferI + m_taps)
-        {
-            bufPtrI = m_bufferI;
-            bufPtrQ = m_bufferQ;
-        }
+        // new samples follow history
+        kernels.splitIQ(m_even + 2*(HISTORY + carry), m_odd + 2*(HISTORY + carry), m_abs2 + carry, inDataIQ, len - carry);
+        kernels.halfbandDS2(outDataIQ, m_even, m_odd, len, m_coef, m_numCoef);
+        inDataIQ += 4*(len - carry);
+        outDataIQ += 2*len;
+        carry = 0;
 
 #if (INPUTDEVICESRC_LEVEL_ESTIMATION > 0)
-        float abs2 = (*inDataIQ) * (*inDataIQ);  // I*I
-
-        // insert to delay line
-        *(bufPtrI + m_taps) = *inDataIQ;           // I
-        *bufPtrI++ = *inDataIQ++;                // I
-
-        abs2 += (*inDataIQ) * (*inDataIQ);       // Q*Q
-
-        // insert to delay line
-        *(bufPtrQ + m_taps) = *inDataIQ;           // Q
-        *bufPtrQ++ = *inDataIQ++;                // Q
-
-        // calculate signal level (rectifier, fast attack slow release)
-        float c = m_crel;
-        if (abs2 > level)
+        // calculate signal level (rectifier, fast attack slow release) from odd samples
+        for (int k = 0; k < len; ++k)
         {
-            c = m_catt;
+            float abs2 = m_abs2[k];
+            float c = m_crel;
+            if (abs2 > level)
+            {
+                c = m_catt;
+            }
+            level = c * abs2 + level - c * level;
         }
-        level = c * abs2 + level - c * level;
-#else
-        // insert new samples to delay line
-        *(bufPtrI + taps) = *inDataIQ;    // I
-        *bufPtrI++ = *inDataIQ++;         // I
-        *(bufPtrQ + taps) = *inDataIQ;    // Q
-        *bufPtrQ++ = *inDataIQ++;         // Q
 #endif
-        if (bufPtrI == m_bufferI + m_taps)
-        {
-            bufPtrI = m_bufferI;
-            bufPtrQ = m_bufferQ;
-        }
+
+        // keep history for next block
+        std::memmove(m_even, m_even + 2*len, 2*HISTORY*sizeof(float));
+        std::memmove(m_odd, m_odd + 2*len, 2*HISTORY*sizeof(float));
     }
 
-    m_bufferPtrI = bufPtrI;
-    m_bufferPtrQ = bufPtrQ;
+    // odd number of samples => keep last one for next call
+    m_hasCarry = (0 != ((numInDataIQ + (m_hasCarry ? 1 : 0)) & 1));
+    if (m_hasCarry)
+    {
+        m_carry[0] = inDataIQ[0];
+        m_carry[1] = inDataIQ[1];
+    }
+    else { /* all samples consumed */ }
 
     // store signal level
     m_signalLevel = level;
 
-    return numInDataIQ/2;
+    return numOutDataIQ;
 }
 
 //===================================================================================================
@@ -200,18 +231,25 @@ int InputDeviceSRCFilterDS2::process(float inDataIQ[], int numInDataIQ, float ou
 InputDeviceSRCFilterFarrow::InputDeviceSRCFilterFarrow(float inputSampleRate)
 {
     // output FS is fixed to 2048kHz
-    m_R = 2048e3 / inputSampleRate;
+    m_R = INPUTDEVICESRC_OUTPUT_RATE / inputSampleRate;
 
     // calculate catt and crel
     m_catt = 1 - std::exp(-1/(INPUTDEVICESRC_LEVEL_ATTACK * inputSampleRate));
     m_crel = 1 - std::exp(-1/(INPUTDEVICESRC_LEVEL_RELEASE * inputSampleRate));
 
+    static_assert(POLY_COEFS == INPUTKERNELS_FARROW_COEFS, "Farrow kernels expect different number of coefficients");
+    m_x = new float[POLY_COEFS * 2*(HISTORY + BLOCK)];
+    m_phase = new float[BLOCK];
+    m_dump = new uint8_t[BLOCK];
+
     InputDeviceSRCFilterFarrow::reset();
 }
 
 InputDeviceSRCFilterFarrow::~InputDeviceSRCFilterFarrow()
 {
-
+    delete [] m_x;
+    delete [] m_phase;
+    delete [] m_dump;
 }
 
 void InputDeviceSRCFilterFarrow::reset()
@@ -230,9 +268,80 @@ void InputDeviceSRCFilterFarrow::reset()
         m_yI[n] = 0.0;
         m_yQ[n] = 0.0;
     }
+
+    for (int m = 0; m < 2*POLY_COEFS; ++m)
+    {
+        m_acc[m] = 0.0;
+    }
+    for (int m = 0; m < POLY_COEFS; ++m)
+    {
+        std::memset(m_x + m * 2*(HISTORY + BLOCK), 0, 2*HISTORY*sizeof(float));
+    }
 }
 
 int InputDeviceSRCFilterFarrow::process(float inDataIQ[], int numInDataIQ, float outDataIQ[])
+{
+#if (INPUTDEVICESRC_FARROW_REFERENCE > 0)
+    return processReference(inDataIQ, numInDataIQ, outDataIQ);
+#else
+    const InputDeviceKernels & kernels = inputDeviceKernels();
+    const uint32_t stride = 2*(HISTORY + BLOCK);
+    float level = m_signalLevel;
+    float mu = m_mu;
+    int numOutDataIQ = 0;
+
+    for (int n = 0; n < numInDataIQ; n += BLOCK)
+    {
+        int len = (numInDataIQ - n < BLOCK) ? (numInDataIQ - n) : BLOCK;
+
+        // fractional phases and dump conditions, there is at most one output per input sample
+        for (int k = 0; k < len; ++k)
+        {
+            mu = mu - m_R;
+            m_dump[k] = (mu < 0);
+            if (m_dump[k])
+            {
+                mu = mu + 1.0;
+            }
+            m_phase[k] = mu;
+
+#if (INPUTDEVICESRC_LEVEL_ESTIMATION > 0)
+            float abs2 = inDataIQ[2*k] * inDataIQ[2*k] + inDataIQ[2*k + 1] * inDataIQ[2*k + 1];
+
+            // calculate signal level (rectifier, fast attack slow release)
+            float c = m_crel;
+            if (abs2 > level)
+            {
+                c = m_catt;
+            }
+            level = c * abs2 + level - c * level;
+#endif
+        }
+
+        // integrate and dump, then polynomial filter for all outputs of the block
+        uint32_t numOut = kernels.farrowIntegrate(m_x + 2*HISTORY, stride, m_acc, inDataIQ, m_phase, m_dump, len);
+        kernels.farrowFir(outDataIQ, m_x, stride, numOut, &m_coef[0][0], NUM_POLY, m_R);
+        inDataIQ += 2*len;
+        outDataIQ += 2*numOut;
+        numOutDataIQ += numOut;
+
+        // keep history for next block
+        for (int m = 0; m < POLY_COEFS; ++m)
+        {
+            std::memmove(m_x + m*stride, m_x + m*stride + 2*numOut, 2*HISTORY*sizeof(float));
+        }
+    }
+
+    m_mu = mu;
+
+    // store signal level
+    m_signalLevel = level;
+
+    return numOutDataIQ;
+#endif
+}
+
+int InputDeviceSRCFilterFarrow::processReference(float inDataIQ[], int numInDataIQ, float outDataIQ[])
 {
     float level = m_signalLevel;
     int numOutDataIQ = 0;
@@ -28,14 +28,19 @@
 #define INPUTDEVICESRC_H
 
 #include <cstdint>
+#include <vector>
 
 #define INPUTDEVICESRC_LEVEL_ESTIMATION 1
 #define INPUTDEVICESRC_LEVEL_ATTACK  5e-5    // 50 usec
 #define INPUTDEVICESRC_LEVEL_RELEASE 5e-2    // 50 msec
+#define INPUTDEVICESRC_FARROW_REFERENCE 0    // 1 = sample by sample Farrow implementation (reference), 0 = block processing
+#define INPUTDEVICESRC_OUTPUT_RATE (2048e3)
 
 class InputDeviceSRCFilter;
 
 // this class is used by input devices
+// input rate is reduced by chain of halfband DS2 stages while it is at least 2x output rate,
+// remaining fractional ratio is handled by Farrow filter running at the lowest possible rate
 class InputDeviceSRC
 {
 public:
@@ -45,10 +50,21 @@ public:
     void resetSignalLevel(float resetVal = 0.0);
     float signalLevel() const;
 
+    // maximum number of output samples produced from numInDataIQ input samples
+    int maxOutputSamples(int numInDataIQ) const;
+
     // processing - returns number of output samples
     int process(float inDataIQ[], int numInDataIQ, float outDataIQ[]);
 private:
-    InputDeviceSRCFilter * m_filter = nullptr;
+    enum { CHUNK = 16384 };   // max number of input IQ samples processed by the chain at once
+
+    // stages of the chain, signal level is estimated by the first stage (full input rate)
+    std::vector<InputDeviceSRCFilter *> m_stages;
+
+    // intermediate buffers (ping-pong) between stages, CHUNK/2 IQ samples each
+    float * m_stageBuffer[2] = { nullptr, nullptr };
+
+    float m_ratio;   // FSout/FSin
 };
 
 class InputDeviceSRCFilter
@@ -74,22 +90,28 @@ protected:
 
 //===================================================================================================
 // DS2 filter designed for downsampling from 4096kHz to 2048kHz
+// transition band scales with the rate => it is usable for any input rate >= 4096kHz
 class InputDeviceSRCFilterDS2 : public InputDeviceSRCFilter
 {
 public:
-    InputDeviceSRCFilterDS2();
+    InputDeviceSRCFilterDS2(float inputSampleRate = 2*INPUTDEVICESRC_OUTPUT_RATE);
     ~InputDeviceSRCFilterDS2();
     void reset() override;
 
     // processing -  - returns number of output samples
     int process(float inDataIQ[], int numInDataIQ, float outDataIQ[]) override;
 private:
-    enum { FILTER_ORDER = 42 };
+    enum { FILTER_ORDER = 42, HISTORY = FILTER_ORDER/2, BLOCK = 4096 };
 
-    float * m_bufferPtrI;
-    float * m_bufferPtrQ;
-    float * m_bufferI;
-    float * m_bufferQ;
+    // input samples are split to even and odd samples (IQ interleaved), HISTORY samples from previous call
+    // precede new samples => filter works on contiguous blocks of memory
+    float * m_even;
+    float * m_odd;
+    float * m_abs2;
+
+    // odd number of input samples => last sample is kept for next call
+    bool m_hasCarry;
+    float m_carry[2];
 
     // level filter
     float m_catt;
@@ -97,7 +119,8 @@ private:
 
     // Halfband FIR, fixed coeffs, designed for downsampling 4096kHz -> 2048kHz
     static const int_fast8_t m_taps = FILTER_ORDER + 1;
-    constexpr static const float m_coef[(FILTER_ORDER+2)/4 + 1] =
+    static const int m_numCoef = (FILTER_ORDER+2)/4 + 1;
+    constexpr static const float m_coef[m_numCoef] =
     {
          0.000223158782894952853123604619156594708,
         -0.00070774549637065342286290636764078954,
@@ -127,6 +150,10 @@ public:
     int process(float inDataIQ[], int numInDataIQ, float outDataIQ[]) override;
 private:
     enum { POLY_COEFS = 4, NUM_POLY = 6 };  // M = 4, N = 6
+    enum { HISTORY = NUM_POLY - 1, BLOCK = 4096 };
+
+    // reference implementation, sample by sample
+    int processReference(float inDataIQ[], int numInDataIQ, float outDataIQ[]);
 
     // level filter
     float m_catt;
@@ -139,6 +166,14 @@ private:
     float m_yQ[NUM_POLY];
     float m_R;   // FSout/FSin
 
+    // block processing: fractional phases and dump flags are precomputed for block of input samples,
+    // integrated values are stored for each output (HISTORY values from previous block in front)
+    // and polynomial filter is evaluated for all outputs of the block
+    float m_acc[2*POLY_COEFS];
+    float * m_x;            // POLY_COEFS arrays of IQ interleaved values, 2*(HISTORY + BLOCK) floats each
+    float * m_phase;
+    uint8_t * m_dump;
+
     constexpr static const float m_coef[NUM_POLY][POLY_COEFS] =
     {
         {   0.001667349914006070960362,  0.032712194697834547085780, -0.146457831613232558609639,  0.004040531324696360060411  },
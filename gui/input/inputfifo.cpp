@@ -0,0 +1,585 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstring>
+#include <thread>
+#include <QLoggingCategory>
+#include "inputfifo.h"
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)
+#define INPUT_FIFO_HAVE_MMAP 1
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#if !defined(__linux__)
+#include <cstdio>
+#endif
+#else
+#define INPUT_FIFO_HAVE_MMAP 0
+#include <new>
+#endif
+
+// huge page size used for rounding of FIFO size
+#define INPUT_FIFO_HUGE_PAGE_SIZE (2*1024*1024)
+#define INPUT_FIFO_PAGE_SIZE      (64*1024)
+
+Q_LOGGING_CATEGORY(inputFifo, "InputFifo", QtInfoMsg)
+
+void InputFifoEvent::wait(uint32_t expected)
+{
+#if defined(__linux__)
+    // returns immediately if value already changed
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&m_value), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this, expected]() { return m_value.load(std::memory_order_acquire) != expected; });
+#endif
+}
+
+void InputFifoEvent::notify()
+{
+#if defined(__linux__)
+    m_value.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&m_value), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_value.fetch_add(1, std::memory_order_release);
+    }
+    m_condition.notify_all();
+#endif
+}
+
+ComplexFifo::~ComplexFifo()
+{
+    unmap(m_storage.exchange(nullptr));
+}
+
+bool ComplexFifo::alloc(int chunkMs, int numChunks, bool hugePages, InputFifoSampleFormat format)
+{
+    chunkMs = (chunkMs < INPUT_CHUNK_MS_MIN) ? INPUT_CHUNK_MS_MIN : ((chunkMs > INPUT_CHUNK_MS_MAX) ? INPUT_CHUNK_MS_MAX : chunkMs);
+    numChunks = (numChunks < INPUT_FIFO_CHUNKS_MIN) ? INPUT_FIFO_CHUNKS_MIN : ((numChunks > INPUT_FIFO_CHUNKS_MAX) ? INPUT_FIFO_CHUNKS_MAX : numChunks);
+
+    uint64_t chunkBytes = uint64_t(chunkMs) * 2048 * 2 * sampleSize(format);
+
+    // size is rounded to page size so that it can be mapped
+    uint64_t pageSize = hugePages ? INPUT_FIFO_HUGE_PAGE_SIZE : INPUT_FIFO_PAGE_SIZE;
+    uint64_t size = ((chunkBytes * numChunks + pageSize - 1) / pageSize) * pageSize;
+
+    InputFifoStorage * storage = nullptr;
+    if (m_mirroringEna && hugePages)
+    {   // huge pages may not be available => normal pages are tried then
+        storage = mapMirrored(size, true);
+    }
+    if (m_mirroringEna && (nullptr == storage))
+    {
+        storage = mapMirrored(size, false);
+    }
+    if (nullptr == storage)
+    {   // fallback: linear buffer followed by guard area
+        uint64_t maxSpan = (2 * chunkBytes > INPUT_FIFO_MIN_SPAN) ? (2 * chunkBytes) : INPUT_FIFO_MIN_SPAN;
+        storage = mapLinear(size, maxSpan, hugePages);
+        if (nullptr == storage)
+        {
+            qCCritical(inputFifo) << "Failed to allocate" << size << "bytes";
+            return false;
+        }
+    }
+    m_chunkMs = chunkMs;
+    m_numChunks = numChunks;
+    m_hugePages = hugePages;
+
+    // format is stored between two resets (see setSampleFormat())
+    reset();
+    m_sampleFormat.store(format, std::memory_order_release);
+    m_docEna.store(false, std::memory_order_release);
+
+    qCInfo(inputFifo, "Allocated %llu bytes (%d x %d ms chunks of %u-byte samples), %s, %s", static_cast<unsigned long long>(storage->size),
+           numChunks, chunkMs, sampleSize(format),
+           storage->isMirrored ? "mirrored" : "linear", storage->isHugePages ? "huge pages" : "normal pages");
+    if (hugePages && !storage->isHugePages)
+    {   // huge pages are reserved by vm.nr_hugepages (mirrored or linear buffer) or provided as transparent huge pages (linear buffer)
+        qCWarning(inputFifo) << "Huge pages requested but not available, normal pages are used";
+    }
+
+    // discard content - indexes are free running, only flush index is moved
+    reset();
+
+    InputFifoStorage * old = m_storage.exchange(storage, std::memory_order_seq_cst);
+    if (nullptr != old)
+    {   // wait until consumer finishes access to old storage
+        while (m_hazard.load(std::memory_order_seq_cst) == old)
+        {
+            std::this_thread::yield();
+        }
+        unmap(old);
+    }
+    return true;
+}
+
+void ComplexFifo::deallocate()
+{
+    InputFifoStorage * old = m_storage.exchange(nullptr, std::memory_order_seq_cst);
+    if (nullptr != old)
+    {
+        reset();
+        while (m_hazard.load(std::memory_order_seq_cst) == old)
+        {
+            std::this_thread::yield();
+        }
+        unmap(old);
+    }
+}
+
+bool ComplexFifo::setSampleFormat(InputFifoSampleFormat format, bool docEna)
+{
+    bool ret = true;
+    if (sampleSize(format) != sampleSize())
+    {   // FIFO size depends on sample size
+        ret = alloc(m_chunkMs, m_numChunks, m_hugePages, format);
+    }
+
+    // samples in FIFO have different meaning now
+    // format is stored between two resets => consumer that sees the same reset count before and after reading data
+    // has read format valid for the data
+    reset();
+    m_sampleFormat.store(format, std::memory_order_release);
+    m_docEna.store(docEna && (InputFifoSampleFormat::SAMPLE_FORMAT_FLOAT != format), std::memory_order_release);
+    reset();
+    return ret;
+}
+
+uint32_t ComplexFifo::sampleSize(InputFifoSampleFormat format)
+{
+    switch (format)
+    {
+    case InputFifoSampleFormat::SAMPLE_FORMAT_FLOAT:
+        return sizeof(float);
+    case InputFifoSampleFormat::SAMPLE_FORMAT_S16:
+        return sizeof(int16_t);
+    case InputFifoSampleFormat::SAMPLE_FORMAT_U8:
+        return sizeof(uint8_t);
+    case InputFifoSampleFormat::SAMPLE_FORMAT_S8:
+        return sizeof(int8_t);
+    }
+    return sizeof(float);
+}
+
+uint64_t ComplexFifo::size() const
+{
+    InputFifoStorage * storage = m_storage.load(std::memory_order_acquire);
+    return (nullptr != storage) ? storage->size : 0;
+}
+
+uint64_t ComplexFifo::maxSpan() const
+{
+    InputFifoStorage * storage = m_storage.load(std::memory_order_acquire);
+    return (nullptr != storage) ? storage->maxSpan : 0;
+}
+
+bool ComplexFifo::isMirrored() const
+{
+    InputFifoStorage * storage = m_storage.load(std::memory_order_acquire);
+    return (nullptr != storage) && storage->isMirrored;
+}
+
+uint8_t * ComplexFifo::writePtr() const
+{
+    InputFifoStorage * storage = m_storage.load(std::memory_order_acquire);
+    return storage->buffer + (m_head.load(std::memory_order_relaxed) % storage->size);
+}
+
+uint8_t * ComplexFifo::reserve(uint64_t bytes) const
+{
+    InputFifoStorage * storage = m_storage.load(std::memory_order_acquire);
+    if ((nullptr == storage) || (bytes > storage->maxSpan) || (space() < bytes))
+    {   // not allocated, request is too big or FIFO is full
+        return nullptr;
+    }
+    return storage->buffer + (m_head.load(std::memory_order_relaxed) % storage->size);
+}
+
+InputFifoStorage * ComplexFifo::mapMirrored(uint64_t size, bool hugePages)
+{
+#if INPUT_FIFO_HAVE_MMAP
+    // create anonymous shared memory object
+#if defined(__linux__)
+    // huge pages require reserved pages (vm.nr_hugepages)
+    int fd = memfd_create("abracadabra-fifo", MFD_CLOEXEC | (hugePages ? MFD_HUGETLB : 0));
+#else
+    if (hugePages)
+    {   // not supported
+        return nullptr;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "/abracadabra-fifo-%d", int(getpid()));
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0)
+    {   // only file descriptor is needed
+        shm_unlink(name);
+    }
+#endif
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    if (ftruncate(fd, size) != 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    // reserve address space for two copies and map the object twice back-to-back
+    // huge page mapping must be aligned to huge page size => address space is reserved with margin and trimmed
+    uint64_t align = hugePages ? INPUT_FIFO_HUGE_PAGE_SIZE : 0;
+    if ((0 != align) && (0 != (size % align)))
+    {   // object size is not multiple of huge page size
+        close(fd);
+        return nullptr;
+    }
+    uint8_t * reserved = (uint8_t *) mmap(nullptr, 2*size + align, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == reserved)
+    {
+        close(fd);
+        return nullptr;
+    }
+    uint8_t * base = reserved;
+    if (0 != align)
+    {
+        base = (uint8_t *) ((uintptr_t(reserved) + align - 1) & ~uintptr_t(align - 1));
+        if (base > reserved)
+        {
+            munmap(reserved, base - reserved);
+        }
+        if (reserved + align > base)
+        {
+            munmap(base + 2*size, (reserved + align) - base);
+        }
+    }
+    void * first = mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    void * second = mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    close(fd);  // mappings keep the object alive
+
+    if ((first != base) || (second != base + size))
+    {
+        munmap(base, 2*size);
+        return nullptr;
+    }
+
+    return new InputFifoStorage { base, size, size, 2*size, true, hugePages };
+#else
+    (void) size;
+    (void) hugePages;
+    return nullptr;
+#endif
+}
+
+InputFifoStorage * ComplexFifo::mapLinear(uint64_t size, uint64_t maxSpan, bool hugePages)
+{
+    uint64_t mapSize = size + maxSpan;
+#if INPUT_FIFO_HAVE_MMAP
+    bool isHugePages = false;
+    void * base = MAP_FAILED;
+#if defined(__linux__)
+    if (hugePages)
+    {
+        uint64_t hugeSize = ((mapSize + INPUT_FIFO_HUGE_PAGE_SIZE - 1) / INPUT_FIFO_HUGE_PAGE_SIZE) * INPUT_FIFO_HUGE_PAGE_SIZE;
+        base = mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (MAP_FAILED != base)
+        {
+            mapSize = hugeSize;
+            isHugePages = true;
+        }
+    }
+#endif
+    if (MAP_FAILED == base)
+    {
+        base = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == base)
+        {
+            return nullptr;
+        }
+#if defined(MADV_HUGEPAGE)
+        if (hugePages)
+        {   // transparent huge pages
+            isHugePages = (0 == madvise(base, mapSize, MADV_HUGEPAGE));
+        }
+#endif
+    }
+    return new InputFifoStorage { (uint8_t *) base, size, maxSpan, mapSize, false, isHugePages };
+#else
+    (void) hugePages;
+    uint8_t * base = new (std::nothrow) uint8_t[mapSize];
+    if (nullptr == base)
+    {
+        return nullptr;
+    }
+    return new InputFifoStorage { base, size, maxSpan, mapSize, false, false };
+#endif
+}
+
+void ComplexFifo::unmap(InputFifoStorage *storage)
+{
+    if (nullptr == storage)
+    {
+        return;
+    }
+#if INPUT_FIFO_HAVE_MMAP
+    munmap(storage->buffer, storage->mapSize);
+#else
+    delete [] storage->buffer;
+#endif
+    delete storage;
+}
+
+uint64_t ComplexFifo::readIndex() const
+{
+    uint64_t tail = m_tail.load(std::memory_order_acquire);
+    uint64_t flush = m_flush.load(std::memory_order_acquire);
+    return (flush > tail) ? flush : tail;
+}
+
+uint64_t ComplexFifo::count() const
+{
+    // head is loaded first, read index can only grow meanwhile => result is never negative
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    uint64_t tail = readIndex();
+    return (head > tail) ? (head - tail) : 0;
+}
+
+uint64_t ComplexFifo::space() const
+{
+    uint64_t fifoSize = size();
+    uint64_t used = m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_acquire);
+    return (used < fifoSize) ? (fifoSize - used) : 0;
+}
+
+void ComplexFifo::commit(uint64_t bytes)
+{
+    InputFifoStorage * storage = m_storage.load(std::memory_order_acquire);
+    if (!storage->isMirrored)
+    {   // keep buffer and guard area consistent
+        uint64_t head = m_head.load(std::memory_order_relaxed) % storage->size;
+        uint64_t end = head + bytes;
+        if (end > storage->size)
+        {   // data written to guard area belong to the beginning of buffer
+            memcpy(storage->buffer, storage->buffer + storage->size, end - storage->size);
+        }
+        if (head < storage->maxSpan)
+        {   // beginning of buffer is mirrored to guard area for reader
+            uint64_t mirrorEnd = (end < storage->maxSpan) ? end : storage->maxSpan;
+            memcpy(storage->buffer + storage->size + head, storage->buffer + head, mirrorEnd - head);
+        }
+    }
+
+    // seq_cst store followed by seq_cst load of waiting flag pairs with the order used in waitForData()
+    m_head.store(m_head.load(std::memory_order_relaxed) + bytes, std::memory_order_seq_cst);
+    if (m_consumerWaiting.load(std::memory_order_seq_cst))
+    {
+        m_dataEvent.notify();
+    }
+}
+
+bool ComplexFifo::waitForSpace(uint64_t bytes)
+{
+    if (size() < bytes)
+    {   // FIFO not allocated or request is too big
+        return false;
+    }
+    uint64_t flush = m_flush.load(std::memory_order_acquire);
+    while (space() < bytes)
+    {
+        uint32_t ev = m_spaceEvent.value();
+        m_producerWaiting.store(true, std::memory_order_seq_cst);
+        if ((space() >= bytes) || (m_flush.load(std::memory_order_seq_cst) != flush))
+        {   // consumer released space or FIFO was reset meanwhile
+            m_producerWaiting.store(false, std::memory_order_relaxed);
+            break;
+        }
+        m_spaceEvent.wait(ev);
+        m_producerWaiting.store(false, std::memory_order_relaxed);
+    }
+    return (space() >= bytes);
+}
+
+uint64_t ComplexFifo::waitForData(uint64_t bytes)
+{
+    uint64_t tail = readIndex();
+    while ((m_head.load(std::memory_order_acquire) - tail) < bytes)
+    {
+        uint32_t ev = m_dataEvent.value();
+        m_consumerWaiting.store(true, std::memory_order_seq_cst);
+        tail = readIndex();
+        if ((m_head.load(std::memory_order_seq_cst) - tail) >= bytes)
+        {   // producer committed data meanwhile
+            m_consumerWaiting.store(false, std::memory_order_relaxed);
+            break;
+        }
+        if (tail > m_tail.load(std::memory_order_relaxed))
+        {   // consumer holds no data here => data discarded by reset() are released so that producer can continue
+            // reset() wakes waiting consumer up to release data it discards later
+            release(tail);
+        }
+        m_dataEvent.wait(ev);
+        m_consumerWaiting.store(false, std::memory_order_relaxed);
+        tail = readIndex();
+    }
+    return tail;
+}
+
+void ComplexFifo::release(uint64_t tail)
+{
+    m_tail.store(tail, std::memory_order_seq_cst);
+    if (m_producerWaiting.load(std::memory_order_seq_cst))
+    {
+        m_spaceEvent.notify();
+    }
+}
+
+const uint8_t * ComplexFifo::readPtr(uint64_t bytes)
+{
+    m_readTail = waitForData(bytes);
+
+    // protect storage against release by alloc()
+    InputFifoStorage * storage;
+    do
+    {
+        storage = m_storage.load(std::memory_order_seq_cst);
+        m_hazard.store(storage, std::memory_order_seq_cst);
+    } while (storage != m_storage.load(std::memory_order_seq_cst));
+
+    if (nullptr == storage)
+    {   // FIFO not allocated
+        return nullptr;
+    }
+
+    // there is enough samples in input buffer, data are contiguous in memory
+    return storage->buffer + (m_readTail % storage->size);
+}
+
+void ComplexFifo::consume(uint64_t bytes)
+{
+    m_hazard.store(nullptr, std::memory_order_release);
+    release(m_readTail + bytes);
+}
+
+void ComplexFifo::read(uint8_t *data, uint64_t bytes)
+{
+    const uint8_t * ptr = readPtr(bytes);
+    if (nullptr != ptr)
+    {
+        memcpy(data, ptr, bytes);
+    }
+    else
+    {   // FIFO not allocated
+        memset(data, 0, bytes);
+    }
+    consume(bytes);
+}
+
+void ComplexFifo::skip(uint64_t bytes)
+{
+    m_readTail = waitForData(bytes);
+    release(m_readTail + bytes);
+}
+
+void ComplexFifo::waitForEpoch(uint32_t tag)
+{
+    if ((0 == tag) || (0 == size()))
+    {   // any data accepted or FIFO not allocated
+        return;
+    }
+
+    while (true)
+    {
+        // head is loaded before tag: if tag is still different, all data below head belong to other epoch
+        // (tag is stored by startEpoch() before producer commits data of new epoch)
+        uint64_t head = m_head.load(std::memory_order_acquire);
+        uint32_t epochTag = m_epochTag.load(std::memory_order_acquire);
+        if ((epochTag == tag) || (0 == epochTag))
+        {   // flush index of the epoch is visible => reading continues at the first byte of the epoch
+            return;
+        }
+
+        // discard stale data and wait for producer
+        if (head > readIndex())
+        {
+            release(head);
+        }
+        uint32_t ev = m_dataEvent.value();
+        m_consumerWaiting.store(true, std::memory_order_seq_cst);
+        if ((m_head.load(std::memory_order_seq_cst) == head) && (m_epochTag.load(std::memory_order_seq_cst) == epochTag))
+        {
+            m_dataEvent.wait(ev);
+        }
+        m_consumerWaiting.store(false, std::memory_order_relaxed);
+    }
+}
+
+void ComplexFifo::reset()
+{
+    startEpoch(0);
+}
+
+void ComplexFifo::startEpoch(uint32_t tag)
+{
+    // move flush index to current head, it never goes back
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    uint64_t flush = m_flush.load(std::memory_order_relaxed);
+    while ((head > flush) && !m_flush.compare_exchange_weak(flush, head, std::memory_order_seq_cst))
+    { /* flush was updated by other thread, try again */ }
+
+    // tag is published after flush index => consumer that sees the tag skips all data of previous epoch
+    m_epochTag.store(tag, std::memory_order_seq_cst);
+    m_resetCount.fetch_add(1, std::memory_order_release);
+
+    if (m_producerWaiting.load(std::memory_order_seq_cst))
+    {
+        m_spaceEvent.notify();
+    }
+    if (m_consumerWaiting.load(std::memory_order_seq_cst))
+    {   // consumer can wait for this epoch or it releases discarded data so that waiting producer can continue
+        m_dataEvent.notify();
+    }
+}
+
+void ComplexFifo::fillDummy()
+{
+    // producer is not running => FIFO is marked as full, any consumer accepts dummy data
+    m_epochTag.store(0, std::memory_order_seq_cst);
+    m_head.store(readIndex() + size(), std::memory_order_seq_cst);
+    if (m_consumerWaiting.load(std::memory_order_seq_cst))
+    {
+        m_dataEvent.notify();
+    }
+}
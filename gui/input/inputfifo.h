@@ -0,0 +1,230 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef INPUTFIFO_H
+#define INPUTFIFO_H
+
+#include <atomic>
+#include <cstdint>
+#include "inputtelemetry.h"
+#if !defined(__linux__)
+#include <mutex>
+#include <condition_variable>
+#endif
+
+// this is chunk that is received from input device to be stored in input FIFO
+// chunk duration is runtime parameter [ms]
+#define INPUT_CHUNK_MS_DEFAULT    (400)
+#define INPUT_CHUNK_MS_MIN        (50)
+#define INPUT_CHUNK_MS_MAX        (1000)
+
+// In low-latency mode devices transfer data in short blocks independently of chunk duration
+// => data after start or retune reach the FIFO sooner at the cost of more frequent callbacks
+#define INPUT_LOWLATENCY_TRANSFER_MS (8)
+
+// Input FIFO contains float _Complex samples => [float float]
+// FIFO depth is runtime parameter in number of input chunks
+#define INPUT_FIFO_CHUNKS_DEFAULT (8)
+#define INPUT_FIFO_CHUNKS_MIN     (4)
+#define INPUT_FIFO_CHUNKS_MAX     (32)
+
+// Minimum contiguous block that can be written or read (maximum request from dabsdr is 65535 IQ samples)
+#define INPUT_FIFO_MIN_SPAN       (65536 * (2*sizeof(float)))
+
+// Format of samples stored in FIFO
+// integer formats are stored as received from device and converted to float by consumer
+enum class InputFifoSampleFormat
+{
+    SAMPLE_FORMAT_FLOAT,  // [float float]
+    SAMPLE_FORMAT_S16,    // [int16_t int16_t]
+    SAMPLE_FORMAT_U8,     // [uint8_t uint8_t] with offset 128
+    SAMPLE_FORMAT_S8,     // [int8_t int8_t], input pipeline only (converted before FIFO)
+};
+
+// Event used by FIFO to block producer or consumer thread
+// Linux uses futex directly, other platforms use mutex and condition variable
+// notify() is called by the other side only when blocking thread announced it is waiting
+class InputFifoEvent
+{
+public:
+    uint32_t value() const { return m_value.load(std::memory_order_acquire); }
+
+    // blocks while event value is equal to expected value (spurious wakeup is possible)
+    void wait(uint32_t expected);
+    void notify();
+private:
+    std::atomic<uint32_t> m_value{0};
+#if !defined(__linux__)
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+#endif
+};
+
+// Memory used by FIFO
+// it is mapped twice back-to-back if possible, otherwise the buffer is followed by guard area
+// of maxSpan bytes that mirrors beginning of the buffer
+struct InputFifoStorage
+{
+    uint8_t * buffer;
+    uint64_t size;       // FIFO capacity in bytes
+    uint64_t maxSpan;    // maximum number of bytes that can be written or read as one contiguous block
+    uint64_t mapSize;    // size of memory allocation
+    bool isMirrored;
+    bool isHugePages;
+};
+
+// Single producer single consumer lock-free FIFO
+// head is written only by producer (input device thread), tail only by consumer (dabsdr thread)
+// both are free running byte counters, position in buffer is counter % size()
+// Buffer is always accessible as contiguous block of up to maxSpan() bytes starting at any position
+struct ComplexFifo
+{
+    ComplexFifo() = default;
+    ~ComplexFifo();
+    ComplexFifo(const ComplexFifo &) = delete;
+    ComplexFifo & operator=(const ComplexFifo &) = delete;
+
+    // (re)allocates FIFO memory, must be called when producer is not running
+    // consumer can be running, FIFO content is discarded
+    bool alloc(int chunkMs, int numChunks, bool hugePages, InputFifoSampleFormat format = InputFifoSampleFormat::SAMPLE_FORMAT_FLOAT);
+    void deallocate();
+
+    // mirrored mapping can be disabled, linear buffer with guard area is used then by next alloc()
+    void setMirroringEnabled(bool ena) { m_mirroringEna = ena; }
+
+    // sets format of samples written by producer, FIFO is reallocated if size of sample changes
+    // (current memory is kept if reallocation fails), must be called when producer is not running
+    // DOC is done by consumer when enabled (integer formats only)
+    bool setSampleFormat(InputFifoSampleFormat format, bool docEna);
+
+    // FIFO parameters
+    uint64_t size() const;
+    uint64_t maxSpan() const;
+    bool isMirrored() const;
+    int chunkMs() const { return m_chunkMs; }
+    uint32_t chunkIQSamples() const { return m_chunkMs * 2048; }
+
+    // number of IQ samples (at 2048 kHz) that device should transfer at once
+    // must be set when producer is not running
+    void setLowLatency(bool ena) { m_lowLatency = ena; }
+    bool isLowLatency() const { return m_lowLatency; }
+    uint32_t transferIQSamples() const { return m_lowLatency ? (INPUT_LOWLATENCY_TRANSFER_MS * 2048) : chunkIQSamples(); }
+    InputFifoSampleFormat sampleFormat() const { return m_sampleFormat.load(std::memory_order_acquire); }
+    bool isDocEnabled() const { return m_docEna.load(std::memory_order_acquire); }
+
+    // size of one value (I or Q) in bytes
+    static uint32_t sampleSize(InputFifoSampleFormat format);
+    uint32_t sampleSize() const { return sampleSize(sampleFormat()); }
+
+    // incremented by every reset() and startEpoch(), consumer can use it to detect discontinuity or change of sample format
+    uint32_t resetCount() const { return m_resetCount.load(std::memory_order_acquire); }
+
+    // Epochs: producer marks position in stream where data of new frequency start, tag is frequency [kHz]
+    // data of previous epochs are discarded, reset() starts untagged epoch (tag 0) accepted by any consumer
+    // epochStart() is byte position of first data of current epoch
+    void startEpoch(uint32_t tag);
+    uint32_t epochTag() const { return m_epochTag.load(std::memory_order_acquire); }
+    uint64_t epochStart() const { return m_flush.load(std::memory_order_acquire); }
+
+    // number of bytes in FIFO
+    uint64_t count() const;
+
+    // producer API
+    // writePtr() points to contiguous free space, at most maxSpan() bytes can be written before commit()
+    // space() is number of free bytes, data discarded by reset() are free when consumer releases them
+    // (consumer can be reading them just now)
+    // reserve() returns writePtr() if at least requested number of bytes is free (nullptr otherwise),
+    // producer can then write data in place and commit() any number of bytes up to the reserved size
+    // waitForSpace() blocks until requested number of bytes is free, it returns false when it was interrupted
+    // by reset() or startEpoch() and there is still not enough space
+    uint8_t * writePtr() const;
+    uint64_t space() const;
+    uint8_t * reserve(uint64_t bytes) const;
+    void commit(uint64_t bytes);
+    bool waitForSpace(uint64_t bytes);
+
+    // consumer API
+    // readPtr() blocks until requested number of bytes is available and returns pointer to contiguous data
+    // (nullptr if FIFO is not allocated), data are valid until consume() is called
+    // readPosition() is byte position of data returned by last readPtr() or skipped by last skip()
+    const uint8_t * readPtr(uint64_t bytes);
+    void consume(uint64_t bytes);
+    void read(uint8_t * data, uint64_t bytes);
+    void skip(uint64_t bytes);
+    uint64_t readPosition() const { return m_readTail; }
+
+    // discards data of other epochs and blocks until epoch with requested tag (or untagged epoch) starts
+    void waitForEpoch(uint32_t tag);
+
+    // discards all data in FIFO and starts untagged epoch, can be called from any thread
+    void reset();
+
+    // fills FIFO with dummy data of untagged epoch to unblock consumer when producer is not running
+    void fillDummy();
+
+    // statistics updated by producer and consumer of this FIFO
+    InputTelemetry & telemetry() { return m_telemetry; }
+
+private:
+    // storage is replaced only by alloc(), consumer marks storage it is accessing by hazard pointer
+    std::atomic<InputFifoStorage *> m_storage{nullptr};
+    std::atomic<InputFifoStorage *> m_hazard{nullptr};
+    int m_chunkMs = INPUT_CHUNK_MS_DEFAULT;
+    int m_numChunks = INPUT_FIFO_CHUNKS_DEFAULT;
+    bool m_hugePages = false;
+    bool m_mirroringEna = true;
+    bool m_lowLatency = false;
+    std::atomic<InputFifoSampleFormat> m_sampleFormat{InputFifoSampleFormat::SAMPLE_FORMAT_FLOAT};
+    std::atomic<bool> m_docEna{false};
+    std::atomic<uint32_t> m_resetCount{0};
+    std::atomic<uint32_t> m_epochTag{0};
+
+    // consumer only
+    uint64_t m_readTail = 0;
+
+    alignas(64) std::atomic<uint64_t> m_head{0};
+    alignas(64) std::atomic<uint64_t> m_tail{0};
+
+    // everything below this index is discarded (set by reset() and startEpoch())
+    alignas(64) std::atomic<uint64_t> m_flush{0};
+
+    std::atomic<bool> m_consumerWaiting{false};
+    std::atomic<bool> m_producerWaiting{false};
+    InputFifoEvent m_dataEvent;
+    InputFifoEvent m_spaceEvent;
+
+    InputTelemetry m_telemetry;
+
+    static InputFifoStorage * mapMirrored(uint64_t size, bool hugePages);
+    static InputFifoStorage * mapLinear(uint64_t size, uint64_t maxSpan, bool hugePages);
+    static void unmap(InputFifoStorage * storage);
+    uint64_t readIndex() const;
+    uint64_t waitForData(uint64_t bytes);
+    void release(uint64_t tail);
+};
+typedef struct ComplexFifo fifo_t;
+
+#endif // INPUTFIFO_H
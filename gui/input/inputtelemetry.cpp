@@ -0,0 +1,201 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "inputtelemetry.h"
+
+// every counter has single writer => load and store are used instead of read-modify-write
+static inline void addRelaxed(std::atomic<uint64_t> & counter, uint64_t val)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + val, std::memory_order_relaxed);
+}
+
+template <typename T>
+static inline void maxRelaxed(std::atomic<T> & val, T newVal)
+{
+    if (newVal > val.load(std::memory_order_relaxed))
+    {
+        val.store(newVal, std::memory_order_relaxed);
+    }
+}
+
+InputTelemetry::InputTelemetry()
+{
+    for (auto & bin : m_fifoLevelHistogram)
+    {
+        bin.store(0, std::memory_order_relaxed);
+    }
+    m_lastTime = std::chrono::steady_clock::now();
+}
+
+void InputTelemetry::consumerRead(uint64_t fifoCount, uint64_t fifoSize, uint64_t requested, uint64_t waitNs)
+{
+    // level in 0.1% of FIFO capacity
+    uint32_t level = (fifoSize > 0) ? uint32_t(std::min(fifoCount * 1000 / fifoSize, uint64_t(1000))) : 0;
+    bool isUnderrun = (fifoCount < requested);
+    if (!isUnderrun)
+    {   // call overhead only
+        waitNs = 0;
+    }
+
+    uint32_t interval = m_interval.load(std::memory_order_acquire);
+    if (interval != m_consumerInterval)
+    {   // first read in new interval
+        m_consumerInterval = interval;
+        m_fifoLevelMin.store(level, std::memory_order_relaxed);
+        m_fifoLevelMax.store(level, std::memory_order_relaxed);
+        m_waitMaxNs.store(waitNs, std::memory_order_relaxed);
+    }
+    else
+    {
+        if (level < m_fifoLevelMin.load(std::memory_order_relaxed))
+        {
+            m_fifoLevelMin.store(level, std::memory_order_relaxed);
+        }
+        maxRelaxed(m_fifoLevelMax, level);
+        maxRelaxed(m_waitMaxNs, waitNs);
+    }
+
+    addRelaxed(m_fifoLevelHistogram[std::min(level * INPUTTELEMETRY_HISTOGRAM_BINS / 1000, uint32_t(INPUTTELEMETRY_HISTOGRAM_BINS - 1))], 1);
+    addRelaxed(m_fifoLevelSum, level);
+    addRelaxed(m_waitNs, waitNs);
+    if (isUnderrun)
+    {
+        addRelaxed(m_underruns, 1);
+    }
+
+    // count is written last, reader sees all values of the read it counts
+    m_numReads.store(m_numReads.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void InputTelemetry::producerCallback(uint64_t durationNs, uint64_t gapNs)
+{
+    uint32_t interval = m_interval.load(std::memory_order_acquire);
+    if (interval != m_producerInterval)
+    {   // first callback in new interval
+        m_producerInterval = interval;
+        m_callbackMaxNs.store(durationNs, std::memory_order_relaxed);
+        m_gapMaxNs.store(gapNs, std::memory_order_relaxed);
+    }
+    else
+    {
+        maxRelaxed(m_callbackMaxNs, durationNs);
+        maxRelaxed(m_gapMaxNs, gapNs);
+    }
+
+    addRelaxed(m_callbackNs, durationNs);
+    if (gapNs > 0)
+    {
+        addRelaxed(m_gapNs, gapNs);
+        addRelaxed(m_numGaps, 1);
+    }
+    m_numCallbacks.store(m_numCallbacks.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void InputTelemetry::producerDropped(uint64_t bytes)
+{
+    addRelaxed(m_droppedBytes, bytes);
+}
+
+void InputTelemetry::producerOverflow()
+{
+    addRelaxed(m_deviceOverflows, 1);
+}
+
+InputTelemetryData InputTelemetry::takeInterval()
+{
+    Counters c;
+    c.numReads = m_numReads.load(std::memory_order_acquire);
+    c.fifoLevelSum = m_fifoLevelSum.load(std::memory_order_relaxed);
+    for (int n = 0; n < INPUTTELEMETRY_HISTOGRAM_BINS; ++n)
+    {
+        c.fifoLevelHistogram[n] = m_fifoLevelHistogram[n].load(std::memory_order_relaxed);
+    }
+    c.underruns = m_underruns.load(std::memory_order_relaxed);
+    c.waitNs = m_waitNs.load(std::memory_order_relaxed);
+    c.numCallbacks = m_numCallbacks.load(std::memory_order_acquire);
+    c.callbackNs = m_callbackNs.load(std::memory_order_relaxed);
+    c.numGaps = m_numGaps.load(std::memory_order_relaxed);
+    c.gapNs = m_gapNs.load(std::memory_order_relaxed);
+    c.droppedBytes = m_droppedBytes.load(std::memory_order_relaxed);
+    c.deviceOverflows = m_deviceOverflows.load(std::memory_order_relaxed);
+
+    InputTelemetryData data;
+    auto now = std::chrono::steady_clock::now();
+    data.intervalMs = std::chrono::duration<float, std::milli>(now - m_lastTime).count();
+    m_lastTime = now;
+
+    data.numReads = c.numReads - m_last.numReads;
+    if (data.numReads > 0)
+    {
+        data.fifoLevelMin = m_fifoLevelMin.load(std::memory_order_relaxed) * 0.1f;
+        data.fifoLevelMax = m_fifoLevelMax.load(std::memory_order_relaxed) * 0.1f;
+        data.fifoLevelAvg = (c.fifoLevelSum - m_last.fifoLevelSum) * 0.1f / data.numReads;
+        data.consumerWaitMaxMs = m_waitMaxNs.load(std::memory_order_relaxed) * 1e-6f;
+    }
+    else
+    {   // consumer is not running or it is blocked for whole interval
+        data.fifoLevelMin = data.fifoLevelAvg = data.fifoLevelMax = NAN;
+        data.consumerWaitMaxMs = NAN;
+    }
+    for (int n = 0; n < INPUTTELEMETRY_HISTOGRAM_BINS; ++n)
+    {
+        data.fifoLevelHistogram[n] = c.fifoLevelHistogram[n] - m_last.fifoLevelHistogram[n];
+    }
+    data.underruns = c.underruns - m_last.underruns;
+    data.consumerWaitMs = (c.waitNs - m_last.waitNs) * 1e-6f;
+
+    data.numCallbacks = c.numCallbacks - m_last.numCallbacks;
+    data.droppedBytes = c.droppedBytes - m_last.droppedBytes;
+    data.deviceOverflows = c.deviceOverflows - m_last.deviceOverflows;
+    if (data.numCallbacks > 0)
+    {
+        data.callbackAvgUs = (c.callbackNs - m_last.callbackNs) * 1e-3f / data.numCallbacks;
+        data.callbackMaxUs = m_callbackMaxNs.load(std::memory_order_relaxed) * 1e-3f;
+    }
+    else
+    {
+        data.callbackAvgUs = data.callbackMaxUs = NAN;
+    }
+    uint64_t numGaps = c.numGaps - m_last.numGaps;
+    if (numGaps > 0)
+    {
+        data.callbackGapAvgMs = (c.gapNs - m_last.gapNs) * 1e-6f / numGaps;
+        data.callbackGapMaxMs = m_gapMaxNs.load(std::memory_order_relaxed) * 1e-6f;
+    }
+    else
+    {
+        data.callbackGapAvgMs = data.callbackGapMaxMs = NAN;
+    }
+    data.signalLevel = m_signalLevel.load(std::memory_order_relaxed);
+
+    // writers restart min/max with their next event
+    m_last = c;
+    m_interval.fetch_add(1, std::memory_order_release);
+
+    return data;
+}
@@ -0,0 +1,130 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef INPUTTELEMETRY_H
+#define INPUTTELEMETRY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#define INPUTTELEMETRY_HISTOGRAM_BINS (10)    // FIFO level histogram, bin width is 10% of FIFO capacity
+
+// Input statistics of one interval (between two InputTelemetry::takeInterval() calls)
+// min/max/avg values are NAN if there was no event in the interval
+struct InputTelemetryData
+{
+    float intervalMs = 0;
+
+    // consumer (dabsdr thread): FIFO level before every read [% of FIFO capacity] and waiting for data
+    uint64_t numReads = 0;
+    float fifoLevelMin = 0;
+    float fifoLevelAvg = 0;
+    float fifoLevelMax = 0;
+    uint64_t fifoLevelHistogram[INPUTTELEMETRY_HISTOGRAM_BINS] = { 0 };
+    uint64_t underruns = 0;         // number of reads that had to wait for data
+    float consumerWaitMs = 0;       // total time spent waiting
+    float consumerWaitMaxMs = 0;
+
+    // producer (input device thread): input pipeline processing of every device callback
+    uint64_t numCallbacks = 0;
+    uint64_t droppedBytes = 0;      // FIFO full
+    uint64_t deviceOverflows = 0;   // samples lost before reaching application (USB or driver buffer overflow)
+    float callbackAvgUs = 0;        // processing time
+    float callbackMaxUs = 0;
+    float callbackGapAvgMs = 0;     // time between starts of two callbacks
+    float callbackGapMaxMs = 0;
+    float signalLevel = 0;          // last signal level used by AGC
+};
+
+// Lock-free input telemetry of one input FIFO
+// consumer and producer update their own counters, statistics are read by one reader thread (GUI)
+// counters are free running, reader keeps previous values; min/max are restarted by writers when reader starts new interval
+class InputTelemetry
+{
+public:
+    InputTelemetry();
+
+    // consumer, read of requested bytes had to wait for waitNs if FIFO contained less data
+    void consumerRead(uint64_t fifoCount, uint64_t fifoSize, uint64_t requested, uint64_t waitNs);
+
+    // producer, gapNs = 0 when previous callback is not known (first callback after start)
+    void producerCallback(uint64_t durationNs, uint64_t gapNs);
+    void producerDropped(uint64_t bytes);
+    void producerOverflow();
+    void setSignalLevel(float level) { m_signalLevel.store(level, std::memory_order_relaxed); }
+
+    // reader, returns statistics since previous call
+    InputTelemetryData takeInterval();
+
+private:
+    struct Counters
+    {
+        uint64_t numReads = 0;
+        uint64_t fifoLevelSum = 0;  // [0.1%]
+        uint64_t fifoLevelHistogram[INPUTTELEMETRY_HISTOGRAM_BINS] = { 0 };
+        uint64_t underruns = 0;
+        uint64_t waitNs = 0;
+        uint64_t numCallbacks = 0;
+        uint64_t callbackNs = 0;
+        uint64_t numGaps = 0;
+        uint64_t gapNs = 0;
+        uint64_t droppedBytes = 0;
+        uint64_t deviceOverflows = 0;
+    };
+
+    // interval number, writers restart min/max when it changes
+    std::atomic<uint32_t> m_interval{0};
+
+    // consumer
+    uint32_t m_consumerInterval = 0;
+    std::atomic<uint64_t> m_numReads{0};
+    std::atomic<uint64_t> m_fifoLevelSum{0};
+    std::atomic<uint64_t> m_fifoLevelHistogram[INPUTTELEMETRY_HISTOGRAM_BINS];
+    std::atomic<uint64_t> m_underruns{0};
+    std::atomic<uint64_t> m_waitNs{0};
+    std::atomic<uint32_t> m_fifoLevelMin{0};   // [0.1%]
+    std::atomic<uint32_t> m_fifoLevelMax{0};
+    std::atomic<uint64_t> m_waitMaxNs{0};
+
+    // producer
+    uint32_t m_producerInterval = 0;
+    std::atomic<uint64_t> m_numCallbacks{0};
+    std::atomic<uint64_t> m_callbackNs{0};
+    std::atomic<uint64_t> m_numGaps{0};
+    std::atomic<uint64_t> m_gapNs{0};
+    std::atomic<uint64_t> m_droppedBytes{0};
+    std::atomic<uint64_t> m_deviceOverflows{0};
+    std::atomic<uint64_t> m_callbackMaxNs{0};
+    std::atomic<uint64_t> m_gapMaxNs{0};
+    std::atomic<float> m_signalLevel{0};
+
+    // reader
+    Counters m_last;
+    std::chrono::steady_clock::time_point m_lastTime;
+};
+
+#endif // INPUTTELEMETRY_H
@@ -0,0 +1,350 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstring>
+#include "rawfilecodec.h"
+
+#define RAWFILECODEC_K_BITS       (5)
+#define RAWFILECODEC_ESCAPE_Q     (24)   // quotient limit, value is stored in RAWFILECODEC_ESCAPE_BITS bits after escape
+#define RAWFILECODEC_ESCAPE_BITS  (18)
+
+static inline void put32(uint8_t * buf, uint32_t val)
+{
+    for (int n = 0; n < 4; ++n)
+    {
+        buf[n] = uint8_t(val >> (8*n));
+    }
+}
+
+static inline void put64(uint8_t * buf, uint64_t val)
+{
+    for (int n = 0; n < 8; ++n)
+    {
+        buf[n] = uint8_t(val >> (8*n));
+    }
+}
+
+static inline uint32_t get32(const uint8_t * buf)
+{
+    uint32_t val = 0;
+    for (int n = 0; n < 4; ++n)
+    {
+        val |= uint32_t(buf[n]) << (8*n);
+    }
+    return val;
+}
+
+static inline uint64_t get64(const uint8_t * buf)
+{
+    uint64_t val = 0;
+    for (int n = 0; n < 8; ++n)
+    {
+        val |= uint64_t(buf[n]) << (8*n);
+    }
+    return val;
+}
+
+static inline uint32_t zigzag(int32_t v)
+{
+    return (uint32_t(v) << 1) ^ uint32_t(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t u)
+{
+    return int32_t(u >> 1) ^ -int32_t(u & 1);
+}
+
+// LSB first bit writer
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<uint8_t> & out) : m_out(out) {}
+    void put(uint32_t val, int bits)
+    {   // bits <= 32
+        m_acc |= uint64_t(val) << m_bits;
+        m_bits += bits;
+        while (m_bits >= 8)
+        {
+            m_out.push_back(uint8_t(m_acc));
+            m_acc >>= 8;
+            m_bits -= 8;
+        }
+    }
+    void flush()
+    {
+        if (m_bits > 0)
+        {
+            m_out.push_back(uint8_t(m_acc));
+        }
+        m_acc = 0;
+        m_bits = 0;
+    }
+private:
+    std::vector<uint8_t> & m_out;
+    uint64_t m_acc = 0;
+    int m_bits = 0;
+};
+
+// LSB first bit reader
+class BitReader
+{
+public:
+    BitReader(const uint8_t * in, uint32_t len) : m_in(in), m_end(in + len) {}
+    bool get(int bits, uint32_t & val)
+    {   // bits <= 32
+        while (m_bits < bits)
+        {
+            if (m_in >= m_end)
+            {
+                return false;
+            }
+            m_acc |= uint64_t(*m_in++) << m_bits;
+            m_bits += 8;
+        }
+        val = uint32_t(m_acc & ((uint64_t(1) << bits) - 1));
+        m_acc >>= bits;
+        m_bits -= bits;
+        return true;
+    }
+    bool getUnary(uint32_t & q)
+    {   // number of ones before zero, at most RAWFILECODEC_ESCAPE_Q
+        q = 0;
+        while (1)
+        {
+            if (0 == m_bits)
+            {
+                if (m_in >= m_end)
+                {
+                    return false;
+                }
+                m_acc = *m_in++;
+                m_bits = 8;
+            }
+            if (0 == (m_acc & 1))
+            {
+                m_acc >>= 1;
+                m_bits -= 1;
+                return true;
+            }
+            m_acc >>= 1;
+            m_bits -= 1;
+            if (++q == RAWFILECODEC_ESCAPE_Q)
+            {
+                return true;
+            }
+        }
+    }
+private:
+    const uint8_t * m_in;
+    const uint8_t * m_end;
+    uint64_t m_acc = 0;
+    int m_bits = 0;
+};
+
+void RawFileCodecHeader::serialize(uint8_t *buf) const
+{
+    std::memset(buf, 0, RAWFILECODEC_HEADER_SIZE);
+    put32(buf, RAWFILECODEC_MAGIC);
+    put32(buf + 4, RAWFILECODEC_VERSION);
+    put32(buf + 8, sampleSize);
+    put32(buf + 12, sampleRate);
+    put32(buf + 16, blockIQ);
+    put64(buf + 24, numIQ);
+    put64(buf + 32, numBlocks);
+    put64(buf + 40, indexOffset);
+}
+
+bool RawFileCodecHeader::deserialize(const uint8_t *buf)
+{
+    if ((RAWFILECODEC_MAGIC != get32(buf)) || (RAWFILECODEC_VERSION != get32(buf + 4)))
+    {
+        return false;
+    }
+    sampleSize = get32(buf + 8);
+    sampleRate = get32(buf + 12);
+    blockIQ = get32(buf + 16);
+    numIQ = get64(buf + 24);
+    numBlocks = get64(buf + 32);
+    indexOffset = get64(buf + 40);
+
+    return ((1 == sampleSize) || (2 == sampleSize)) && (blockIQ > 0) && (blockIQ <= RAWFILECODEC_BLOCK_IQ);
+}
+
+RawFileEncoder::RawFileEncoder(int sampleSize) : m_sampleSize(sampleSize)
+{
+    m_values.resize(2*RAWFILECODEC_BLOCK_IQ);
+}
+
+uint32_t RawFileEncoder::encodeBlock(const uint8_t *in, uint32_t numIQ, std::vector<uint8_t> &out)
+{
+    // convert to signed values
+    uint32_t numValues = 2*numIQ;
+    if (m_values.size() < numValues)
+    {
+        m_values.resize(numValues);
+    }
+    if (1 == m_sampleSize)
+    {
+        for (uint32_t n = 0; n < numValues; ++n)
+        {
+            m_values[n] = int32_t(in[n]) - 128;
+        }
+    }
+    else
+    {
+        const int16_t * in16 = reinterpret_cast<const int16_t *>(in);
+        for (uint32_t n = 0; n < numValues; ++n)
+        {
+            m_values[n] = in16[n];
+        }
+    }
+
+    size_t start = out.size();
+    out.resize(start + RAWFILECODEC_BLOCK_HEADER);   // block header is filled at the end
+    BitWriter bw(out);
+
+    for (int ch = 0; ch < 2; ++ch)
+    {   // I and Q
+        int32_t prev = 0;
+        for (uint32_t s = 0; s < numIQ; s += RAWFILECODEC_SUBBLOCK)
+        {
+            uint32_t len = (numIQ - s < RAWFILECODEC_SUBBLOCK) ? (numIQ - s) : RAWFILECODEC_SUBBLOCK;
+            const int32_t * v = m_values.data() + 2*s + ch;
+
+            // select mode with lower sum of mapped values
+            uint64_t sumValue = 0;
+            uint64_t sumDelta = 0;
+            int32_t p = prev;
+            for (uint32_t n = 0; n < len; ++n)
+            {
+                sumValue += zigzag(v[2*n]);
+                sumDelta += zigzag(v[2*n] - p);
+                p = v[2*n];
+            }
+            bool isDelta = (sumDelta < sumValue);
+            uint64_t sum = isDelta ? sumDelta : sumValue;
+
+            // Rice parameter from mean value
+            uint32_t k = 0;
+            while ((k < 20) && ((uint64_t(len) << (k + 1)) < sum))
+            {
+                ++k;
+            }
+
+            bw.put(isDelta ? 1 : 0, 1);
+            bw.put(k, RAWFILECODEC_K_BITS);
+            for (uint32_t n = 0; n < len; ++n)
+            {
+                uint32_t u = zigzag(isDelta ? (v[2*n] - prev) : v[2*n]);
+                prev = v[2*n];
+
+                uint32_t q = u >> k;
+                if (q < RAWFILECODEC_ESCAPE_Q)
+                {
+                    bw.put((1u << q) - 1, q + 1);       // q ones and zero
+                    if (k > 0)
+                    {
+                        bw.put(u & ((1u << k) - 1), k);
+                    }
+                }
+                else
+                {   // escape
+                    bw.put((1u << RAWFILECODEC_ESCAPE_Q) - 1, RAWFILECODEC_ESCAPE_Q);
+                    bw.put(u, RAWFILECODEC_ESCAPE_BITS);
+                }
+            }
+        }
+    }
+    bw.flush();
+
+    uint32_t payloadBytes = out.size() - start - RAWFILECODEC_BLOCK_HEADER;
+    put32(out.data() + start, payloadBytes);
+    put32(out.data() + start + 4, numIQ);
+
+    return payloadBytes + RAWFILECODEC_BLOCK_HEADER;
+}
+
+RawFileDecoder::RawFileDecoder(int sampleSize) : m_sampleSize(sampleSize)
+{}
+
+bool RawFileDecoder::decodeBlock(const uint8_t *in, uint32_t len, uint32_t numIQ, uint8_t *out)
+{
+    BitReader br(in, len);
+    for (int ch = 0; ch < 2; ++ch)
+    {   // I and Q
+        int32_t prev = 0;
+        for (uint32_t s = 0; s < numIQ; s += RAWFILECODEC_SUBBLOCK)
+        {
+            uint32_t subLen = (numIQ - s < RAWFILECODEC_SUBBLOCK) ? (numIQ - s) : RAWFILECODEC_SUBBLOCK;
+            uint32_t isDelta;
+            uint32_t k;
+            if (!br.get(1, isDelta) || !br.get(RAWFILECODEC_K_BITS, k) || (k > 20))
+            {
+                return false;
+            }
+            for (uint32_t n = 0; n < subLen; ++n)
+            {
+                uint32_t q;
+                uint32_t u;
+                if (!br.getUnary(q))
+                {
+                    return false;
+                }
+                if (q < RAWFILECODEC_ESCAPE_Q)
+                {
+                    uint32_t r = 0;
+                    if ((k > 0) && !br.get(k, r))
+                    {
+                        return false;
+                    }
+                    u = (q << k) | r;
+                }
+                else if (!br.get(RAWFILECODEC_ESCAPE_BITS, u))
+                {
+                    return false;
+                }
+
+                int32_t v = unzigzag(u);
+                if (isDelta)
+                {
+                    v += prev;
+                }
+                prev = v;
+
+                uint32_t idx = 2*(s + n) + ch;
+                if (1 == m_sampleSize)
+                {
+                    out[idx] = uint8_t(v + 128);
+                }
+                else
+                {
+                    reinterpret_cast<int16_t *>(out)[idx] = int16_t(v);
+                }
+            }
+        }
+    }
+    return true;
+}
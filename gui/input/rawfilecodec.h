@@ -0,0 +1,89 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RAWFILECODEC_H
+#define RAWFILECODEC_H
+
+#include <cstdint>
+#include <vector>
+
+// Lossless compressed IQ container
+//
+// [header RAWFILECODEC_HEADER_SIZE][XML header RAWFILECODEC_XML_SIZE][block 0][block 1]...[block index]
+// Each block holds RAWFILECODEC_BLOCK_IQ IQ samples (last block can be shorter) and can be decoded independently:
+//     [uint32 payload bytes][uint32 number of IQ samples][payload]
+// Block index is array of uint64 file offsets of blocks. All numbers are little endian.
+//
+// Payload codes I and Q channels separately in sub-blocks of RAWFILECODEC_SUBBLOCK values.
+// Each sub-block has 1 bit mode (value or difference to previous value of the channel) and 5 bits Rice parameter,
+// followed by Rice codes of zigzag mapped values.
+
+#define RAWFILECODEC_MAGIC          (0x315A5149)    // "IQZ1"
+#define RAWFILECODEC_VERSION        (1)
+#define RAWFILECODEC_HEADER_SIZE    (64)
+#define RAWFILECODEC_XML_SIZE       (2048)
+#define RAWFILECODEC_DATA_OFFSET    (RAWFILECODEC_HEADER_SIZE + RAWFILECODEC_XML_SIZE)
+#define RAWFILECODEC_BLOCK_IQ       (65536)
+#define RAWFILECODEC_BLOCK_HEADER   (8)
+#define RAWFILECODEC_SUBBLOCK       (256)
+
+struct RawFileCodecHeader
+{
+    uint32_t sampleSize = 1;        // 1 = uint8 (offset 128), 2 = int16
+    uint32_t sampleRate = 2048000;
+    uint32_t blockIQ = RAWFILECODEC_BLOCK_IQ;
+    uint64_t numIQ = 0;
+    uint64_t numBlocks = 0;
+    uint64_t indexOffset = 0;
+
+    void serialize(uint8_t * buf) const;        // RAWFILECODEC_HEADER_SIZE bytes
+    bool deserialize(const uint8_t * buf);
+};
+
+class RawFileEncoder
+{
+public:
+    explicit RawFileEncoder(int sampleSize);
+
+    // encodes numIQ samples to block including block header, returns block size in bytes
+    uint32_t encodeBlock(const uint8_t * in, uint32_t numIQ, std::vector<uint8_t> & out);
+private:
+    int m_sampleSize;
+    std::vector<int32_t> m_values;
+};
+
+class RawFileDecoder
+{
+public:
+    explicit RawFileDecoder(int sampleSize);
+
+    // decodes block payload (without block header) to numIQ samples, returns false if data are corrupted
+    bool decodeBlock(const uint8_t * in, uint32_t len, uint32_t numIQ, uint8_t * out);
+private:
+    int m_sampleSize;
+};
+
+#endif // RAWFILECODEC_H
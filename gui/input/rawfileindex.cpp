@@ -0,0 +1,232 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDateTime>
+#include <QLoggingCategory>
+#include "rawfileindex.h"
+
+Q_LOGGING_CATEGORY(rawFileIndex, "RawFileIndex", QtInfoMsg)
+
+#define RAWFILEINDEX_MAGIC    (0x52494458)   // "RIDX"
+#define RAWFILEINDEX_VERSION  (1)
+
+qint64 RawFileIndex::frameBoundary(qint64 iqPos) const
+{
+    auto it = std::upper_bound(m_entries.cbegin(), m_entries.cend(), iqPos);
+    if (it != m_entries.cbegin())
+    {
+        qint64 boundary = *(--it);
+        if ((iqPos - boundary) <= 2*RAWFILEINDEX_INTERVAL_IQ)
+        {
+            return boundary;
+        }
+    }
+    return iqPos;
+}
+
+bool RawFileIndex::load(const QString &recordingName, qint64 dataOffset, int sampleSize)
+{
+    clear();
+
+    QFileInfo recInfo(recordingName);
+    QFile file(recordingName + RAWFILEINDEX_FILE_SUFFIX);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic;
+    quint32 version;
+    qint64 recSize;
+    qint64 recModified;
+    qint64 recDataOffset;
+    qint32 recSampleSize;
+    in >> magic >> version >> recSize >> recModified >> recDataOffset >> recSampleSize;
+    if ((RAWFILEINDEX_MAGIC != magic) || (RAWFILEINDEX_VERSION != version)
+        || (recInfo.size() != recSize) || (recInfo.lastModified().toMSecsSinceEpoch() != recModified)
+        || (dataOffset != recDataOffset) || (sampleSize != recSampleSize))
+    {   // index belongs to different recording
+        return false;
+    }
+
+    in >> m_entries;
+    if (QDataStream::Ok != in.status())
+    {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool RawFileIndex::save(const QString &recordingName, qint64 dataOffset, int sampleSize) const
+{
+    QFileInfo recInfo(recordingName);
+    QFile file(recordingName + RAWFILEINDEX_FILE_SUFFIX);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out << quint32(RAWFILEINDEX_MAGIC) << quint32(RAWFILEINDEX_VERSION)
+        << qint64(recInfo.size()) << qint64(recInfo.lastModified().toMSecsSinceEpoch())
+        << qint64(dataOffset) << qint32(sampleSize)
+        << m_entries;
+
+    return (QDataStream::Ok == out.status());
+}
+
+RawFileIndexer::RawFileIndexer(const QString &recordingName, qint64 dataOffset, int sampleSize, QObject *parent)
+    : QThread(parent)
+    , m_recordingName(recordingName)
+    , m_dataOffset(dataOffset)
+    , m_sampleSize(sampleSize)
+{
+}
+
+void RawFileIndexer::run()
+{
+    if (m_index.load(m_recordingName, m_dataOffset, m_sampleSize))
+    {
+        qCInfo(rawFileIndex) << "RAW-FILE: Index loaded," << m_index.size() << "entries";
+        return;
+    }
+
+    build();
+    if (m_stopRequest)
+    {   // incomplete index is not used
+        m_index.clear();
+        return;
+    }
+
+    qCInfo(rawFileIndex) << "RAW-FILE: Index built," << m_index.size() << "entries";
+    if (!m_index.save(m_recordingName, m_dataOffset, m_sampleSize))
+    {
+        qCInfo(rawFileIndex) << "RAW-FILE: Unable to save index to" << m_recordingName + RAWFILEINDEX_FILE_SUFFIX;
+    }
+}
+
+void RawFileIndexer::build()
+{
+    QFile file(m_recordingName);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(m_dataOffset))
+    {
+        return;
+    }
+
+    const int blocksPerFrame = RAWFILEINDEX_FRAME_IQ / RAWFILEINDEX_BLOCK_IQ;
+    // window shorter than null symbol => it fits inside null symbol regardless of block alignment
+    const int nullBlocks = RAWFILEINDEX_NULL_IQ / RAWFILEINDEX_BLOCK_IQ - 2;
+    const int blockBytes = RAWFILEINDEX_BLOCK_IQ * 2 * m_sampleSize;
+
+    std::vector<char> buffer(blocksPerFrame * blockBytes);
+    std::vector<uint32_t> energy;      // block energies [|I| + |Q|], first entry is block number blockIdx
+    energy.reserve(2 * blocksPerFrame + nullBlocks);
+    qint64 blockIdx = 0;
+    qint64 lastEntry = -RAWFILEINDEX_INTERVAL_IQ;
+
+    bool eof = false;
+    while (!eof && !m_stopRequest)
+    {
+        // read one frame
+        qint64 numBytes = file.read(buffer.data(), buffer.size());
+        eof = (numBytes < qint64(buffer.size()));
+        int numBlocks = (numBytes > 0) ? (numBytes / blockBytes) : 0;
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            uint32_t e = 0;
+            if (int(sizeof(int16_t)) == m_sampleSize)
+            {
+                const int16_t * s = reinterpret_cast<const int16_t *>(buffer.data()) + b * 2 * RAWFILEINDEX_BLOCK_IQ;
+                for (int n = 0; n < 2 * RAWFILEINDEX_BLOCK_IQ; ++n)
+                {
+                    e += std::abs(int(s[n]));
+                }
+            }
+            else
+            {
+                const uint8_t * s = reinterpret_cast<const uint8_t *>(buffer.data()) + b * 2 * RAWFILEINDEX_BLOCK_IQ;
+                for (int n = 0; n < 2 * RAWFILEINDEX_BLOCK_IQ; ++n)
+                {
+                    e += std::abs(int(s[n]) - 128);
+                }
+            }
+            energy.push_back(e);
+        }
+
+        // each frame long window (with overlap of null symbol length) contains exactly one complete null symbol
+        while (int(energy.size()) >= blocksPerFrame + nullBlocks)
+        {
+            uint64_t frameSum = 0;
+            for (int b = 0; b < blocksPerFrame; ++b)
+            {
+                frameSum += energy[b];
+            }
+
+            // sliding window with minimal energy
+            uint64_t winSum = 0;
+            for (int b = 0; b < nullBlocks; ++b)
+            {
+                winSum += energy[b];
+            }
+            uint64_t minSum = winSum;
+            int minPos = 0;
+            for (int b = 1; b < blocksPerFrame; ++b)
+            {
+                winSum += energy[b + nullBlocks - 1];
+                winSum -= energy[b - 1];
+                if (winSum < minSum)
+                {
+                    minSum = winSum;
+                    minPos = b;
+                }
+            }
+
+            // null symbol is accepted only if it is clearly below frame mean => known good frame boundary
+            if (double(minSum) / nullBlocks < RAWFILEINDEX_NULL_THRESHOLD * double(frameSum) / blocksPerFrame)
+            {
+                qint64 iqPos = (blockIdx + minPos) * RAWFILEINDEX_BLOCK_IQ;
+                if ((iqPos - lastEntry) >= RAWFILEINDEX_INTERVAL_IQ)
+                {
+                    m_index.append(iqPos);
+                    lastEntry = iqPos;
+                }
+            }
+
+            energy.erase(energy.begin(), energy.begin() + blocksPerFrame);
+            blockIdx += blocksPerFrame;
+        }
+    }
+}
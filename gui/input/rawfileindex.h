@@ -0,0 +1,84 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RAWFILEINDEX_H
+#define RAWFILEINDEX_H
+
+#include <QString>
+#include <QList>
+#include <QThread>
+#include <QAtomicInt>
+
+#define RAWFILEINDEX_FRAME_IQ         (196608)       // DAB mode I transmission frame [IQ samples]
+#define RAWFILEINDEX_NULL_IQ          (2656)         // DAB mode I null symbol [IQ samples]
+#define RAWFILEINDEX_BLOCK_IQ         (32)           // signal energy is evaluated in blocks [IQ samples]
+#define RAWFILEINDEX_INTERVAL_IQ      (2048000)      // minimal distance of index entries (1 sec)
+#define RAWFILEINDEX_NULL_THRESHOLD   (0.25)         // maximal null symbol energy relative to frame mean
+#define RAWFILEINDEX_FILE_SUFFIX      ".idx"         // sidecar file name is recording name + suffix
+
+// Index of DAB frame boundaries (null symbol positions) in raw IQ recording
+// Positions are in IQ samples from the beginning of sample data
+class RawFileIndex
+{
+public:
+    void clear() { m_entries.clear(); }
+    bool isEmpty() const { return m_entries.isEmpty(); }
+    int size() const { return m_entries.size(); }
+    void append(qint64 iqPos) { m_entries.append(iqPos); }
+
+    // returns nearest known frame boundary before iqPos, iqPos itself if there is no boundary close enough
+    qint64 frameBoundary(qint64 iqPos) const;
+
+    // sidecar file is valid only for the same recording size, modification time, data offset and sample format
+    bool load(const QString & recordingName, qint64 dataOffset, int sampleSize);
+    bool save(const QString & recordingName, qint64 dataOffset, int sampleSize) const;
+
+private:
+    QList<qint64> m_entries;
+};
+
+// Background first pass over the recording that builds the index
+// Index is loaded from sidecar file if it exists and it is valid, otherwise it is built and saved
+class RawFileIndexer : public QThread
+{
+    Q_OBJECT
+public:
+    explicit RawFileIndexer(const QString & recordingName, qint64 dataOffset, int sampleSize, QObject *parent = nullptr);
+    void stop() { m_stopRequest = true; }
+    const RawFileIndex & index() const { return m_index; }
+protected:
+    void run() override;
+private:
+    QAtomicInt m_stopRequest = false;
+    QString m_recordingName;
+    qint64 m_dataOffset;
+    int m_sampleSize;
+    RawFileIndex m_index;
+
+    void build();
+};
+
+#endif // RAWFILEINDEX_H
@@ -28,12 +28,22 @@
 #include <QLoggingCategory>
 #include <QFile>
 #include <QDomDocument>
+#include <QtEndian>
 #include <complex>
+#include <cstring>
 #include "rawfileinput.h"
+#include "inputdevicechannelizer.h"
+
+#if defined(Q_OS_UNIX)
+#include <sys/mman.h>
+#define RAWFILEINPUT_HAVE_MADVISE 1
+#else
+#define RAWFILEINPUT_HAVE_MADVISE 0
+#endif
 
 Q_LOGGING_CATEGORY(rawFileInput, "RawFileInput", QtInfoMsg)
 
-RawFileInput::RawFileInput(QObject *parent) : InputDevice(parent)
+RawFileInput::RawFileInput(fifo_t *inputBuffer, QObject *parent) : InputDevice(inputBuffer, parent)
 {
     m_deviceDescription.id = InputDeviceId::RAWFILE;
 
@@ -52,20 +62,37 @@ RawFileInput::~RawFileInput()
         m_worker->wait();
     }
 
-    if (nullptr != m_inputFile)
-    {
-        m_inputFile->close();
-        delete m_inputFile;
-    }   
+    closeFile();
 }
 
-bool RawFileInput::openDevice()
+void RawFileInput::closeFile()
 {
+    if (nullptr != m_indexer)
+    {
+        m_indexer->stop();
+        m_indexer->wait();
+        disconnect(m_indexer, nullptr, this, nullptr);
+        m_indexer->deleteLater();
+        m_indexer = nullptr;
+    }
+    m_index.clear();
+
     if (nullptr != m_inputFile)
     {
+        if (nullptr != m_fileMap)
+        {
+            m_inputFile->unmap(m_fileMap);
+            m_fileMap = nullptr;
+        }
         m_inputFile->close();
         delete m_inputFile;
+        m_inputFile = nullptr;
     }
+}
+
+bool RawFileInput::openDevice()
+{
+    closeFile();
     m_inputFile = new QFile(m_fileName);
     if (!m_inputFile->open(QIODevice::ReadOnly))
     {
@@ -76,54 +103,79 @@ bool RawFileInput::openDevice()
         return false;
     }
 
-    // check XML header
-    QDataStream in(m_inputFile);
-    QByteArray xml;
-    int idx = 0;
-    do
-    {   // read no more than RAWFILEINPUT_XML_PADDING bytes
-        char ch;
-        in.readRawData(&ch, 1);
-        if (0 == ch)
-        {   // zero indicates header padding bytes
-            break;
+    if (openCompressed())
+    {   // lossless compressed recording, XML header was already parsed
+        m_dataOffset = RAWFILECODEC_DATA_OFFSET;
+    }
+    else
+    {
+        // check XML header
+        QDataStream in(m_inputFile);
+        QByteArray xml;
+        int idx = 0;
+        do
+        {   // read no more than RAWFILEINPUT_XML_PADDING bytes
+            char ch;
+            in.readRawData(&ch, 1);
+            if (0 == ch)
+            {   // zero indicates header padding bytes
+                break;
+            }
+            xml.append(ch);
+        } while (++idx < RAWFILEINPUT_XML_PADDING);
+
+        if (idx < RAWFILEINPUT_XML_PADDING)
+        {   // try to parse header
+            parseXmlHeader(xml);
+        }
+        else
+        {   // not found
+            m_deviceDescription.rawFile.hasXmlHeader = false;
         }
-        xml.append(ch);
-    } while (++idx < RAWFILEINPUT_XML_PADDING);
 
-    if (idx < RAWFILEINPUT_XML_PADDING)
-    {   // try to parse header
-        parseXmlHeader(xml);
+        if (!m_deviceDescription.rawFile.hasXmlHeader)
+        {   // header was not correctly parsed or not found
+            if (!m_inputFile->seek(0))
+            {   // seek to start failed (FIFO ???) -> align to IQ samples
+                while (idx++ & 0x07)
+                {   // until multiple of 8 bytes
+                    char ch;
+                    in.readRawData(&ch, 1);
+                }
+            }
+            else { /* seek to start OK */ }
+        }
+        m_dataOffset = m_deviceDescription.rawFile.hasXmlHeader ? (RAWFILEINPUT_XML_PADDING) : (0);
+    }
+
+    // samples are read from memory-mapped file if possible => no syscall and no copy to temporary buffer per chunk
+    m_fileMap = m_inputFile->map(0, m_inputFile->size());
+    if (nullptr != m_fileMap)
+    {
+#if RAWFILEINPUT_HAVE_MADVISE
+        // file is read sequentially, pages behind read position can be dropped by kernel
+        madvise(m_fileMap, m_inputFile->size(), MADV_SEQUENTIAL);
+#endif
     }
     else
-    {   // not found
-        m_deviceDescription.rawFile.hasXmlHeader = false;
+    {
+        qCInfo(rawFileInput) << "RAW-FILE: Unable to map file, reading through file I/O";
     }
 
-    if (!m_deviceDescription.rawFile.hasXmlHeader)
-    {   // header was not correctly parsed or not found
-        if (!m_inputFile->seek(0))
-        {   // seek to start failed (FIFO ???) -> align to IQ samples
-            while (idx++ & 0x07)
-            {   // until multiple of 8 bytes
-                char ch;
-                in.readRawData(&ch, 1);
-            }
-        }
-        else { /* seek to start OK */ }
+    // recording with higher sample rate and known frequency is wideband capture, tuned channel is extracted by channelizer
+    m_widebandRate = 0;
+    if (m_deviceDescription.rawFile.hasXmlHeader && (m_deviceDescription.sample.sampleRate > 2048000)
+        && (0 != m_deviceDescription.rawFile.frequency_kHz))
+    {
+        m_widebandRate = m_deviceDescription.sample.sampleRate;
+        qCInfo(rawFileInput) << "RAW-FILE: Wideband recording," << m_widebandRate / 1000 << "kHz around"
+                             << m_deviceDescription.rawFile.frequency_kHz << "kHz";
     }
 
-    switch (m_sampleFormat) {
-    case RawFileInputFormat::SAMPLE_FORMAT_U8:
-        //emit fileLength(m_inputFile->size()/(2*2048));
-        emit fileLength(m_inputFile->size() >> (1 + 11));
-        break;
-    case RawFileInputFormat::SAMPLE_FORMAT_S16:
-        //emit fileLength(m_inputFile->size()/(4*2048));
-        emit fileLength(m_inputFile->size() >> (2 + 11));
-        break;
-    default:
-        break;
+    emitFileLength();
+    if (!m_isCompressed && (0 == m_widebandRate))
+    {   // compressed file has its own block index, frame boundaries of wideband recording cannot be searched
+        startIndexer();
     }
 
     emit deviceReady();
@@ -131,30 +183,139 @@ bool RawFileInput::openDevice()
     return true;
 }
 
+bool RawFileInput::openCompressed()
+{
+    m_isCompressed = false;
+    m_blockOffsets.clear();
+
+    // peek does not move file position => raw files and pipes are not affected
+    QByteArray header = m_inputFile->peek(RAWFILECODEC_HEADER_SIZE);
+    if ((RAWFILECODEC_HEADER_SIZE != header.size()) || !m_codecHeader.deserialize((const uint8_t *) header.constData()))
+    {   // not compressed file
+        return false;
+    }
+
+    uint64_t numBlocks = (m_codecHeader.numIQ + m_codecHeader.blockIQ - 1) / m_codecHeader.blockIQ;
+    if ((numBlocks != m_codecHeader.numBlocks) || (m_codecHeader.indexOffset < RAWFILECODEC_DATA_OFFSET)
+        || (m_codecHeader.indexOffset + numBlocks * sizeof(uint64_t) > uint64_t(m_inputFile->size())))
+    {
+        qCWarning(rawFileInput) << "RAW-FILE: Compressed file header is not valid";
+        return false;
+    }
+
+    // block index
+    m_inputFile->seek(m_codecHeader.indexOffset);
+    QByteArray index = m_inputFile->read(numBlocks * sizeof(uint64_t));
+    if (index.size() != qsizetype(numBlocks * sizeof(uint64_t)))
+    {
+        qCWarning(rawFileInput) << "RAW-FILE: Unable to read block index of compressed file";
+        m_inputFile->seek(0);
+        return false;
+    }
+    m_blockOffsets.resize(numBlocks);
+    for (uint64_t n = 0; n < numBlocks; ++n)
+    {
+        m_blockOffsets[n] = qFromLittleEndian<quint64>(index.constData() + n * sizeof(uint64_t));
+    }
+    m_isCompressed = true;
+
+    // XML header follows file header
+    m_inputFile->seek(RAWFILECODEC_HEADER_SIZE);
+    QByteArray xml = m_inputFile->read(RAWFILECODEC_XML_SIZE);
+    int len = xml.indexOf('\0');
+    if (len >= 0)
+    {
+        xml.truncate(len);
+    }
+    m_deviceDescription.sample.sampleRate = m_codecHeader.sampleRate;
+    m_deviceDescription.rawFile.numSamples = m_codecHeader.numIQ;
+    parseXmlHeader(xml);
+    setFileFormat(m_sampleFormat);
+
+    m_inputFile->seek(RAWFILECODEC_DATA_OFFSET);
+    m_startIQ = 0;
+
+    qCInfo(rawFileInput) << "RAW-FILE: Compressed recording," << m_codecHeader.numIQ << "IQ samples in" << numBlocks << "blocks";
+
+    return true;
+}
+
+void RawFileInput::startIndexer()
+{
+    int sampleSize = (RawFileInputFormat::SAMPLE_FORMAT_S16 == m_sampleFormat) ? sizeof(int16_t) : sizeof(uint8_t);
+    m_indexer = new RawFileIndexer(m_fileName, m_dataOffset, sampleSize, this);
+    connect(m_indexer, &RawFileIndexer::finished, this, [this]() {
+        m_index = m_indexer->index();
+        m_indexer->deleteLater();
+        m_indexer = nullptr;
+    });
+    m_indexer->start(QThread::LowPriority);
+}
+
+void RawFileInput::seek(int msec)
+{
+    if ((nullptr == m_worker) || (nullptr == m_inputFile))
+    {   // file is not playing, position is set to the beginning when playback starts
+        emit fileProgress(0);
+        return;
+    }
+
+    stop();
+
+    if (m_isCompressed)
+    {   // compressed blocks are indexed => any IQ sample can be reached directly
+        m_startIQ = qBound(uint64_t(0), uint64_t(qMax(msec, 0)) * iqPerMs(), m_codecHeader.numIQ);
+        qCInfo(rawFileInput) << "RAW-FILE: Seek to" << m_startIQ / iqPerMs() << "msec";
+
+        m_inputBuffer->reset();
+        startWorker();
+        return;
+    }
+
+    qint64 numIQ = (m_inputFile->size() - m_dataOffset) / (2*sampleSize());
+
+    // jump to frame boundary if it is known => DAB processing synchronizes quickly (index is empty for wideband recording)
+    qint64 iqPos = m_index.frameBoundary(qBound(qint64(0), qint64(msec) * qint64(iqPerMs()), numIQ));
+    qCInfo(rawFileInput) << "RAW-FILE: Seek to" << iqPos / qint64(iqPerMs()) << "msec";
+
+    m_inputFile->seek(m_dataOffset + iqPos * 2 * sampleSize());
+
+    // samples before seek are not valid anymore
+    m_inputBuffer->reset();
+
+    startWorker();
+}
+
 void RawFileInput::setFile(const QString & fileName, const RawFileInputFormat &sampleFormat)
 {
     m_fileName = fileName;
+    m_isCompressed = false;
     setFileFormat(sampleFormat);
 }
 
 void RawFileInput::setFileFormat(const RawFileInputFormat &sampleFormat)
 {
-    m_sampleFormat = sampleFormat;
+    if (m_isCompressed)
+    {   // format of compressed file is given by its header
+        m_sampleFormat = (sizeof(int16_t) == m_codecHeader.sampleSize) ? RawFileInputFormat::SAMPLE_FORMAT_S16
+                                                                        : RawFileInputFormat::SAMPLE_FORMAT_U8;
+    }
+    else
+    {
+        m_sampleFormat = sampleFormat;
+    }
+    emitFileLength();
+}
 
-    if (nullptr != m_inputFile)
+void RawFileInput::emitFileLength()
+{
+    if (m_isCompressed)
     {
-        switch (m_sampleFormat) {
-        case RawFileInputFormat::SAMPLE_FORMAT_U8:
-            //emit fileLength(m_inputFile->size()/(2*2048));
-            emit fileLength(m_inputFile->size() >> (1 + 11));
-            break;
-        case RawFileInputFormat::SAMPLE_FORMAT_S16:
-            //emit fileLength(m_inputFile->size()/(4*2048));
-            emit fileLength(m_inputFile->size() >> (2 + 11));
-            break;
-        default:
-            break;
-        }
+        emit fileLength(m_codecHeader.numIQ / iqPerMs());
+    }
+    else if (nullptr != m_inputFile)
+    {
+        emit fileLength(m_inputFile->size() / (2 * sampleSize() * iqPerMs()));
     }
     else { /* no file opened */ }
 }
@@ -165,22 +326,52 @@ void RawFileInput::tune(uint32_t freq)
     rewind();
 
     // Reset buffer here - worker thread it not running, DAB waits for new data
-    inputBuffer.reset();
+    m_inputBuffer->reset();
 
+    m_frequency = freq;
     if (0 != freq)
     {
-        m_worker = new RawFileWorker(m_inputFile, m_sampleFormat, this);
-        connect(m_worker, &RawFileWorker::bytesRead, this, &RawFileInput::onBytesRead, Qt::QueuedConnection);
-        connect(m_worker, &RawFileWorker::endOfFile, this, &RawFileInput::onEndOfFile, Qt::QueuedConnection);        
-        connect(m_worker, &RawFileWorker::finished, m_worker, &QObject::deleteLater);
-        connect(m_worker, &RawFileWorker::destroyed, this, [=]() { m_worker = nullptr; } );
-        m_worker->start();
+        if (0 != m_widebandRate)
+        {   // channelizer output
+            m_inputBuffer->setSampleFormat(InputFifoSampleFormat::SAMPLE_FORMAT_FLOAT, false);
+        }
+        else
+        {   // samples are stored in FIFO in file format
+            m_inputBuffer->setSampleFormat((RawFileInputFormat::SAMPLE_FORMAT_S16 == m_sampleFormat) ? InputFifoSampleFormat::SAMPLE_FORMAT_S16
+                                                                                                  : InputFifoSampleFormat::SAMPLE_FORMAT_U8, false);
+        }
+
+        startWorker();
+    }
+    emit tuned(freq);
+}
 
+void RawFileInput::startWorker()
+{
+    m_worker = new RawFileWorker(m_inputFile, m_fileMap, m_dataOffset, m_sampleFormat, m_freeRun, m_inputBuffer, this);
+    if (m_isCompressed)
+    {
+        m_worker->setCompressed(m_codecHeader, &m_blockOffsets, m_startIQ);
+    }
+    if ((0 != m_widebandRate) && !m_worker->setWideband(m_widebandRate, m_deviceDescription.rawFile.frequency_kHz, m_frequency))
+    {   // tuned channel is not in recording
+        delete m_worker;
+        m_worker = nullptr;
+        return;
+    }
+    connect(m_worker, &RawFileWorker::bytesRead, this, &RawFileInput::onBytesRead, Qt::QueuedConnection);
+    connect(m_worker, &RawFileWorker::endOfFile, this, &RawFileInput::onEndOfFile, Qt::QueuedConnection);
+    connect(m_worker, &RawFileWorker::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &RawFileWorker::destroyed, this, [=]() { m_worker = nullptr; } );
+    m_worker->start();
+
+    if (!m_freeRun)
+    {   // worker is paced by timer to emulate real time input
         m_inputTimer = new QTimer(this);
         connect(m_inputTimer, &QTimer::timeout, m_worker, &RawFileWorker::trigger);
-        m_inputTimer->start(INPUT_CHUNK_MS);
+        m_inputTimer->start(m_inputBuffer->chunkMs());
     }
-    emit tuned(freq);
+    else { /* worker keeps FIFO full, DAB processing runs as fast as possible */ }
 }
 
 void RawFileInput::rewind()
@@ -190,7 +381,8 @@ void RawFileInput::rewind()
         // go to file beginning
         if (nullptr != m_inputFile)
         {
-            m_inputFile->seek(m_deviceDescription.rawFile.hasXmlHeader ? (RAWFILEINPUT_XML_PADDING) : (0));
+            m_inputFile->seek(m_dataOffset);
+            m_startIQ = 0;
             emit fileProgress(0);
         }
     }
@@ -198,16 +390,7 @@ void RawFileInput::rewind()
 
 void RawFileInput::onBytesRead(quint64 bytesRead)
 {
-    switch (m_sampleFormat) {
-    case RawFileInputFormat::SAMPLE_FORMAT_U8:
-        emit fileProgress(bytesRead >> (1 + 11));
-        break;
-    case RawFileInputFormat::SAMPLE_FORMAT_S16:
-        emit fileProgress(bytesRead >> (2 + 11));
-        break;
-    default:
-        break;
-    }
+    emit fileProgress(bytesRead / (2 * sampleSize() * iqPerMs()));
 }
 
 void RawFileInput::parseXmlHeader(const QByteArray &xml)
@@ -416,19 +599,18 @@ void RawFileInput::stop()
     if (nullptr != m_inputTimer)
     {
         m_inputTimer->stop();
+        delete m_inputTimer;
+        m_inputTimer = nullptr;
     }
     if (nullptr != m_worker)
     {
         m_worker->stop();        
-        m_worker->wait(INPUT_CHUNK_MS*2);
+        m_worker->wait(m_inputBuffer->chunkMs()*2);
         while (!m_worker->isFinished())
         {
             // reset buffer - and tell the thread it is empty - buffer will be reset in any case
-            pthread_mutex_lock(&inputBuffer.countMutex);
-            inputBuffer.count = 0;
-            pthread_cond_signal(&inputBuffer.countCondition);
-            pthread_mutex_unlock(&inputBuffer.countMutex);
-            m_worker->wait(INPUT_CHUNK_MS*2);
+            m_inputBuffer->reset();
+            m_worker->wait(m_inputBuffer->chunkMs()*2);
         }
         delete m_worker;
         m_worker = nullptr;
@@ -436,14 +618,69 @@ void RawFileInput::stop()
 }
 
 
-RawFileWorker::RawFileWorker(QFile *inputFile, RawFileInputFormat sampleFormat, QObject *parent)
+RawFileWorker::RawFileWorker(QFile *inputFile, const uchar *fileMap, qint64 dataOffset, RawFileInputFormat sampleFormat, bool freeRun,
+                             fifo_t *inputBuffer, QObject *parent)
     : QThread(parent)
+    , m_inputBuffer(inputBuffer)
     , m_sampleFormat(sampleFormat)
     , m_inputFile(inputFile)
+    , m_fileMap(fileMap)
+    , m_dataOffset(dataOffset)
+    , m_freeRun(freeRun)
 {
-    m_bytesRead = 0;
+    // worker continues from current file position
+    m_fileSize = inputFile->size();
+    m_filePos = inputFile->pos();
+    m_bytesRead = m_filePos - m_dataOffset;
     m_stopRequest = false;
     m_elapsedTimer.start();
+
+    // file is processed by the same stages as live device => replay can be used for benchmarking
+    m_pipeline = new InputDevicePipeline("RawFile", &m_inputBuffer->telemetry());
+    m_pipeline->addStage(new InputPipelineFifoWriter(m_inputBuffer));
+    if (RawFileInputFormat::SAMPLE_FORMAT_U8 == sampleFormat)
+    {
+        m_pipeline->addStage(new InputPipelineLevelU8());
+    }
+    else { /* level is not estimated for int16 files */ }
+}
+
+RawFileWorker::~RawFileWorker()
+{
+    delete m_pipeline;
+    delete m_decoder;
+}
+
+void RawFileWorker::setCompressed(const RawFileCodecHeader &header, const std::vector<uint64_t> *blockOffsets, uint64_t startIQ)
+{
+    delete m_decoder;
+    m_decoder = new RawFileDecoder(header.sampleSize);
+    m_codecHeader = header;
+    m_blockOffsets = blockOffsets;
+    m_iqPos = startIQ;
+    m_decodedBlockIdx = -1;
+    m_decodedBlock.resize(header.blockIQ * 2 * header.sampleSize);
+    m_bytesRead = m_iqPos * 2 * header.sampleSize;
+}
+
+bool RawFileWorker::setWideband(int sampleRate, uint32_t centerFrequency, uint32_t frequency)
+{
+    if (!InputDeviceChannelizer::isInBand(sampleRate, centerFrequency, frequency))
+    {
+        qCWarning(rawFileInput) << "RAW-FILE: Channel" << frequency << "kHz is outside of recorded band" << centerFrequency << "kHz +/-"
+                                << sampleRate / 2000 << "kHz";
+        return false;
+    }
+
+    // file samples keep their scale, the same as in FIFO of 2048kHz recording
+    // telemetry of FIFO is updated by channel worker
+    delete m_pipeline;
+    m_pipeline = new InputDevicePipeline("RawFile");
+    m_pipeline->addStage(new InputPipelineConvertToFloat(1.0f));
+    m_pipeline->addStage(new InputPipelineChannelizer(new InputDeviceChannelizer(sampleRate, centerFrequency, frequency, m_inputBuffer)));
+    m_widebandRate = sampleRate;
+
+    return true;
 }
 
 void RawFileWorker::trigger()
@@ -461,125 +698,232 @@ void RawFileWorker::run()
 {
     while(1)
     {
-        m_semaphore.acquire();
+        if (!m_freeRun)
+        {   // wait for timer
+            m_semaphore.acquire();
+        }
 
         if (m_stopRequest)
         {   // stop request
             return;
         }
 
-        qint64 elapsed = m_elapsedTimer.elapsed();
-        int period = elapsed - m_lastTriggerTime;
-        m_lastTriggerTime = elapsed;
+        int period;
+        if (m_freeRun)
+        {   // one chunk, waitForSpace() blocks until consumer (dabsdr thread) processes samples
+            period = m_inputBuffer->chunkMs();
+        }
+        else
+        {
+            qint64 elapsed = m_elapsedTimer.elapsed();
+            period = elapsed - m_lastTriggerTime;
+            m_lastTriggerTime = elapsed;
+        }
 
-        uint64_t samplesRead = 0;
-        uint64_t input_chunk_iq_samples = period * 2048;
+        // file samples are stored in FIFO as they are, conversion to float is done by consumer
+        uint64_t sampleSize = (RawFileInputFormat::SAMPLE_FORMAT_S16 == m_sampleFormat) ? sizeof(int16_t) : sizeof(uint8_t);
 
-        // get FIFO space
-        pthread_mutex_lock(&inputBuffer.countMutex);
-        uint64_t count = inputBuffer.count;
-        Q_ASSERT(count <= INPUT_FIFO_SIZE);
+        // wideband recording: FIFO contains float channelizer output at 2048kHz,
+        // space for samples in flight in channelizer is reserved => channel never drops samples
+        uint64_t fifoIQSize = (0 != m_widebandRate) ? (2*sizeof(float)) : (2*sampleSize);
+        uint64_t inFlightIQ = (0 != m_widebandRate) ? ((INPUTDEVICECHANNELIZER_BUFFERS + 1) * INPUTDEVICECHANNELIZER_BLOCK_IQ * uint64_t(2048000) / m_widebandRate + 64)
+                                                    : 0;
 
-        while ((INPUT_FIFO_SIZE - count) < input_chunk_iq_samples*sizeof(float)*2)
+        // limit chunk size to maximum contiguous FIFO block (late trigger), wideband recording is limited by FIFO size only
+        uint64_t maxBytes = (0 != m_widebandRate) ? m_inputBuffer->size() : m_inputBuffer->maxSpan();
+        int maxPeriod = qMax(int((maxBytes - inFlightIQ*fifoIQSize) / (2048*fifoIQSize)), 1);
+        if (period > maxPeriod)
         {
-
-            pthread_cond_wait(&inputBuffer.countCondition, &inputBuffer.countMutex);
-            count = inputBuffer.count;
+            period = maxPeriod;
         }
-        pthread_mutex_unlock(&inputBuffer.countMutex);
 
-        // there is enough room in buffer
-        uint64_t bytesTillEnd = INPUT_FIFO_SIZE - inputBuffer.head;
+        uint64_t input_chunk_iq_samples = (0 != m_widebandRate) ? (uint64_t(period) * m_widebandRate / 1000) : (period * 2048);
 
-        switch (m_sampleFormat)
-        {
-        case RawFileInputFormat::SAMPLE_FORMAT_S16:
-        {
-            int16_t * tmpBuffer = new int16_t[input_chunk_iq_samples*2];
-            uint64_t bytesRead = m_inputFile->read((char *) tmpBuffer, input_chunk_iq_samples * 2 * sizeof(int16_t));
-            m_bytesRead += bytesRead;
-
-            samplesRead = bytesRead >> 1;  // one sample is int16 (I or Q) => 2 bytes
+        // get FIFO space - blocks until consumer releases enough space
+        if (!m_inputBuffer->waitForSpace((period * 2048 + inFlightIQ) * fifoIQSize))
+        {   // FIFO was reset (stop) while consumer is not reading => samples of this period are dropped
+            continue;
+        }
 
-            int16_t * inPtr = tmpBuffer;
-            if (bytesTillEnd >= samplesRead * sizeof(float))
+        // there is enough room in buffer, FIFO space is contiguous => reading directly to FIFO
+        // (memory-mapped file is copied to FIFO by pipeline), wideband recording is read to its own buffer
+        qint64 numBytes = input_chunk_iq_samples * 2 * sampleSize;
+        uint8_t * dest = m_inputBuffer->writePtr();
+        if (0 != m_widebandRate)
+        {
+            m_widebandBuffer.resize(numBytes);
+            dest = m_widebandBuffer.data();
+        }
+        const uint8_t * data = dest;
+        if (nullptr != m_decoder)
+        {   // compressed file, blocks are decoded to FIFO
+            numBytes = readCompressed(dest, input_chunk_iq_samples) * 2 * sampleSize;
+        }
+        else if (nullptr != m_fileMap)
+        {   // memory-mapped file
+            numBytes = qMin(numBytes, m_fileSize - m_filePos);
+            data = m_fileMap + m_filePos;
+            m_filePos += numBytes;
+
+#if RAWFILEINPUT_HAVE_MADVISE
+            // request next chunks in advance, so that consumer does not wait for page faults
+            qint64 aheadStart = m_filePos & ~qint64(0xFFFF);  // 64kB alignment is multiple of page size
+            qint64 aheadLen = qMin(RAWFILEINPUT_READAHEAD_CHUNKS * numBytes + (m_filePos - aheadStart), m_fileSize - aheadStart);
+            if (aheadLen > 0)
             {
-                float * outPtr = (float *)(inputBuffer.buffer + inputBuffer.head);
-                for (uint64_t k=0; k < samplesRead; k++)
-                {   // convert to float
-                    *outPtr++ = float(*inPtr++);  // I or Q
-                }
+                madvise((void *) (m_fileMap + aheadStart), aheadLen, MADV_WILLNEED);
             }
-            else
-            {
-                Q_ASSERT(sizeof(float) == 4);
-                uint64_t samplesTillEnd = (bytesTillEnd >> 2);
-                float * outPtr = (float *)(inputBuffer.buffer + inputBuffer.head);
-                for (uint64_t k=0; k < samplesTillEnd; k++)
-                {   // convert to float
-                    *outPtr++ = float(*inPtr++);  // I or Q
-                }
-                outPtr = (float *)(inputBuffer.buffer);
-                for (uint64_t k=0; k<samplesRead-samplesTillEnd; k++)
-                {   // convert to float
-                    *outPtr++ = float(*inPtr++);  // I or Q
-                }
+#endif
+        }
+        else
+        {
+            numBytes = m_inputFile->read((char *) dest, numBytes);
+            if (numBytes < 0)
+            {   // read error is handled as end of file
+                numBytes = 0;
             }
-            delete [] tmpBuffer;
         }
-        break;
-        case RawFileInputFormat::SAMPLE_FORMAT_U8:
+        m_bytesRead += numBytes;
+
+        // only complete IQ samples are committed, incomplete sample at the end of file is dropped
+        // otherwise I and Q would be swapped after rewind
+        uint64_t iqSamplesRead = numBytes / (2*sampleSize);
+
+        if (iqSamplesRead > 0)
         {
-            uint8_t * tmpBuffer = new uint8_t[input_chunk_iq_samples*2];
-            uint64_t bytesRead = m_inputFile->read((char *) tmpBuffer, input_chunk_iq_samples * 2 * sizeof(uint8_t));
-            m_bytesRead += bytesRead;
+            m_pipeline->process(data, iqSamplesRead, (sizeof(int16_t) == sampleSize) ? InputFifoSampleFormat::SAMPLE_FORMAT_S16
+                                                                                    : InputFifoSampleFormat::SAMPLE_FORMAT_U8);
+        }
+        m_iqSamplesCommitted += (0 != m_widebandRate) ? (iqSamplesRead * 2048000 / m_widebandRate) : iqSamplesRead;
 
-            samplesRead = bytesRead;  // one sample is uint8 => 1 byte
+        emit bytesRead(m_bytesRead);
 
-            uint8_t * inPtr = tmpBuffer;
-            if (bytesTillEnd >= samplesRead * sizeof(float))
+        if (iqSamplesRead < input_chunk_iq_samples)
+        {
+            qCInfo(rawFileInput) << "RAW-FILE: End of file";
+            if (m_freeRun)
             {
-                float * outPtr = (float *)(inputBuffer.buffer + inputBuffer.head);
-                for (uint64_t k=0; k < samplesRead; k++)
-                {   // convert to float
-                    *outPtr++ = float(*inPtr++ - 128);  // I or Q
-                }
+                logRealTimeFactor(sampleSize);
+            }
+            if (nullptr != m_decoder)
+            {
+                m_iqPos = 0;
+            }
+            else if (nullptr != m_fileMap)
+            {
+                m_filePos = m_dataOffset;
             }
             else
             {
-                Q_ASSERT(sizeof(float) == 4);
-                uint64_t samplesTillEnd = (bytesTillEnd >> 2);
-                float * outPtr = (float *)(inputBuffer.buffer + inputBuffer.head);
-                for (uint64_t k=0; k < samplesTillEnd; k++)
-                {   // convert to float
-                    *outPtr++ = float(*inPtr++ - 128);  // I or Q
-                }
-                outPtr = (float *)(inputBuffer.buffer);
-                for (uint64_t k=0; k<samplesRead-samplesTillEnd; k++)
-                {   // convert to float
-                    *outPtr++ = float(*inPtr++ - 128);  // I or Q
-                }
+                m_inputFile->seek(m_dataOffset);
             }
-            delete [] tmpBuffer;
+            m_bytesRead = 0;
+            emit endOfFile();
+            emit bytesRead(m_bytesRead);
         }
-        break;
+    }
+}
+
+void RawFileWorker::logRealTimeFactor(uint64_t sampleSize)
+{
+    // samples still in FIFO were not processed yet (float channelizer output for wideband recording)
+    uint64_t iqSamplesInFifo = m_inputBuffer->count() / ((0 != m_widebandRate) ? (2*sizeof(float)) : (2*sampleSize));
+    uint64_t iqSamplesProcessed = (m_iqSamplesCommitted > iqSamplesInFifo) ? (m_iqSamplesCommitted - iqSamplesInFifo) : 0;
+
+    qint64 elapsed = m_elapsedTimer.elapsed();
+    qint64 msec = elapsed - m_replayStartTime;
+    if (msec > 0)
+    {
+        float signalSec = iqSamplesProcessed / 2048000.0;
+        qCInfo(rawFileInput) << QString("RAW-FILE: %1 sec of signal processed in %2 sec, real-time factor %3")
+                                    .arg(signalSec, 0, 'f', 1)
+                                    .arg(msec / 1000.0, 0, 'f', 1)
+                                    .arg(signalSec * 1000.0 / msec, 0, 'f', 2);
+    }
+
+    // samples in FIFO are counted to next run
+    m_replayStartTime = elapsed;
+    m_iqSamplesCommitted = iqSamplesInFifo;
+}
+
+uint64_t RawFileWorker::readCompressed(uint8_t *dest, uint64_t numIQ)
+{
+    uint64_t sampleSize = m_codecHeader.sampleSize;
+    uint64_t iqSamplesRead = 0;
+    while ((iqSamplesRead < numIQ) && (m_iqPos < m_codecHeader.numIQ))
+    {
+        uint64_t blockIdx = m_iqPos / m_codecHeader.blockIQ;
+        if ((int64_t(blockIdx) != m_decodedBlockIdx) && !decodeBlock(blockIdx))
+        {   // corrupted block is handled as end of file
+            m_iqPos = m_codecHeader.numIQ;
+            break;
         }
 
-        inputBuffer.head = (inputBuffer.head + samplesRead*sizeof(float)) % INPUT_FIFO_SIZE;
-        pthread_mutex_lock(&inputBuffer.countMutex);
-        inputBuffer.count = inputBuffer.count + samplesRead*sizeof(float);
-        pthread_cond_signal(&inputBuffer.countCondition);
-        pthread_mutex_unlock(&inputBuffer.countMutex);
+        uint64_t blockStart = blockIdx * m_codecHeader.blockIQ;
+        uint64_t blockLen = qMin(uint64_t(m_codecHeader.blockIQ), m_codecHeader.numIQ - blockStart);
+        uint64_t n = qMin(blockLen - (m_iqPos - blockStart), numIQ - iqSamplesRead);
+        std::memcpy(dest + iqSamplesRead * 2 * sampleSize, m_decodedBlock.data() + (m_iqPos - blockStart) * 2 * sampleSize, n * 2 * sampleSize);
+        iqSamplesRead += n;
+        m_iqPos += n;
+    }
+    m_bytesRead = m_iqPos * 2 * sampleSize;
 
-        emit bytesRead(m_bytesRead);
+    return iqSamplesRead;
+}
+
+bool RawFileWorker::decodeBlock(uint64_t blockIdx)
+{
+    uint64_t offset = (*m_blockOffsets)[blockIdx];
+    if (offset + RAWFILECODEC_BLOCK_HEADER > m_codecHeader.indexOffset)
+    {
+        qCWarning(rawFileInput) << "RAW-FILE: Invalid offset of compressed block" << blockIdx;
+        return false;
+    }
 
-        if (samplesRead < input_chunk_iq_samples*2)
+    const uint8_t * blockData;
+    if (nullptr != m_fileMap)
+    {
+        blockData = m_fileMap + offset;
+    }
+    else
+    {
+        m_inputFile->seek(offset);
+        m_payload.resize(RAWFILECODEC_BLOCK_HEADER);
+        if (m_inputFile->read((char *) m_payload.data(), RAWFILECODEC_BLOCK_HEADER) != RAWFILECODEC_BLOCK_HEADER)
         {
-            qCInfo(rawFileInput) << "RAW-FILE: End of file";
-            m_inputFile->seek(0);
-            m_bytesRead = 0;
-            emit endOfFile();
-            emit bytesRead(m_bytesRead);
+            return false;
         }
+        blockData = m_payload.data();
+    }
+    uint32_t len = qFromLittleEndian<quint32>(blockData);
+    uint32_t numIQ = qFromLittleEndian<quint32>(blockData + 4);
+    uint64_t expectedIQ = qMin(uint64_t(m_codecHeader.blockIQ), m_codecHeader.numIQ - blockIdx * m_codecHeader.blockIQ);
+    if ((numIQ != expectedIQ) || (offset + RAWFILECODEC_BLOCK_HEADER + len > m_codecHeader.indexOffset))
+    {
+        qCWarning(rawFileInput) << "RAW-FILE: Invalid header of compressed block" << blockIdx;
+        return false;
     }
+
+    if (nullptr != m_fileMap)
+    {
+        blockData = m_fileMap + offset + RAWFILECODEC_BLOCK_HEADER;
+    }
+    else
+    {
+        m_payload.resize(len);
+        if (m_inputFile->read((char *) m_payload.data(), len) != len)
+        {
+            return false;
+        }
+        blockData = m_payload.data();
+    }
+
+    if (!m_decoder->decodeBlock(blockData, len, numIQ, m_decodedBlock.data()))
+    {
+        qCWarning(rawFileInput) << "RAW-FILE: Compressed block" << blockIdx << "is corrupted";
+        return false;
+    }
+    m_decodedBlockIdx = blockIdx;
+
+    return true;
 }
@@ -35,8 +35,12 @@
 #include <QElapsedTimer>
 #include <QSemaphore>
 #include "inputdevice.h"
+#include "inputdevicepipeline.h"
+#include "rawfileindex.h"
+#include "rawfilecodec.h"
 
 #define RAWFILEINPUT_XML_PADDING 2048
+#define RAWFILEINPUT_READAHEAD_CHUNKS 4   // number of input chunks requested ahead from memory-mapped file
 
 enum class RawFileInputFormat
 {
@@ -48,7 +52,14 @@ class RawFileWorker : public QThread
 {
     Q_OBJECT
 public:
-    explicit RawFileWorker(QFile * inputFile, RawFileInputFormat sampleFormat, QObject *parent = nullptr);
+    explicit RawFileWorker(QFile * inputFile, const uchar * fileMap, qint64 dataOffset, RawFileInputFormat sampleFormat, bool freeRun,
+                           fifo_t * inputBuffer, QObject *parent = nullptr);
+    ~RawFileWorker();
+    void setCompressed(const RawFileCodecHeader & header, const std::vector<uint64_t> * blockOffsets, uint64_t startIQ);
+
+    // wideband recording: channel at frequency [kHz] is extracted and written to FIFO at 2048kHz
+    // returns false if channel is not in recorded band
+    bool setWideband(int sampleRate, uint32_t centerFrequency, uint32_t frequency);
     void trigger();
     void stop();
 protected:
@@ -58,12 +69,38 @@ signals:
     void endOfFile();
 private:
     QAtomicInt m_stopRequest = false;
+    fifo_t * m_inputBuffer;
     QSemaphore m_semaphore;
     QFile * m_inputFile = nullptr;
+    const uchar * m_fileMap = nullptr;  // nullptr when file is not memory-mapped
+    qint64 m_fileSize;
+    qint64 m_filePos;
+    qint64 m_dataOffset;
     QElapsedTimer m_elapsedTimer;
     qint64 m_lastTriggerTime = 0;
     RawFileInputFormat m_sampleFormat;
     qint64 m_bytesRead;
+    bool m_freeRun;                     // no timer, FIFO is kept full
+    qint64 m_replayStartTime = 0;       // used for real-time factor in free run mode
+    uint64_t m_iqSamplesCommitted = 0;
+    InputDevicePipeline * m_pipeline;   // FIFO -> level (uint8 files, the same as RTL-SDR) or float -> channelizer (wideband)
+
+    // wideband recording
+    int m_widebandRate = 0;                     // 0 for 2048kHz recording
+    std::vector<uint8_t> m_widebandBuffer;      // file samples are not read to FIFO
+
+    // compressed file
+    RawFileDecoder * m_decoder = nullptr;       // nullptr for raw file
+    RawFileCodecHeader m_codecHeader;
+    const std::vector<uint64_t> * m_blockOffsets = nullptr;
+    uint64_t m_iqPos = 0;
+    int64_t m_decodedBlockIdx = -1;
+    std::vector<uint8_t> m_decodedBlock;
+    std::vector<uint8_t> m_payload;             // used when file is not memory-mapped
+
+    void logRealTimeFactor(uint64_t sampleSize);
+    uint64_t readCompressed(uint8_t * dest, uint64_t numIQ);
+    bool decodeBlock(uint64_t blockIdx);
 };
 
 
@@ -71,12 +108,14 @@ class RawFileInput : public InputDevice
 {
     Q_OBJECT
 public:
-    explicit RawFileInput(QObject *parent = nullptr);
+    explicit RawFileInput(fifo_t * inputBuffer, QObject *parent = nullptr);
     ~RawFileInput();
     bool openDevice() override;    
     void tune(uint32_t freq) override;
     void setFile(const QString & fileName, const RawFileInputFormat & sampleFormat = RawFileInputFormat::SAMPLE_FORMAT_U8);
     void setFileFormat(const RawFileInputFormat & sampleFormat);
+    void setFreeRun(bool ena) { m_freeRun = ena; }
+    void seek(int msec);
     void startStopRecording(bool start) override { /* do nothing */ }
 signals:
     void fileLength(int msec);
@@ -86,10 +125,28 @@ private:
     RawFileInputFormat m_sampleFormat;
     QString m_fileName;
     QFile * m_inputFile = nullptr;
+    uchar * m_fileMap = nullptr;
+    qint64 m_dataOffset = 0;
+    bool m_freeRun = false;
     RawFileWorker * m_worker = nullptr;
     QTimer * m_inputTimer = nullptr;
+    RawFileIndexer * m_indexer = nullptr;
+    RawFileIndex m_index;
+    bool m_isCompressed = false;
+    RawFileCodecHeader m_codecHeader;
+    std::vector<uint64_t> m_blockOffsets;
+    uint64_t m_startIQ = 0;             // compressed file position for next worker start
+    int m_widebandRate = 0;             // sample rate of wideband recording, 0 for 2048kHz recording
+    uint32_t m_frequency = 0;
+    uint64_t iqPerMs() const { return (0 != m_widebandRate) ? (m_widebandRate / 1000) : 2048; }
+    uint64_t sampleSize() const { return (RawFileInputFormat::SAMPLE_FORMAT_S16 == m_sampleFormat) ? sizeof(int16_t) : sizeof(uint8_t); }
+    void emitFileLength();
+    void startWorker();
     void stop();
     void rewind();
+    void closeFile();
+    void startIndexer();
+    bool openCompressed();
     void onBytesRead(quint64 bytesRead);
     void onEndOfFile() { emit error(InputDeviceErrorCode::EndOfFile); }
     void parseXmlHeader(const QByteArray & xml);
@@ -24,6 +24,7 @@
  * SOFTWARE.
  */
 
+#include <cstring>
 #include <QDir>
 #include <QDebug>
 #include <QLoggingCategory>
@@ -31,7 +32,7 @@
 
 Q_LOGGING_CATEGORY(rtlsdrInput, "RtlSdrInput", QtInfoMsg)
 
-RtlSdrInput::RtlSdrInput(QObject *parent) : InputDevice(parent)
+RtlSdrInput::RtlSdrInput(fifo_t *inputBuffer, QObject *parent) : InputDevice(inputBuffer, parent)
 {
     m_deviceDescription.id = InputDeviceId::RTLSDR;
 
@@ -83,8 +84,6 @@ void RtlSdrInput::tune(uint32_t frequency)
 
             // start worker
             run();
-
-            // tuned(m_frequency) signal is emited when dataReady() from worker
         }
         else
         {   // worker is already running
@@ -94,10 +93,11 @@ void RtlSdrInput::tune(uint32_t frequency)
             resetAgc();
 
             // restart data acquisition
-            m_worker->restart();
-
-            // tuned(m_frequency) signal is emited when dataReady() from worker
+            m_worker->restart(m_frequency);
         }
+
+        // samples received before tune are skipped by consumer using FIFO epoch
+        emit tuned(m_frequency);
     }
     else
     {   // frequency == 0 ==> go to idle
@@ -238,14 +238,18 @@ bool RtlSdrInput::openDevice()
 
 void RtlSdrInput::run()
 {
-    m_worker = new RtlSdrWorker(m_device, this);
+    // samples are stored in FIFO as uint8
+    m_inputBuffer->setSampleFormat(InputFifoSampleFormat::SAMPLE_FORMAT_U8, (RTLSDR_DOC_ENABLE > 0));
+
+    m_worker = new RtlSdrWorker(m_device, m_inputBuffer, this);
     connect(m_worker, &RtlSdrWorker::agcLevel, this, &RtlSdrInput::onAgcLevel, Qt::QueuedConnection);
-    connect(m_worker, &RtlSdrWorker::dataReady, this, [=](){ emit tuned(m_frequency); }, Qt::QueuedConnection);
     connect(m_worker, &RtlSdrWorker::recordBuffer, this, &InputDevice::recordBuffer, Qt::DirectConnection);
     connect(m_worker, &RtlSdrWorker::finished, this, &RtlSdrInput::onReadThreadStopped, Qt::QueuedConnection);
     connect(m_worker, &RtlSdrWorker::finished, m_worker, &QObject::deleteLater);
     connect(m_worker, &RtlSdrWorker::destroyed, this, [=]() { m_worker = nullptr; } );
 
+    m_worker->startStopRecording(m_isRecording);
+    m_worker->restart(m_frequency);
     m_worker->start();
     m_watchdogTimer.start(1000 * INPUTDEVICE_WDOG_TIMEOUT_SEC);    
 }
@@ -262,10 +266,7 @@ void RtlSdrInput::stop()
             qCWarning(rtlsdrInput) << "Worker thread not finished after timeout - this should not happen :-(";
 
             // reset buffer - and tell the thread it is empty - buffer will be reset in any case
-            pthread_mutex_lock(&inputBuffer.countMutex);
-            inputBuffer.count = 0;
-            pthread_cond_signal(&inputBuffer.countCondition);
-            pthread_mutex_unlock(&inputBuffer.countMutex);
+            m_inputBuffer->reset();
             m_worker->wait(2000);
         }
     }
@@ -280,7 +281,7 @@ void RtlSdrInput::onReadThreadStopped()
         qCCritical(rtlsdrInput) << "Device unplugged.";
 
         // fill buffer (artificially to avoid blocking of the DAB processing thread)
-        inputBuffer.fillDummy();
+        m_inputBuffer->fillDummy();
 
         m_frequency = 0;
 
@@ -383,7 +384,7 @@ void RtlSdrInput::onWatchdogTimeout()
         if (!m_worker->isRunning())
         {  // some problem in data input
             qCCritical(rtlsdrInput) << "Watchdog timeout";
-            inputBuffer.fillDummy();
+            m_inputBuffer->fillDummy();
             emit error(InputDeviceErrorCode::NoDataAvailable);
         }
     }
@@ -395,7 +396,11 @@ void RtlSdrInput::onWatchdogTimeout()
 
 void RtlSdrInput::startStopRecording(bool start)
 {
-    m_worker->startStopRecording(start);
+    m_isRecording = start;
+    if (nullptr != m_worker)
+    {
+        m_worker->startStopRecording(start);
+    }
 }
 
 void RtlSdrInput::setBW(uint32_t bw)
@@ -501,22 +506,34 @@ QList<float> RtlSdrInput::getGainList() const
     return ret;
 }
 
-RtlSdrWorker::RtlSdrWorker(struct rtlsdr_dev * device, QObject *parent) : QThread(parent)
+RtlSdrWorker::RtlSdrWorker(struct rtlsdr_dev * device, fifo_t * inputBuffer, QObject *parent) : QThread(parent)
 {
     m_isRecording = false;
     m_rtlSdrPtr = parent;
     m_device = device;
+    m_inputBuffer = inputBuffer;
+
+    m_pipeline = new InputDevicePipeline("RTL-SDR", &m_inputBuffer->telemetry());
+    m_pipeline->addStage(new InputPipelineRecordTap([this](const uint8_t * buf, uint32_t len) { emit recordBuffer(buf, len); }, m_isRecording));
+    m_fifoWriter = m_pipeline->addStage(new InputPipelineFifoWriter(m_inputBuffer));
+#if (RTLSDR_AGC_ENABLE > 0)
+    m_levelStage = m_pipeline->addStage(new InputPipelineLevelU8());
+#endif
+}
+
+RtlSdrWorker::~RtlSdrWorker()
+{
+    delete m_pipeline;
 }
 
 void RtlSdrWorker::run()
 {
-    m_dcI = 0.0;
-    m_dcQ = 0.0;
-    m_agcLevel = 0.0;
+    m_pipeline->reset();
     m_watchdogFlag = false;  // first callback sets it to true
-    m_captureStartCntr = 1;  // first callback resets buffer
 
-    rtlsdr_read_async(m_device, callback, (void*)this, 0, INPUT_CHUNK_IQ_SAMPLES*2*sizeof(uint8_t));
+    rtlsdr_read_async(m_device, callback, (void*)this,
+                      m_inputBuffer->isLowLatency() ? RTLSDR_LOWLATENCY_BUF_NUM : 0,
+                      m_inputBuffer->transferIQSamples()*2*sizeof(uint8_t));
 }
 
 void RtlSdrWorker::startStopRecording(bool ena)
@@ -524,9 +541,15 @@ void RtlSdrWorker::startStopRecording(bool ena)
     m_isRecording = ena;
 }
 
-void RtlSdrWorker::restart()
-{
-    m_captureStartCntr = RTLSDR_RESTART_COUNTER;
+void RtlSdrWorker::restart(uint32_t frequency)
+{   // samples received before the tune are not written to FIFO, new FIFO epoch starts with first sample after tune
+    // transfers are not submitted yet when worker is started after tune => only tuner settling is skipped
+    uint64_t staleIQ = RTLSDR_RETUNE_SETTLE_MS * 2048;
+    if (QThread::isRunning())
+    {
+        staleIQ += uint64_t(RTLSDR_RETUNE_TRANSFERS) * m_inputBuffer->transferIQSamples();
+    }
+    m_fifoWriter->retune(frequency, staleIQ);
 }
 
 bool RtlSdrWorker::isRunning()
@@ -543,220 +566,18 @@ void RtlSdrWorker::callback(unsigned char *buf, uint32_t len, void * ctx)
 
 void RtlSdrWorker::processInputData(unsigned char *buf, uint32_t len)
 {
-#if (RTLSDR_DOC_ENABLE > 0)
-    int_fast32_t sumI = 0;
-    int_fast32_t sumQ = 0;
-#endif
-
-    if (m_captureStartCntr > 0)
-    {   // reset procedure
-        if (0 == --m_captureStartCntr)
-        {   // restart finished
-
-            // clear buffer to avoid mixing of channels
-            inputBuffer.reset();
-
-            m_dcI = 0.0;
-            m_dcQ = 0.0;
-            //m_agcLevel = 0.0;
-
-            emit dataReady();
-        }
-        else
-        {   // only reecord if recording
-            if (m_isRecording)
-            {
-                emit recordBuffer(buf, len);
-            }
-            else { /* not recording */ }
-
-            // reset watchDog flag, timer sets it to false
-            m_watchdogFlag = true;
-
-            return;
-        }
-    }
-    else { /* normal operation */ }
-
-    if (m_isRecording)
-    {
-        emit recordBuffer(buf, len);
-    }
-    else { /* not recording */ }
-
     // reset watchDog flag, timer sets it to false
     m_watchdogFlag = true;
 
-    // retrieving memories
-#if (RTLSDR_DOC_ENABLE > 0)
-    float dcI = m_dcI;
-    float dcQ = m_dcQ;
-#endif
-#if (RTLSDR_AGC_ENABLE > 0)
-    float agcLev = m_agcLevel;
-#endif
-
-    // len is number of I and Q samples
-    // get FIFO space
-    pthread_mutex_lock(&inputBuffer.countMutex);
-    uint64_t count = inputBuffer.count;
-    Q_ASSERT(count <= INPUT_FIFO_SIZE);
-
-    pthread_mutex_unlock(&inputBuffer.countMutex);
-
-    if ((INPUT_FIFO_SIZE - count) < len*sizeof(float))
-    {
-        qCWarning(rtlsdrInput) << "Dropping" << len << "bytes...";
+    // input samples are IQ = [uint8_t uint8_t], len is number of I and Q samples
+    if (!m_pipeline->process(buf, len/2, InputFifoSampleFormat::SAMPLE_FORMAT_U8))
+    {   // FIFO full
         return;
     }
 
-    // input samples are IQ = [uint8_t uint8_t]
-    // going to transform them to [float float] = float _Complex
-    // on uint8_t will be transformed to one float
-
-    // there is enough room in buffer
-    uint64_t bytesTillEnd = INPUT_FIFO_SIZE - inputBuffer.head;
-    uint8_t * inPtr = buf;
-    if (bytesTillEnd >= len*sizeof(float))
-    {
-        float * outPtr = (float *)(inputBuffer.buffer + inputBuffer.head);
-        for (uint64_t k=0; k<len; k++)
-        {   // convert to float
-#if ((RTLSDR_DOC_ENABLE == 0) && ((RTLSDR_AGC_ENABLE == 0)))
-            *outPtr++ = float(*inPtr++ - 128);  // I or Q
-#else // ((RTLSDR_DOC_ENABLE == 0) && ((RTLSDR_AGC_ENABLE == 0)))
-            int_fast8_t tmp = *inPtr++ - 128; // I or Q
-
 #if (RTLSDR_AGC_ENABLE > 0)
-            int_fast8_t absTmp = abs(tmp);
-
-            // calculate signal level (rectifier, fast attack slow release)
-            float c = m_agcLevel_crel;
-            if (absTmp > agcLev)
-            {
-                c = m_agcLevel_catt;
-            }
-            agcLev = c * absTmp + agcLev - c * agcLev;
-#endif  // (RTLSDR_AGC_ENABLE > 0)
-
-#if (RTLSDR_DOC_ENABLE > 0)
-            // subtract DC
-            if (k & 0x1)
-            {   // Q
-                sumQ += tmp;
-                *outPtr++ = float(tmp) - dcQ;
-            }
-            else
-            {  // I
-                sumI += tmp;
-                *outPtr++ = float(tmp) - dcI;
-            }
-#else
-            *outPtr++ = float(tmp);
-#endif  // RTLSDR_DOC_ENABLE
-#endif  // ((RTLSDR_DOC_ENABLE == 0) && ((RTLSDR_AGC_ENABLE == 0)))
-        }
-        inputBuffer.head = (inputBuffer.head + len*sizeof(float));
-    }
-    else
-    {
-        Q_ASSERT(sizeof(float) == 4);
-        uint64_t samplesTillEnd = bytesTillEnd >> 2; // / sizeof(float);
-
-        float * outPtr = (float *)(inputBuffer.buffer + inputBuffer.head);
-        for (uint64_t k=0; k<samplesTillEnd; ++k)
-        {   // convert to float
-#if ((RTLSDR_DOC_ENABLE == 0) && ((RTLSDR_AGC_ENABLE == 0)))
-            *outPtr++ = float(*inPtr++ - 128);  // I or Q
-#else // ((RTLSDR_DOC_ENABLE == 0) && ((RTLSDR_AGC_ENABLE == 0)))
-            int_fast8_t tmp = *inPtr++ - 128; // I or Q
-
-#if (RTLSDR_AGC_ENABLE > 0)
-            int_fast8_t absTmp = abs(tmp);
-
-            // calculate signal level (rectifier, fast attack slow release)
-            float c = m_agcLevel_crel;
-            if (absTmp > agcLev)
-            {
-                c = m_agcLevel_catt;
-            }
-            agcLev = c * absTmp + agcLev - c * agcLev;
-#endif  // (RTLSDR_AGC_ENABLE > 0)
-
-#if (RTLSDR_DOC_ENABLE > 0)
-            // subtract DC
-            if (k & 0x1)
-            {   // Q
-                sumQ += tmp;
-                *outPtr++ = float(tmp) - dcQ;
-            }
-            else
-            {  // I
-                sumI += tmp;
-                *outPtr++ = float(tmp) - dcI;
-            }
-#else
-            *outPtr++ = float(tmp);
-#endif  // RTLSDR_DOC_ENABLE
-#endif  // ((RTLSDR_DOC_ENABLE == 0) && ((RTLSDR_AGC_ENABLE == 0)))
-        }
-
-        outPtr = (float *)(inputBuffer.buffer);
-        for (uint64_t k=0; k<len-samplesTillEnd; ++k)
-        {   // convert to float
-#if ((RTLSDR_DOC_ENABLE == 0) && ((RTLSDR_AGC_ENABLE == 0)))
-            *outPtr++ = float(*inPtr++ - 128);  // I or Q
-#else // ((RTLSDR_DOC_ENABLE == 0) && ((RTLSDR_AGC_ENABLE == 0)))
-            int_fast8_t tmp = *inPtr++ - 128; // I or Q
-
-#if (RTLSDR_AGC_ENABLE > 0)
-            int_fast8_t absTmp = abs(tmp);
-
-            // calculate signal level (rectifier, fast attack slow release)
-            float c = m_agcLevel_crel;
-            if (absTmp > agcLev)
-            {
-                c = m_agcLevel_catt;
-            }
-            agcLev = c * absTmp + agcLev - c * agcLev;
-#endif  // (RTLSDR_AGC_ENABLE > 0)
-
-#if (RTLSDR_DOC_ENABLE > 0)
-            // subtract DC
-            if (k & 0x1)
-            {   // Q
-                sumQ += tmp;
-                *outPtr++ = float(tmp) - dcQ;
-            }
-            else
-            {  // I
-                sumI += tmp;
-                *outPtr++ = float(tmp) - dcI;
-            }
-#else
-            *outPtr++ = float(tmp);
-#endif  // RTLSDR_DOC_ENABLE
-#endif  // ((RTLSDR_DOC_ENABLE == 0) && ((RTLSDR_AGC_ENABLE == 0)))
-        }
-        inputBuffer.head = (len-samplesTillEnd)*sizeof(float);
-    }
-
-#if (RTLSDR_DOC_ENABLE > 0)
-    // calculate correction values for next input buffer
-    m_dcI = sumI * m_doc_c / (len >> 1) + dcI - m_doc_c * dcI;
-    m_dcQ = sumQ * m_doc_c / (len >> 1) + dcQ - m_doc_c * dcQ;
+    m_inputBuffer->telemetry().setSignalLevel(m_levelStage->signalLevel());
+    emit agcLevel(m_levelStage->signalLevel());
 #endif
-
-#if (RTLSDR_AGC_ENABLE > 0)
-    // store memory
-    m_agcLevel = agcLev;
-
-    emit agcLevel(agcLev);
-#endif
-
-    pthread_mutex_lock(&inputBuffer.countMutex);
-    inputBuffer.count = inputBuffer.count + len*sizeof(float);
-    pthread_cond_signal(&inputBuffer.countCondition);
-    pthread_mutex_unlock(&inputBuffer.countMutex);
 }
 
@@ -32,13 +32,18 @@
 #include <QTimer>
 #include <rtl-sdr.h>
 #include "inputdevice.h"
+#include "inputdevicepipeline.h"
 
 #define RTLSDR_DOC_ENABLE  1   // enable DOC
 #define RTLSDR_AGC_ENABLE  1   // enable AGC
 
-// init value of the counter used to reset buffer after tune
-// RTLSDR_START_COUNTER_INIT-1 buffers will be discarded
-#define RTLSDR_RESTART_COUNTER 2
+// samples discarded after tune: USB transfer that is being filled when device is tuned contains samples
+// of previous frequency, then samples received while tuner settles [ms]
+#define RTLSDR_RETUNE_TRANSFERS 1
+#define RTLSDR_RETUNE_SETTLE_MS 5
+
+// number of USB transfers in low-latency mode (librtlsdr default of 15 transfers is used otherwise)
+#define RTLSDR_LOWLATENCY_BUF_NUM 8
 
 #define RTLSDR_AGC_LEVEL_MAX_DEFAULT 105
 
@@ -46,36 +51,27 @@ class RtlSdrWorker : public QThread
 {
     Q_OBJECT
 public:
-    explicit RtlSdrWorker(struct rtlsdr_dev *device, QObject *parent = nullptr);
+    explicit RtlSdrWorker(struct rtlsdr_dev *device, fifo_t * inputBuffer, QObject *parent = nullptr);
+    ~RtlSdrWorker();
     void startStopRecording(bool ena);
     bool isRunning();
-    void restart();
+    void restart(uint32_t frequency);
 protected:
     void run() override;
 signals:
     void agcLevel(float level);
     void recordBuffer(const uint8_t * buf, uint32_t len);
-    void dataReady();
 private:
     QObject * m_rtlSdrPtr;
     struct rtlsdr_dev * m_device;
+    fifo_t * m_inputBuffer;
     std::atomic<bool> m_isRecording;
     std::atomic<bool> m_watchdogFlag;
-    std::atomic<int8_t> m_captureStartCntr;
-
-    // DOC memory
-    float m_dcI = 0.0;
-    float m_dcQ = 0.0;
-#if (RTLSDR_DOC_ENABLE > 0)
-    constexpr static const float m_doc_c = 0.05;
-#endif
-
-    // AGC memory
-    float m_agcLevel = 0.0;
-#if (RTLSDR_AGC_ENABLE > 0)
-    constexpr static const float m_agcLevel_catt = 0.1;
-    constexpr static const float m_agcLevel_crel = 0.00005;
-#endif
+
+    // input processing: record tap -> FIFO -> AGC level
+    InputDevicePipeline * m_pipeline;
+    InputPipelineFifoWriter * m_fifoWriter;
+    InputPipelineLevelU8 * m_levelStage = nullptr;
 
     void processInputData(unsigned char *buf, uint32_t len);
     static void callback(unsigned char *buf, uint32_t len, void *ctx);
@@ -85,7 +81,7 @@ class RtlSdrInput : public InputDevice
 {
     Q_OBJECT
 public:
-    explicit RtlSdrInput(QObject *parent = nullptr);
+    explicit RtlSdrInput(fifo_t * inputBuffer, QObject *parent = nullptr);
     ~RtlSdrInput();
     bool openDevice() override;
     void tune(uint32_t frequency) override;
@@ -103,6 +99,7 @@ private:
     int m_ppm;
     struct rtlsdr_dev * m_device;
     RtlSdrWorker * m_worker;
+    bool m_isRecording = false;     // recording state is kept when worker is restarted
     QTimer m_watchdogTimer;
     RtlGainMode m_gainMode = RtlGainMode::Hardware;
     int m_gainIdx;
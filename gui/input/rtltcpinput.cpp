@@ -24,7 +24,11 @@
  * SOFTWARE.
  */
 
+#include <cstring>
+#include <chrono>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QDebug>
 #include <QLoggingCategory>
 #include "rtltcpinput.h"
@@ -69,7 +73,44 @@ public:
 static SocketInitialiseWrapper socketInitialiseWrapper;
 #endif
 
-RtlTcpInput::RtlTcpInput(QObject *parent) : InputDevice(parent)
+// large socket receive buffer keeps TCP window open while converter is busy
+// it must be set before connect() so that TCP window scaling is negotiated
+static void setSocketReceiveBuffer(SOCKET sfd)
+{
+    int rcvBuf = RTLTCP_SOCKET_RCVBUF;
+#if defined(__linux__)
+    // setting SO_RCVBUF disables receive buffer autotuning and the value is limited by net.core.rmem_max
+    // => keep autotuning if kernel would limit the buffer below requested size
+    QFile rmemMaxFile("/proc/sys/net/core/rmem_max");
+    if (rmemMaxFile.open(QIODevice::ReadOnly))
+    {
+        int rmemMax = rmemMaxFile.readAll().trimmed().toInt();
+        if (rmemMax < rcvBuf)
+        {
+            qCInfo(rtlTcpInput, "Socket receive buffer autotuning kept (net.core.rmem_max = %d)", rmemMax);
+            return;
+        }
+    }
+#endif
+    int currentBuf = 0;
+    socklen_t optLen = sizeof(currentBuf);
+    if ((0 == getsockopt(sfd, SOL_SOCKET, SO_RCVBUF, (char *) &currentBuf, &optLen)) && (currentBuf >= rcvBuf))
+    {   // already large enough
+        return;
+    }
+    if (0 != setsockopt(sfd, SOL_SOCKET, SO_RCVBUF, (const char *) &rcvBuf, sizeof(rcvBuf)))
+    {
+        qCWarning(rtlTcpInput) << "Failed to set socket receive buffer size";
+        return;
+    }
+    optLen = sizeof(currentBuf);
+    if (0 == getsockopt(sfd, SOL_SOCKET, SO_RCVBUF, (char *) &currentBuf, &optLen))
+    {
+        qCInfo(rtlTcpInput, "Socket receive buffer size: %d bytes", currentBuf);
+    }
+}
+
+RtlTcpInput::RtlTcpInput(fifo_t *inputBuffer, QObject *parent) : InputDevice(inputBuffer, parent)
 {
     m_deviceDescription.id = InputDeviceId::RTLTCP;
 
@@ -92,7 +133,7 @@ RtlTcpInput::~RtlTcpInput()
     // need to end worker thread and close socket
     if (nullptr != m_worker)
     {
-        m_worker->captureIQ(false);
+        m_worker->captureIQ(0);
 
         // close socket
 #if defined(_WIN32)
@@ -109,10 +150,7 @@ RtlTcpInput::~RtlTcpInput()
             qCWarning(rtlTcpInput) << "Worker thread not finished after timeout - this should not happen :-(";
 
             // reset buffer - and tell the thread it is empty - buffer will be reset in any case
-            pthread_mutex_lock(&inputBuffer.countMutex);
-            inputBuffer.count = 0;
-            pthread_cond_signal(&inputBuffer.countCondition);
-            pthread_mutex_unlock(&inputBuffer.countMutex);
+            m_inputBuffer->reset();
             m_worker->wait(2000);
         }
     }
@@ -169,6 +207,8 @@ bool RtlTcpInput::openDevice()
             continue;
         }
 
+        setSocketReceiveBuffer(sfd);
+
         // Set non-blocking
 #if defined(_WIN32)
         /// Windows sockets are created in blocking mode by default
@@ -460,14 +500,17 @@ bool RtlTcpInput::openDevice()
         //setGainMode(RtlGainMode::Software);
         m_gainIdx = -1;
 
+        // samples are stored in FIFO as uint8
+        m_inputBuffer->setSampleFormat(InputFifoSampleFormat::SAMPLE_FORMAT_U8, (RTLTCP_DOC_ENABLE > 0));
+
         // need to create worker, server is pushing samples
-        m_worker = new RtlTcpWorker(m_sock, this);
+        m_worker = new RtlTcpWorker(m_sock, m_inputBuffer, this);
         connect(m_worker, &RtlTcpWorker::agcLevel, this, &RtlTcpInput::onAgcLevel, Qt::QueuedConnection);
-        connect(m_worker, &RtlTcpWorker::dataReady, this, [=](){ emit tuned(m_frequency); }, Qt::QueuedConnection);
         connect(m_worker, &RtlTcpWorker::recordBuffer, this, &InputDevice::recordBuffer, Qt::DirectConnection);
         connect(m_worker, &RtlTcpWorker::finished, this, &RtlTcpInput::onReadThreadStopped, Qt::QueuedConnection);
         connect(m_worker, &RtlTcpWorker::finished, m_worker, &QObject::deleteLater);
         connect(m_worker, &RtlTcpWorker::destroyed, this, [=]() { m_worker = nullptr; } );
+        m_worker->startStopRecording(m_isRecording);
         m_worker->start();
         m_watchdogTimer.start(1000 * INPUTDEVICE_WDOG_TIMEOUT_SEC);
         emit deviceReady();
@@ -492,15 +535,16 @@ void RtlTcpInput::tune(uint32_t frequency)
         // does nothing if not SW AGC
         resetAgc();
 
-        m_worker->captureIQ(true);
+        m_worker->captureIQ(m_frequency);
 
-        // tuned(m_frequency) is emited when dataReady() from worker
+        // samples received before tune are skipped by consumer using FIFO epoch
+        emit tuned(m_frequency);
     }
     else
     {
         if (nullptr != m_worker)
         {
-            m_worker->captureIQ(false);
+            m_worker->captureIQ(0);
         }
 
         emit tuned(0);
@@ -642,7 +686,7 @@ void RtlTcpInput::onReadThreadStopped()
     m_watchdogTimer.stop();
 
     // fill buffer (artificially to avoid blocking of the DAB processing thread)
-    inputBuffer.fillDummy();
+    m_inputBuffer->fillDummy();
 
     emit error(InputDeviceErrorCode::DeviceDisconnected);
 }
@@ -654,7 +698,7 @@ void RtlTcpInput::onWatchdogTimeout()
         if (!m_worker->isRunning())
         {  // some problem in data input
             qCCritical(rtlTcpInput) << "watchdog timeout";
-            inputBuffer.fillDummy();
+            m_inputBuffer->fillDummy();
             emit error(InputDeviceErrorCode::NoDataAvailable);
         }
     }
@@ -666,7 +710,11 @@ void RtlTcpInput::onWatchdogTimeout()
 
 void RtlTcpInput::startStopRecording(bool start)
 {
-    m_worker->startStopRecording(start);
+    m_isRecording = start;
+    if (nullptr != m_worker)
+    {
+        m_worker->startStopRecording(start);
+    }
 }
 
 QList<float> RtlTcpInput::getGainList() const
@@ -697,36 +745,85 @@ void RtlTcpInput::sendCommand(const RtlTcpCommand & cmd, uint32_t param)
     ::send(m_sock, (char *) cmdBuffer, 5, 0);
 }
 
-RtlTcpWorker::RtlTcpWorker(SOCKET sock, QObject *parent) : QThread(parent)
+RtlTcpReader::RtlTcpReader(SOCKET sock, uint32_t chunkSize, int numChunks, QObject *parent) : QThread(parent)
+  , m_freeChunks(numChunks)
 {
-    m_isRecording = false;
-    m_enaCaptureIQ = false;
     m_sock = sock;
+    m_chunkSize = chunkSize;
+    m_numChunks = numChunks;
+    m_stopRequest = false;
+    m_pool.resize(numChunks * chunkSize);
+
+    m_bytesReceived = 0;
+    m_tcpStalls = 0;
+    m_readerWaits = 0;
 }
 
-void RtlTcpWorker::startStopRecording(bool ena)
+void RtlTcpReader::stop()
 {
-    m_isRecording = ena;
+    m_stopRequest = true;
 }
 
-void RtlTcpWorker::run()
+const uint8_t *RtlTcpReader::acquireChunk(int timeoutMs)
 {
-    m_dcI = 0.0;
-    m_dcQ = 0.0;
-    m_agcLevel = 0.0;
-    m_watchdogFlag = false;  // first callback sets it to true
+    if (!m_filledChunks.tryAcquire(1, timeoutMs))
+    {
+        return nullptr;
+    }
+    return &m_pool[m_readIdx * m_chunkSize];
+}
 
-    // read samples
-    while (INVALID_SOCKET != m_sock)
+void RtlTcpReader::releaseChunk()
+{
+    m_readIdx = (m_readIdx + 1) % m_numChunks;
+    m_freeChunks.release();
+}
+
+uint64_t RtlTcpReader::bytesPending() const
+{
+#if _WIN32
+    u_long bytes = 0;
+    if (NO_ERROR != ioctlsocket(m_sock, FIONREAD, &bytes))
     {
+        return 0;
+    }
+#else
+    int bytes = 0;
+    if ((0 != ::ioctl(m_sock, FIONREAD, &bytes)) || (bytes < 0))
+    {
+        return 0;
+    }
+#endif
+    return bytes;
+}
+
+void RtlTcpReader::run()
+{
+    while (!m_stopRequest)
+    {
+        // get free chunk
+        if (!m_freeChunks.tryAcquire())
+        {   // converter is too slow, socket is not read meanwhile
+            m_readerWaits++;
+            while (!m_freeChunks.tryAcquire(1, 100))
+            {
+                if (m_stopRequest)
+                {
+                    goto reader_exit;
+                }
+            }
+        }
+        uint8_t * chunk = &m_pool[m_writeIdx * m_chunkSize];
+
         size_t read = 0;
         do
         {
-            ssize_t ret = ::recv(m_sock, (char *) m_bufferIQ+read, RTLTCP_CHUNK_SIZE - read, 0);
+            auto recvStart = std::chrono::steady_clock::now();
+            ssize_t ret = ::recv(m_sock, (char *) chunk+read, m_chunkSize - read, 0);
             if (0 == ret)
             {   // disconnected => finish thread operation
                 qCCritical(rtlTcpInput) << "socket disconnected";
-                goto worker_exit;
+                goto reader_exit;
             }
             else if (-1 == ret)
             {
@@ -739,17 +836,17 @@ void RtlTcpWorker::run()
                 {   // disconnected => finish thread operation
                     // when socket is diconnected under Win, recv returns -1 but error code is 0
                     qCCritical(rtlTcpInput) << "RTL-TCP: socket disconnected";
-                    goto worker_exit;
+                    goto reader_exit;
                 }
                 else if ((WSAECONNRESET == WSAGetLastError()) || (WSAEBADF == WSAGetLastError()))
                 {   // disconnected => finish thread operation
                     qCCritical(rtlTcpInput) << "RTL-TCP: socket read error:" << strerror(WSAGetLastError());
-                    goto worker_exit;
+                    goto reader_exit;
                 }
                 else
                 {
                     qCCritical(rtlTcpInput) << "RTL-TCP: socket read error:" << strerror(WSAGetLastError());
-                    goto worker_exit;
+                    goto reader_exit;
                 }
 #else
                 if ((EAGAIN == errno) || (EINTR == errno))
@@ -759,259 +856,189 @@ void RtlTcpWorker::run()
                 else if ((ECONNRESET == errno) || (EBADF == errno))
                 {   // disconnected => finish thread operation
                     qCCritical(rtlTcpInput) << "error: " << strerror(errno);
-                    goto worker_exit;
+                    goto reader_exit;
                 }
                 else
                 {
                     qCCritical(rtlTcpInput) << "socket read error:" << strerror(errno);
-                    goto worker_exit;
+                    goto reader_exit;
                 }
 #endif
             }
             else
             {
                 read += ret;
+                m_bytesReceived += ret;
+                if (std::chrono::steady_clock::now() - recvStart > std::chrono::milliseconds(RTLTCP_STALL_MS))
+                {   // no data for too long
+                    m_tcpStalls++;
+                }
             }
-        } while (RTLTCP_CHUNK_SIZE > read);
-
-        // reset watchDog flag, timer sets it to true
-        m_watchdogFlag = true;
+        } while (m_chunkSize > read);
 
         // full chunk is read at this point
-        if (m_enaCaptureIQ)
-        {   // process data
-            if (m_captureStartCntr > 0)
-            {   // reset procedure
-                if (0 == --m_captureStartCntr)
-                {   // restart finished
-
-                    // clear buffer to avoid mixing of channels
-                    inputBuffer.reset();
-
-                    m_dcI = 0.0;
-                    m_dcQ = 0.0;
-                    //m_agcLevel = 0.0;
-
-                    emit dataReady();
-                }
-                else
-                {   // only reecord if recording
-                    if (m_isRecording)
-                    {
-                        emit recordBuffer(m_bufferIQ, RTLTCP_CHUNK_SIZE);
-                    }
-                    else { /* not recording */ }
-
-                    // done
-                    continue;
-                }
-            }
-            processInputData(m_bufferIQ, RTLTCP_CHUNK_SIZE);
-        }
+        m_writeIdx = (m_writeIdx + 1) % m_numChunks;
+        m_filledChunks.release();
     }
 
-worker_exit:    
+reader_exit:
     // single exit point
     return;
 }
 
-void RtlTcpWorker::captureIQ(bool ena)
+RtlTcpWorker::RtlTcpWorker(SOCKET sock, fifo_t *inputBuffer, QObject *parent) : QThread(parent)
 {
-    if (ena)
-    {
-        m_captureStartCntr = RTLTCP_START_COUNTER_INIT;
-    }
-    m_enaCaptureIQ = ena;
+    m_isRecording = false;
+    m_enaCaptureIQ = false;
+    m_retunePending = false;
+    m_sock = sock;
+    m_inputBuffer = inputBuffer;
+    m_chunkSize = m_inputBuffer->transferIQSamples()*2;
+    m_chunksConverted = 0;
+    m_convertNs = 0;
+    m_lastStats = { 0, 0, 0, 0, 0 };
+
+    m_reader = new RtlTcpReader(sock, m_chunkSize, m_inputBuffer->isLowLatency() ? RTLTCP_LOWLATENCY_READER_BUFFERS : RTLTCP_READER_BUFFERS);
+
+    m_pipeline = new InputDevicePipeline("RTL-TCP", &m_inputBuffer->telemetry());
+    m_pipeline->addStage(new InputPipelineRecordTap([this](const uint8_t * buf, uint32_t len) { emit recordBuffer(buf, len); }, m_isRecording));
+    m_fifoWriter = m_pipeline->addStage(new InputPipelineFifoWriter(m_inputBuffer));
+#if (RTLTCP_AGC_ENABLE > 0)
+    m_levelStage = m_pipeline->addStage(new InputPipelineLevelU8());
+#endif
 }
 
-bool RtlTcpWorker::isRunning()
+RtlTcpWorker::~RtlTcpWorker()
 {
-    bool flag = m_watchdogFlag;
-    m_watchdogFlag = false;
-    return flag;
+    m_reader->stop();
+    m_reader->wait();
+    delete m_reader;
+    delete m_pipeline;
 }
 
-void RtlTcpWorker::processInputData(unsigned char *buf, uint32_t len)
+void RtlTcpWorker::startStopRecording(bool ena)
 {
-#if (RTLTCP_DOC_ENABLE > 0)
-    int_fast32_t sumI = 0;
-    int_fast32_t sumQ = 0;
-#endif
-
-    if (m_isRecording)
-    {
-        emit recordBuffer(buf, len);
-    }
-
-    // retrieving memories
-#if (RTLTCP_DOC_ENABLE > 0)
-    float dcI = m_dcI;
-    float dcQ = m_dcQ;
-#endif
-#if (RTLTCP_AGC_ENABLE > 0)
-    float agcLev = m_agcLevel;
-#endif
+    m_isRecording = ena;
+}
 
-    // len is number of I and Q samples
-    // get FIFO space
-    pthread_mutex_lock(&inputBuffer.countMutex);
-    uint64_t count = inputBuffer.count;
-    Q_ASSERT(count <= INPUT_FIFO_SIZE);
+void RtlTcpWorker::run()
+{
+    m_pipeline->reset();
+    m_watchdogFlag = false;  // first callback sets it to true
 
-    pthread_mutex_unlock(&inputBuffer.countMutex);
+    m_reader->start(QThread::HighPriority);
 
-    if ((INPUT_FIFO_SIZE - count) < len*sizeof(float))
-    {
-        qCWarning(rtlTcpInput) << "dropping" << len << "bytes...";
-        return;
-    }
+    QElapsedTimer statsTimer;
+    statsTimer.start();
 
-    // input samples are IQ = [uint8_t uint8_t]
-    // going to transform them to [float float] = float _Complex
-    // on uint8_t will be transformed to one float
+    // stream position of acquired chunk [bytes received by reader]
+    uint64_t chunkPos = 0;
 
-    // there is enough room in buffer
-    uint64_t bytesTillEnd = INPUT_FIFO_SIZE - inputBuffer.head;
-    uint8_t * inPtr = buf;
-    if (bytesTillEnd >= len*sizeof(float))
+    // convert samples received by reader thread
+    while (true)
     {
-        float * outPtr = (float *)(inputBuffer.buffer + inputBuffer.head);
-        for (uint64_t k=0; k<len; k++)
-        {   // convert to float
-#if ((RTLTCP_DOC_ENABLE == 0) && ((RTLTCP_AGC_ENABLE == 0)))
-            *outPtr++ = float(*inPtr++ - 128);  // I or Q
-#else // ((RTLTCP_DOC_ENABLE == 0) && ((RTLTCP_AGC_ENABLE == 0)))
-            int_fast8_t tmp = *inPtr++ - 128; // I or Q
+        const uint8_t * chunk = m_reader->acquireChunk(100);
+        if (nullptr == chunk)
+        {
+            if (m_reader->isFinished())
+            {   // socket disconnected or closed
+                break;
+            }
+            continue;
+        }
 
-#if (RTLTCP_AGC_ENABLE > 0)
-            int_fast8_t absTmp = abs(tmp);
+        // reset watchDog flag, timer sets it to true
+        m_watchdogFlag = true;
 
-            // calculate signal level (rectifier, fast attack slow release)
-            float c = m_agcLevel_crel;
-            if (absTmp > agcLev)
-            {
-                c = m_agcLevel_catt;
-            }
-            agcLev = c * absTmp + agcLev - c * agcLev;
-#endif  // (RTLTCP_AGC_ENABLE > 0)
-
-#if (RTLTCP_DOC_ENABLE > 0)
-            // subtract DC
-            if (k & 0x1)
-            {   // Q
-                sumQ += tmp;
-                *outPtr++ = float(tmp) - dcQ;
-            }
-            else
-            {  // I
-                sumI += tmp;
-                *outPtr++ = float(tmp) - dcI;
+        // full chunk is available at this point
+        if (m_enaCaptureIQ)
+        {   // process data
+            if (m_retunePending)
+            {   // bytes received by reader until retune position are stale, chunk starts at chunkPos
+                std::lock_guard<std::mutex> guard(m_retuneMutex);
+                uint64_t staleBytes = (m_retuneStreamPos > chunkPos) ? (m_retuneStreamPos - chunkPos) : 0;
+                m_fifoWriter->retune(m_retuneFrequency, (staleBytes + 1) / 2);
+                m_retunePending = false;
             }
-#else
-            *outPtr++ = float(tmp);
-#endif  // RTLTCP_DOC_ENABLE
-#endif  // ((RTLTCP_DOC_ENABLE == 0) && ((RTLTCP_AGC_ENABLE == 0)))
+            auto convertStart = std::chrono::steady_clock::now();
+            processInputData(chunk, m_chunkSize);
+            m_convertNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - convertStart).count();
+            m_chunksConverted++;
         }
-        inputBuffer.head = (inputBuffer.head + len*sizeof(float));
-    }
-    else
-    {
-        Q_ASSERT(sizeof(float) == 4);
-        uint64_t samplesTillEnd = bytesTillEnd >> 2; // / sizeof(float);
+        m_reader->releaseChunk();
+        chunkPos += m_chunkSize;
 
-        float * outPtr = (float *)(inputBuffer.buffer + inputBuffer.head);
-        for (uint64_t k=0; k<samplesTillEnd; ++k)
-        {   // convert to float
-#if ((RTLTCP_DOC_ENABLE == 0) && ((RTLTCP_AGC_ENABLE == 0)))
-            *outPtr++ = float(*inPtr++ - 128);  // I or Q
-#else // ((RTLTCP_DOC_ENABLE == 0) && ((RTLTCP_AGC_ENABLE == 0)))
-            int_fast8_t tmp = *inPtr++ - 128; // I or Q
+        if (statsTimer.elapsed() >= RTLTCP_STATS_PERIOD_MS)
+        {
+            logStatistics(false);
+            statsTimer.restart();
+        }
+    }
 
-#if (RTLTCP_AGC_ENABLE > 0)
-            int_fast8_t absTmp = abs(tmp);
+    m_reader->wait();
+    logStatistics(true);
+}
 
-            // calculate signal level (rectifier, fast attack slow release)
-            float c = m_agcLevel_crel;
-            if (absTmp > agcLev)
-            {
-                c = m_agcLevel_catt;
-            }
-            agcLev = c * absTmp + agcLev - c * agcLev;
-#endif  // (RTLTCP_AGC_ENABLE > 0)
-
-#if (RTLTCP_DOC_ENABLE > 0)
-            // subtract DC
-            if (k & 0x1)
-            {   // Q
-                sumQ += tmp;
-                *outPtr++ = float(tmp) - dcQ;
-            }
-            else
-            {  // I
-                sumI += tmp;
-                *outPtr++ = float(tmp) - dcI;
-            }
-#else
-            *outPtr++ = float(tmp);
-#endif  // RTLTCP_DOC_ENABLE
-#endif  // ((RTLTCP_DOC_ENABLE == 0) && ((RTLTCP_AGC_ENABLE == 0)))
-        }
+void RtlTcpWorker::captureIQ(uint32_t frequency)
+{
+    if (0 != frequency)
+    {   // samples received before the tune are not written to FIFO, new FIFO epoch starts with first sample after tune
+        // data already buffered by reader or socket and data that server sends before it tunes are stale
+        std::lock_guard<std::mutex> guard(m_retuneMutex);
+        m_retuneFrequency = frequency;
+        m_retuneStreamPos = m_reader->bytesReceived() + m_reader->bytesPending() + RTLTCP_RETUNE_SERVER_BYTES + RTLTCP_RETUNE_SETTLE_MS * 2048 * 2;
+        m_retunePending = true;
+    }
+    m_enaCaptureIQ = (0 != frequency);
+}
 
-        outPtr = (float *)(inputBuffer.buffer);
-        for (uint64_t k=0; k<len-samplesTillEnd; ++k)
-        {   // convert to float
-#if ((RTLTCP_DOC_ENABLE == 0) && ((RTLTCP_AGC_ENABLE == 0)))
-            *outPtr++ = float(*inPtr++ - 128);  // I or Q
-#else // ((RTLTCP_DOC_ENABLE == 0) && ((RTLTCP_AGC_ENABLE == 0)))
-            int_fast8_t tmp = *inPtr++ - 128; // I or Q
+bool RtlTcpWorker::isRunning()
+{
+    bool flag = m_watchdogFlag;
+    m_watchdogFlag = false;
+    return flag;
+}
 
-#if (RTLTCP_AGC_ENABLE > 0)
-            int_fast8_t absTmp = abs(tmp);
+RtlTcpStatistics RtlTcpWorker::statistics() const
+{
+    RtlTcpStatistics stats;
+    stats.bytesReceived = m_reader->bytesReceived();
+    stats.tcpStalls = m_reader->tcpStalls();
+    stats.readerWaits = m_reader->readerWaits();
+    stats.chunksConverted = m_chunksConverted;
+    stats.convertNs = m_convertNs;
+    return stats;
+}
 
-            // calculate signal level (rectifier, fast attack slow release)
-            float c = m_agcLevel_crel;
-            if (absTmp > agcLev)
-            {
-                c = m_agcLevel_catt;
-            }
-            agcLev = c * absTmp + agcLev - c * agcLev;
-#endif  // (RTLTCP_AGC_ENABLE > 0)
-
-#if (RTLTCP_DOC_ENABLE > 0)
-            // subtract DC
-            if (k & 0x1)
-            {   // Q
-                sumQ += tmp;
-                *outPtr++ = float(tmp) - dcQ;
-            }
-            else
-            {  // I
-                sumI += tmp;
-                *outPtr++ = float(tmp) - dcI;
-            }
-#else
-            *outPtr++ = float(tmp);
-#endif  // RTLTCP_DOC_ENABLE
-#endif  // ((RTLTCP_DOC_ENABLE == 0) && ((RTLTCP_AGC_ENABLE == 0)))
-        }
-        inputBuffer.head = (len-samplesTillEnd)*sizeof(float);
+void RtlTcpWorker::logStatistics(bool summary)
+{
+    RtlTcpStatistics stats = statistics();
+    if (summary)
+    {
+        qCInfo(rtlTcpInput, "Received %llu kB, %u TCP stalls, %u reader waits, avg. conversion %.3f ms/chunk",
+               (unsigned long long) (stats.bytesReceived / 1024), stats.tcpStalls, stats.readerWaits,
+               stats.chunksConverted ? stats.convertNs * 1e-6 / stats.chunksConverted : 0.0);
+        return;
     }
 
-#if (RTLTCP_DOC_ENABLE > 0)
-    // calculate correction values for next input buffer
-    m_dcI = sumI * m_doc_c / (len >> 1) + dcI - m_doc_c * dcI;
-    m_dcQ = sumQ * m_doc_c / (len >> 1) + dcQ - m_doc_c * dcQ;
-#endif
+    uint64_t chunks = stats.chunksConverted - m_lastStats.chunksConverted;
+    qCDebug(rtlTcpInput, "%.1f kB/s, %u TCP stalls, %u reader waits, avg. conversion %.3f ms/chunk",
+            (stats.bytesReceived - m_lastStats.bytesReceived) / 1.024 / RTLTCP_STATS_PERIOD_MS,
+            stats.tcpStalls - m_lastStats.tcpStalls, stats.readerWaits - m_lastStats.readerWaits,
+            chunks ? (stats.convertNs - m_lastStats.convertNs) * 1e-6 / chunks : 0.0);
+    m_lastStats = stats;
+}
+
+void RtlTcpWorker::processInputData(const uint8_t *buf, uint32_t len)
+{
+    // input samples are IQ = [uint8_t uint8_t], len is number of I and Q samples
+    if (!m_pipeline->process(buf, len/2, InputFifoSampleFormat::SAMPLE_FORMAT_U8))
+    {   // FIFO full
+        return;
+    }
 
 #if (RTLTCP_AGC_ENABLE > 0)
-    // store memory
-    m_agcLevel = agcLev;
-    emit agcLevel(agcLev);
+    m_inputBuffer->telemetry().setSignalLevel(m_levelStage->signalLevel());
+    emit agcLevel(m_levelStage->signalLevel());
 #endif
-
-    pthread_mutex_lock(&inputBuffer.countMutex);
-    inputBuffer.count = inputBuffer.count + len*sizeof(float);
-    pthread_cond_signal(&inputBuffer.countCondition);
-    pthread_mutex_unlock(&inputBuffer.countMutex);
 }
-
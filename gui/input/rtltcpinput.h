@@ -30,8 +30,12 @@
 #include <QObject>
 #include <QThread>
 #include <QTimer>
+#include <QSemaphore>
+#include <mutex>
+#include <vector>
 #include <rtl-sdr.h>
 #include "inputdevice.h"
+#include "inputdevicepipeline.h"
 
 // socket
 #if defined(_WIN32)
@@ -48,59 +52,116 @@
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <sys/ioctl.h>
 
 #define SOCKET int
 #define INVALID_SOCKET (-1)
 #endif
 
-#define RTLTCP_CHUNK_SIZE (16384*100)
-
 #define RTLTCP_DOC_ENABLE 1         // enable DOC
 #define RTLTCP_AGC_ENABLE 1         // enable AGC
-#define RTLTCP_START_COUNTER_INIT 2 // init value of the counter used to reset buffer after tune
+#define RTLTCP_RETUNE_SERVER_BYTES (16*32*512) // samples discarded after tune command in addition to already buffered data [bytes]
+                                             // (USB transfer being filled by rtl_tcp server when it tunes, 64 ms by default)
+#define RTLTCP_RETUNE_SETTLE_MS 5   // samples received while tuner settles are discarded too [ms]
 
 #define RTLTCP_AGC_LEVEL_MAX_DEFAULT 105
 
+#define RTLTCP_SOCKET_RCVBUF (8*1024*1024)  // requested socket receive buffer [bytes], ~2 sec of IQ data
+#define RTLTCP_READER_BUFFERS 4             // number of chunks buffered between socket reader and converter
+#define RTLTCP_LOWLATENCY_READER_BUFFERS 32 // number of transfers buffered between socket reader and converter in low-latency mode
+#define RTLTCP_STALL_MS 50                  // recv() waiting longer than this is counted as TCP stall
+#define RTLTCP_STATS_PERIOD_MS 10000        // period of statistics debug output
+
+struct RtlTcpStatistics
+{
+    uint64_t bytesReceived;     // total number of bytes received from server
+    uint32_t tcpStalls;         // number of recv() calls waiting longer than RTLTCP_STALL_MS
+    uint32_t readerWaits;       // number of times reader had no free buffer (converter too slow)
+    uint64_t chunksConverted;   // number of chunks passed to input processing
+    uint64_t convertNs;         // total input processing time
+};
+
+// socket reader thread, it only receives data from socket to pool of chunk buffers
+// conversion is done by RtlTcpWorker so that TCP receive window is not blocked by processing
+class RtlTcpReader : public QThread
+{
+    Q_OBJECT
+public:
+    explicit RtlTcpReader(SOCKET sock, uint32_t chunkSize, int numChunks, QObject *parent = nullptr);
+    void stop();
+
+    // consumer API, returns nullptr when no chunk was received within timeout
+    const uint8_t * acquireChunk(int timeoutMs);
+    void releaseChunk();
+
+    uint64_t bytesReceived() const { return m_bytesReceived; }
+    uint64_t bytesPending() const;  // received by system but not read from socket yet
+    uint32_t tcpStalls() const { return m_tcpStalls; }
+    uint32_t readerWaits() const { return m_readerWaits; }
+protected:
+    void run() override;
+private:
+    SOCKET m_sock;
+    uint32_t m_chunkSize;
+    int m_numChunks;
+    std::atomic<bool> m_stopRequest;
+
+    // pool of m_numChunks chunks, single producer single consumer
+    std::vector<uint8_t> m_pool;
+    QSemaphore m_freeChunks;
+    QSemaphore m_filledChunks;
+    int m_writeIdx = 0;
+    int m_readIdx = 0;
+
+    std::atomic<uint64_t> m_bytesReceived;
+    std::atomic<uint32_t> m_tcpStalls;
+    std::atomic<uint32_t> m_readerWaits;
+};
+
 class RtlTcpWorker : public QThread
 {
     Q_OBJECT
 public:
-    explicit RtlTcpWorker(SOCKET sock, QObject *parent = nullptr);
-    void captureIQ(bool ena);
+    explicit RtlTcpWorker(SOCKET sock, fifo_t * inputBuffer, QObject *parent = nullptr);
+    ~RtlTcpWorker();
+    void captureIQ(uint32_t frequency);     // 0 stops capture
     void startStopRecording(bool ena);
     bool isRunning();
+    RtlTcpStatistics statistics() const;
 protected:
     void run() override;
 signals:
     void agcLevel(float level);
     void recordBuffer(const uint8_t * buf, uint32_t len);
-    void dataReady();
 private:
     SOCKET m_sock;
+    fifo_t * m_inputBuffer;
 
     std::atomic<bool> m_isRecording;
     std::atomic<bool> m_enaCaptureIQ;
     std::atomic<bool> m_watchdogFlag;
-    std::atomic<int8_t> m_captureStartCntr;
 
-    // DOC memory
-    float m_dcI = 0.0;
-    float m_dcQ = 0.0;
-#if (RTLTCP_DOC_ENABLE > 0)
-    constexpr static const float m_doc_c = 0.05;
-#endif
+    // input processing: record tap -> FIFO -> AGC level
+    InputDevicePipeline * m_pipeline;
+    InputPipelineFifoWriter * m_fifoWriter;
+    InputPipelineLevelU8 * m_levelStage = nullptr;
 
-    // AGC memory
-    float m_agcLevel = 0.0;
-#if (RTLTCP_AGC_ENABLE > 0)
-    constexpr static const float m_agcLevel_catt = 0.1;
-    constexpr static const float m_agcLevel_crel = 0.00005;
-#endif
+    // retune request, position is in bytes received from socket, it is converted to FIFO writer position by worker thread
+    std::mutex m_retuneMutex;
+    std::atomic<bool> m_retunePending;
+    uint64_t m_retuneStreamPos = 0;
+    uint32_t m_retuneFrequency = 0;
+
+    // socket reader
+    RtlTcpReader * m_reader;
+    uint32_t m_chunkSize;
 
-    // input buffer
-    uint8_t m_bufferIQ[RTLTCP_CHUNK_SIZE];
+    std::atomic<uint64_t> m_chunksConverted;
+    std::atomic<uint64_t> m_convertNs;
+    RtlTcpStatistics m_lastStats;   // used for periodic statistics
 
-    void processInputData(unsigned char *buf, uint32_t len);
+    void processInputData(const uint8_t *buf, uint32_t len);
+    void logStatistics(bool summary);
 };
 
 class RtlTcpInput : public InputDevice
@@ -136,7 +197,7 @@ class RtlTcpInput : public InputDevice
     static const int unknown_gains[];
 
 public:
-    explicit RtlTcpInput(QObject *parent = nullptr);
+    explicit RtlTcpInput(fifo_t * inputBuffer, QObject *parent = nullptr);
     ~RtlTcpInput();
     bool openDevice() override;
     void tune(uint32_t frequency) override;
@@ -154,6 +215,7 @@ private:
     int m_port;
 
     RtlTcpWorker * m_worker;
+    bool m_isRecording = false;     // recording state is kept when worker is restarted
     QTimer m_watchdogTimer;
     RtlGainMode m_gainMode = RtlGainMode::Undefined;
     int m_gainIdx;
@@ -31,16 +31,19 @@
 
 Q_LOGGING_CATEGORY(soapySdrInput, "SoapySdrInput", QtInfoMsg)
 
-SoapySdrInput::SoapySdrInput(QObject *parent) : InputDevice(parent)
+SoapySdrInput::SoapySdrInput(fifo_t *inputBuffer, QObject *parent) : InputDevice(inputBuffer, parent)
 {
     m_deviceDescription.id = InputDeviceId::SOAPYSDR;
 
     m_device = nullptr;
+    m_worker = nullptr;
     m_deviceUnpluggedFlag = true;
     m_deviceRunningFlag = false;
     m_gainList = nullptr;
     m_frequency = 0;
     m_bandwidth = 0;
+    m_streamFormat = SOAPY_SDR_CF32;
+    m_streamFullScale = 1.0;
 
     connect(&m_watchdogTimer, &QTimer::timeout, this, &SoapySdrInput::onWatchdogTimeout);
 }
@@ -131,18 +134,31 @@ bool SoapySdrInput::openDevice()
         return false;
     }
 
-    // check sample format -> need CF32
+    // check sample format -> native CS16 or CS8 is preferred (converted to float by input pipeline), otherwise CF32
+    // native format avoids conversion in driver and halves memory traffic
     std::vector<std::string> formats = m_device->getStreamFormats(SOAPY_SDR_RX, m_rxChannel);
-    if (std::find(formats.begin(), formats.end(), SOAPY_SDR_CF32) == formats.end())
+    double fullScale = 0.0;
+    std::string nativeFormat = m_device->getNativeStreamFormat(SOAPY_SDR_RX, m_rxChannel, fullScale);
+    if (((SOAPY_SDR_CS16 == nativeFormat) || (SOAPY_SDR_CS8 == nativeFormat)) && (fullScale > 0))
+    {
+        m_streamFormat = nativeFormat;
+        m_streamFullScale = fullScale;
+    }
+    else if (std::find(formats.begin(), formats.end(), SOAPY_SDR_CF32) != formats.end())
+    {
+        m_streamFormat = SOAPY_SDR_CF32;
+        m_streamFullScale = 1.0;
+    }
+    else
     {   // not found
-        qCCritical(soapySdrInput) << "Failed to open device. CF32 format not supported.";
+        qCCritical(soapySdrInput) << "Failed to open device. Neither CS16/CS8 native format nor CF32 format supported.";
         SoapySDR::Device::unmake(m_device);
         m_device = nullptr;
         return false;
     }
-    else { /* CF32 supported */ }
+    qCInfo(soapySdrInput) << "Stream format" << m_streamFormat.c_str() << "full scale" << m_streamFullScale;
 
-    // Set sample rate - prefered rates: 2048, 4096 and then the lowest above 2048
+    // Set sample rate - prefered rates: 2048kHz * 2^N (decimated by halfband chain only) and then the lowest above 2048kHz
     SoapySDR::RangeList srRanges = m_device->getSampleRateRange( SOAPY_SDR_RX, m_rxChannel);
 
     QString rangesStr = "";
@@ -153,46 +169,40 @@ bool SoapySdrInput::openDevice()
     qCInfo(soapySdrInput, "Sample rate ranges: %s", rangesStr.toLocal8Bit().data());
 
     m_sampleRate = 10e8;  // dummy high value
-    bool has2048 = false;
-    bool has4096 = false;
-    for(int n = 0; n < srRanges.size(); ++n)
+    double preferredRate = 0;
+    for (double rate = 2048e3; rate <= SOAPYSDR_MAX_SAMPLE_RATE; rate *= 2)
     {
-        if (2048e3 <= srRanges[n].maximum())
-        {   // max >= 2048e3
-            if (2048e3 >= srRanges[n].minimum())
-            {   // 2048kHz is in the range => lets use it, nothing else is important
-                has2048 = true;
+        for(int n = 0; n < srRanges.size(); ++n)
+        {
+            if ((rate >= srRanges[n].minimum()) && (rate <= srRanges[n].maximum()))
+            {   // rate is in the range
+                preferredRate = rate;
                 break;
             }
-            else { /* 2048kHz is not in this range */ }
-
-            if ((4096e3 >= srRanges[n].minimum()) && (4096e3 <= srRanges[n].maximum()))
-            {   // 4096kHz is in the range
-                has4096 = true;
-            }
-            else { /* 4096kHz not in this range */ }
-
-            // we know that max >= 2048e3 && min >= 2048e3
-
-            // lets take minimum
-            if (m_sampleRate > srRanges[n].minimum())
-            {
-                m_sampleRate = srRanges[n].minimum();
-            }
+            else { /* rate is not in this range */ }
         }
-        else { /* SR range is below 2048kHz */ }
+        if (preferredRate > 0)
+        {   // the lowest 2048kHz * 2^N found
+            break;
+        }
+        else { /* try next one */ }
     }
 
-    // lets evaluate results
-    if (has2048)
+    if (preferredRate > 0)
     {
-        m_sampleRate = 2048e3;
+        m_sampleRate = preferredRate;
     }
-    else if (has4096)
-    {
-        m_sampleRate = 4096e3;
+    else
+    {   // no 2048kHz * 2^N rate supported - using the lowest possible above 2048kHz
+        for(int n = 0; n < srRanges.size(); ++n)
+        {
+            if ((2048e3 <= srRanges[n].maximum()) && (m_sampleRate > qMax(2048e3, srRanges[n].minimum())))
+            {
+                m_sampleRate = qMax(2048e3, srRanges[n].minimum());
+            }
+            else { /* SR range is below 2048kHz or its minimum is higher than current selection */ }
+        }
     }
-    else { /* neither 2048 nor 4096 kHz supported - using the lowest possible */ }
 
     try
     {
@@ -257,7 +267,7 @@ bool SoapySdrInput::openDevice()
     SoapySDR::Stream *stream;
     try
     {
-        stream = m_device->setupStream(SOAPY_SDR_RX, SOAPY_SDR_CF32, std::vector<size_t>(m_rxChannel));
+        stream = m_device->setupStream(SOAPY_SDR_RX, m_streamFormat, std::vector<size_t>(m_rxChannel));
     }
     catch(const std::exception &ex)
     {
@@ -307,7 +317,7 @@ void SoapySdrInput::tune(uint32_t frequency)
 void SoapySdrInput::run()
 {
     // Reset buffer here - worker thread it not running, DAB waits for new data
-    inputBuffer.reset();
+    m_inputBuffer->reset();
 
     if (m_frequency != 0)
     {   // Tune to new frequency
@@ -316,12 +326,14 @@ void SoapySdrInput::run()
         // does nothing if manual AGC
         resetAgc();
 
-        m_worker = new SoapySdrWorker(m_device, m_sampleRate, m_rxChannel, this);
+        m_worker = new SoapySdrWorker(m_device, m_sampleRate, m_streamFormat, m_streamFullScale, m_inputBuffer, m_rxChannel, this);
         connect(m_worker, &SoapySdrWorker::agcLevel, this, &SoapySdrInput::onAgcLevel, Qt::QueuedConnection);
         connect(m_worker, &SoapySdrWorker::recordBuffer, this, &InputDevice::recordBuffer, Qt::DirectConnection);
         connect(m_worker, &SoapySdrWorker::finished, this, &SoapySdrInput::onReadThreadStopped, Qt::QueuedConnection);
         connect(m_worker, &SoapySdrWorker::finished, m_worker, &QObject::deleteLater);
+        connect(m_worker, &SoapySdrWorker::destroyed, this, [=]() { m_worker = nullptr; } );
 
+        m_worker->startStopRecording(m_isRecording);
         m_worker->start();
         m_watchdogTimer.start(1000 * INPUTDEVICE_WDOG_TIMEOUT_SEC);
         m_deviceRunningFlag = true;
@@ -348,10 +360,7 @@ void SoapySdrInput::stop()
             qCWarning(soapySdrInput) << "Worker thread not finished after timeout - this should not happen :-(";
 
             // reset buffer - and tell the thread it is empty - buffer will be reset in any case
-            pthread_mutex_lock(&inputBuffer.countMutex);
-            inputBuffer.count = 0;
-            pthread_cond_signal(&inputBuffer.countCondition);
-            pthread_mutex_unlock(&inputBuffer.countMutex);
+            m_inputBuffer->reset();
             m_worker->wait(2000);
         }
     }
@@ -462,7 +471,7 @@ void SoapySdrInput::onReadThreadStopped()
         m_deviceRunningFlag = false;
 
         // fill buffer (artificially to avoid blocking of the DAB processing thread)
-        inputBuffer.fillDummy();
+        m_inputBuffer->fillDummy();
 
         emit error(InputDeviceErrorCode::DeviceDisconnected);
     }
@@ -481,7 +490,7 @@ void SoapySdrInput::onWatchdogTimeout()
         if (!isRunning)
         {  // some problem in data input
             qCCritical(soapySdrInput) << "Watchdog timeout";
-            inputBuffer.fillDummy();
+            m_inputBuffer->fillDummy();
             emit error(InputDeviceErrorCode::NoDataAvailable);
         }
     }
@@ -493,7 +502,11 @@ void SoapySdrInput::onWatchdogTimeout()
 
 void SoapySdrInput::startStopRecording(bool start)
 {
-    m_worker->startStopRecording(start);
+    m_isRecording = start;
+    if (nullptr != m_worker)
+    {
+        m_worker->startStopRecording(start);
+    }
 }
 
 void SoapySdrInput::setBW(uint32_t bw)
@@ -522,22 +535,42 @@ void SoapySdrInput::setBW(uint32_t bw)
     }
 }
 
-SoapySdrWorker::SoapySdrWorker(SoapySDR::Device * device, double sampleRate, int rxChannel, QObject *parent)
+SoapySdrWorker::SoapySdrWorker(SoapySDR::Device * device, double sampleRate, const std::string & streamFormat, double fullScale,
+                               fifo_t * inputBuffer, int rxChannel, QObject *parent)
     : QThread(parent)
 {
     m_isRecording = false;
     m_device =  device;
+    m_inputBuffer = inputBuffer;
     m_rxChannel = rxChannel;
+    m_streamFormat = streamFormat;
+
+    m_pipeline = new InputDevicePipeline("SoapySDR", &m_inputBuffer->telemetry());
+    if (SOAPY_SDR_CS16 == streamFormat)
+    {
+        m_inputFormat = InputFifoSampleFormat::SAMPLE_FORMAT_S16;
+        m_pipeline->addStage(new InputPipelineConvertToFloat(1.0 / fullScale));
+    }
+    else if (SOAPY_SDR_CS8 == streamFormat)
+    {
+        m_inputFormat = InputFifoSampleFormat::SAMPLE_FORMAT_S8;
+        m_pipeline->addStage(new InputPipelineConvertToFloat(1.0 / fullScale));
+    }
+    else
+    {   // CF32
+        m_inputFormat = InputFifoSampleFormat::SAMPLE_FORMAT_FLOAT;
+    }
+    m_iqSampleSize = 2 * ComplexFifo::sampleSize(m_inputFormat);
 
-    // we cannot produce more samples in SRC
-    m_filterOutBuffer = (float *) operator new[](sizeof(float) * SOAPYSDR_INPUT_SAMPLES*2, (std::align_val_t)(16));
     m_src = new InputDeviceSRC(sampleRate);
+    m_pipeline->addStage(new InputPipelineFifoWriter(m_inputBuffer, m_src));
+    m_pipeline->addStage(new InputPipelineRecordTap([this](const uint8_t * buf, uint32_t len) { emit recordBuffer(buf, len); },
+                                                    m_isRecording, (SOAPYSDR_RECORD_INT16 > 0) ? SOAPYSDR_RECORD_FLOAT2INT16 : 0));
 }
 
 SoapySdrWorker::~SoapySdrWorker()
 {
-    delete m_src;
-    operator delete [] (m_filterOutBuffer, std::align_val_t(16));
+    delete m_pipeline;
 }
 
 void SoapySdrWorker::run()
@@ -551,7 +584,7 @@ void SoapySdrWorker::run()
     SoapySDR::Stream *stream = nullptr;
     try
     {
-        stream = m_device->setupStream(SOAPY_SDR_RX, SOAPY_SDR_CF32, std::vector<size_t>(m_rxChannel));
+        stream = m_device->setupStream(SOAPY_SDR_RX, m_streamFormat, std::vector<size_t>(m_rxChannel));
     }
     catch(const std::exception &ex)
     {
@@ -561,16 +594,36 @@ void SoapySdrWorker::run()
 
     m_device->activateStream(stream);
 
-    std::complex<float> inputBuffer[SOAPYSDR_INPUT_SAMPLES];
-    void *buffs[] = {inputBuffer};
+    // driver buffers are processed directly if driver supports it (several buffers in flight, no copy)
+    // otherwise samples are read in blocks of driver MTU
+    size_t numDirectBuffers = m_device->getNumDirectAccessBuffers(stream);
+    size_t mtu = m_device->getStreamMTU(stream);
+    if (0 == mtu)
+    {
+        mtu = SOAPYSDR_INPUT_SAMPLES;
+    }
+    qCInfo(soapySdrInput) << "Stream MTU" << mtu << "samples," << numDirectBuffers << "direct access buffers";
+
+    std::vector<uint8_t> readBuffer((0 == numDirectBuffers) ? mtu * m_iqSampleSize : 0);
+    void * buffs[] = { readBuffer.data() };
 
     while (m_doReadIQ)
     {
         int flags;
         long long time_ns;
+        size_t handle = 0;
+        const void * directBuffs[] = { nullptr };
 
         // read samples with timeout 100 ms
-        int ret = m_device->readStream(stream, buffs, SOAPYSDR_INPUT_SAMPLES, flags, time_ns, 100000);
+        int ret;
+        if (numDirectBuffers > 0)
+        {
+            ret = m_device->acquireReadBuffer(stream, handle, directBuffs, flags, time_ns, 100000);
+        }
+        else
+        {
+            ret = m_device->readStream(stream, buffs, mtu, flags, time_ns, 100000);
+        }
 
         // reset watchDog flag, timer sets it to false
         m_watchdogFlag = true;
@@ -585,6 +638,7 @@ void SoapySdrWorker::run()
             if (ret == SOAPY_SDR_OVERFLOW)
             {
                 qCCritical(soapySdrInput) << "Stream overflow";
+                m_inputBuffer->telemetry().producerOverflow();
                 continue;
             }
             if (ret == SOAPY_SDR_UNDERFLOW)
@@ -597,11 +651,23 @@ void SoapySdrWorker::run()
                 qCCritical(soapySdrInput) << "Unexpected stream error" << SoapySDR_errToStr(ret);
                 break;
             }
+            if (numDirectBuffers > 0)
+            {   // empty buffer was acquired
+                m_device->releaseReadBuffer(stream, handle);
+            }
         }
         else
         {
             // OK, process data
-            processInputData(inputBuffer, ret);
+            if (numDirectBuffers > 0)
+            {
+                processInputData(directBuffs[0], ret);
+                m_device->releaseReadBuffer(stream, handle);
+            }
+            else
+            {
+                processInputData(buffs[0], ret);
+            }
         }
     }
 
@@ -617,22 +683,6 @@ void SoapySdrWorker::startStopRecording(bool ena)
     m_isRecording = ena;
 }
 
-void SoapySdrWorker::doRecordBuffer(const float *buf, uint32_t len)
-{
-#if SOAPYSDR_RECORD_INT16
-    // dumping in int16
-    int16_t int16Buf[len];
-    for (int n = 0; n < len; ++n)
-    {
-        int16Buf[n] = int16_t(*buf++ * SOAPYSDR_RECORD_FLOAT2INT16);
-    }
-    emit recordBuffer((const uint8_t *) int16Buf, len * sizeof(int16_t));
-#else
-    // dumping in float
-    emit recordBuffer((const uint8_t *) buf, len * sizeof(float));
-#endif
-}
-
 bool SoapySdrWorker::isRunning()
 {
     bool flag = m_watchdogFlag;
@@ -645,57 +695,26 @@ void SoapySdrWorker::stop()
     m_doReadIQ = false;
 }
 
-void SoapySdrWorker::processInputData(std::complex<float> buff[], size_t numSamples)
+void SoapySdrWorker::processInputData(const void * buff, size_t numSamples)
 {
-    static float signalLevel = SOAPYSDR_LEVEL_RESET;
-
-    // get FIFO space
-    pthread_mutex_lock(&inputBuffer.countMutex);
-    uint64_t count = inputBuffer.count;
-    pthread_mutex_unlock(&inputBuffer.countMutex);
-
-    Q_ASSERT(count <= INPUT_FIFO_SIZE);
-
-    // input samples are IQ = [float float] @ sampleRate
-    // going to transform them to [float float] @ 2048kHz  
-    int numOutputIQ = m_src->process((float*) buff, numSamples, m_filterOutBuffer);
-
-    uint64_t bytesToWrite = numOutputIQ * 2 * sizeof(float);
-
-    if ((INPUT_FIFO_SIZE - count) < bytesToWrite)
+    // input samples are IQ in stream format @ sampleRate
+    // going to transform them to [float float] @ 2048kHz, driver buffer can be larger than pipeline block
+    const uint8_t * data = static_cast<const uint8_t *>(buff);
+    while (numSamples > 0)
     {
-        qCWarning(soapySdrInput) << "Dropping" << numSamples << "IQ samples...";
-        return;
-    }
-
-    if (0 == (++m_signalLevelEmitCntr & 0x0F))
-    {
-        emit agcLevel(m_src->signalLevel());
-    }
-
-    if (m_isRecording)
-    {
-        doRecordBuffer(m_filterOutBuffer, 2*numOutputIQ);
-    }
-
-    // there is enough room in buffer
-    uint64_t bytesTillEnd = INPUT_FIFO_SIZE - inputBuffer.head;
+        size_t len = qMin(numSamples, size_t(SOAPYSDR_INPUT_SAMPLES));
+        if (m_pipeline->process(data, len, m_inputFormat))
+        {
+            if (0 == (++m_signalLevelEmitCntr & 0x0F))
+            {
+                m_inputBuffer->telemetry().setSignalLevel(m_src->signalLevel());
+                emit agcLevel(m_src->signalLevel());
+            }
+        }
+        else { /* FIFO full */ }
 
-    if (bytesTillEnd >= bytesToWrite)
-    {
-        std::memcpy((inputBuffer.buffer + inputBuffer.head), (uint8_t *) m_filterOutBuffer, bytesToWrite);
-        inputBuffer.head = (inputBuffer.head + bytesToWrite);
+        data += len * m_iqSampleSize;
+        numSamples -= len;
     }
-    else
-    {
-        std::memcpy((inputBuffer.buffer + inputBuffer.head), (uint8_t *) m_filterOutBuffer, bytesTillEnd);
-        std::memcpy((inputBuffer.buffer), ((uint8_t *) m_filterOutBuffer)+bytesTillEnd, bytesToWrite-bytesTillEnd);
-        inputBuffer.head = bytesToWrite-bytesTillEnd;
-    }
-
-    pthread_mutex_lock(&inputBuffer.countMutex);
-    inputBuffer.count = inputBuffer.count + bytesToWrite;
-    pthread_cond_signal(&inputBuffer.countCondition);
-    pthread_mutex_unlock(&inputBuffer.countMutex);
 }
 
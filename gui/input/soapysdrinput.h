@@ -35,11 +35,13 @@
 #include <SoapySDR/Formats.hpp>
 #include "inputdevice.h"
 #include "inputdevicesrc.h"
+#include "inputdevicepipeline.h"
 
 #define SOAPYSDR_RECORD_INT16  1               // record raw stream in int16 instead of float
 #define SOAPYSDR_RECORD_FLOAT2INT16  (32768)   // conversion constant to int16
 
-#define SOAPYSDR_INPUT_SAMPLES (16384)
+#define SOAPYSDR_INPUT_SAMPLES (16384)          // maximum block processed by input pipeline, used as MTU if driver does not report it
+#define SOAPYSDR_MAX_SAMPLE_RATE (16384e3)     // preferred sample rates are 2048kHz * 2^N up to this value
 
 #define SOAPYSDR_LEVEL_THR_MAX (0.5)
 #define SOAPYSDR_LEVEL_THR_MIN (SOAPYSDR_LEVEL_THR_MAX/20.0)
@@ -49,7 +51,8 @@ class SoapySdrWorker : public QThread
 {
     Q_OBJECT
 public:
-    explicit SoapySdrWorker(SoapySDR::Device *device, double sampleRate, int rxChannel = 0, QObject *parent = nullptr);
+    explicit SoapySdrWorker(SoapySDR::Device *device, double sampleRate, const std::string & streamFormat, double fullScale,
+                            fifo_t * inputBuffer, int rxChannel = 0, QObject *parent = nullptr);
     ~SoapySdrWorker();
     void startStopRecording(bool ena);
     bool isRunning();
@@ -61,28 +64,33 @@ signals:
     void recordBuffer(const uint8_t * buf, uint32_t len);
 private:
     SoapySDR::Device * m_device;
+    fifo_t * m_inputBuffer;
     int m_rxChannel;
     std::atomic<bool> m_isRecording;
     std::atomic<bool> m_watchdogFlag;
     std::atomic<bool> m_doReadIQ;
 
-    // SRC
-    float * m_filterOutBuffer;
-    InputDeviceSRC * m_src;
+    // stream format: CF32 or native CS16/CS8
+    std::string m_streamFormat;
+    InputFifoSampleFormat m_inputFormat;
+    size_t m_iqSampleSize;
+
+    // input processing: [conversion to float] -> SRC+FIFO -> record tap
+    InputDevicePipeline * m_pipeline;
+    InputDeviceSRC * m_src;             // owned by pipeline
 
     // AGC memory
     float m_agcLevel = 0.0;
     uint_fast8_t m_signalLevelEmitCntr;
 
-    void doRecordBuffer(const float *buf, uint32_t len);
-    void processInputData(std::complex<float> buff[], size_t numSamples);
+    void processInputData(const void * buff, size_t numSamples);
 };
 
 class SoapySdrInput : public InputDevice
 {
     Q_OBJECT
 public:
-    explicit SoapySdrInput(QObject *parent = nullptr);
+    explicit SoapySdrInput(fifo_t * inputBuffer, QObject *parent = nullptr);
     ~SoapySdrInput();
     bool openDevice() override;
     void tune(uint32_t frequency) override;
@@ -101,12 +109,15 @@ private:
     bool m_deviceUnpluggedFlag;
     bool m_deviceRunningFlag;
     SoapySDR::Device * m_device;
+    std::string m_streamFormat;
+    double m_streamFullScale;
 
     // settimgs
     QString m_devArgs;
     QString m_antenna;
     int m_rxChannel = 0;
     SoapySdrWorker * m_worker;
+    bool m_isRecording = false;     // recording state is kept when worker is restarted
     QTimer m_watchdogTimer;
     SoapyGainMode m_gainMode = SoapyGainMode::Manual;
     int m_gainIdx;
@@ -230,12 +230,15 @@ MainWindow::MainWindow(const QString &iniFilename, QWidget *parent)
     connect(m_setupDialog, &SetupDialog::expertModeToggled, this, &MainWindow::onExpertModeToggled);
     connect(m_setupDialog, &SetupDialog::newAnnouncementSettings, this, &MainWindow::onNewAnnouncementSettings);
     connect(m_setupDialog, &SetupDialog::xmlHeaderToggled, m_inputDeviceRecorder, &InputDeviceRecorder::setXmlHeaderEnabled);
+    connect(m_setupDialog, &SetupDialog::rawFileCompressionToggled, m_inputDeviceRecorder, &InputDeviceRecorder::setCompressionEnabled);
+    connect(m_setupDialog, &SetupDialog::rawFilePreTriggerChanged, m_inputDeviceRecorder, &InputDeviceRecorder::setPreTriggerSeconds);
 
     m_ensembleInfoDialog = new EnsembleInfoDialog(this);
     connect(m_ensembleInfoDialog, &EnsembleInfoDialog::recordingStart, m_inputDeviceRecorder, &InputDeviceRecorder::start);
     connect(m_ensembleInfoDialog, &EnsembleInfoDialog::recordingStop, m_inputDeviceRecorder, &InputDeviceRecorder::stop);
     connect(m_inputDeviceRecorder, &InputDeviceRecorder::recording, m_ensembleInfoDialog, &EnsembleInfoDialog::onRecording);       
     connect(m_inputDeviceRecorder, &InputDeviceRecorder::bytesRecorded, m_ensembleInfoDialog, &EnsembleInfoDialog::updateRecordingStatus, Qt::QueuedConnection);
+    connect(m_inputDeviceRecorder, &InputDeviceRecorder::bytesDropped, m_ensembleInfoDialog, &EnsembleInfoDialog::updateRecordingDropped, Qt::QueuedConnection);
 
     // status bar
     QWidget * widget = new QWidget();
@@ -530,7 +533,8 @@ MainWindow::MainWindow(const QString &iniFilename, QWidget *parent)
     ui->scrollArea->setFocusPolicy(Qt::ClickFocus);
 
     // threads
-    m_radioControl = new RadioControl();
+    m_inputReceiver = new InputReceiver();
+    m_radioControl = new RadioControl(m_inputReceiver);
     m_radioControlThread = new QThread(this);
     m_radioControlThread->setObjectName("radioControlThr");
     m_radioControl->moveToThread(m_radioControlThread);
@@ -636,6 +640,14 @@ MainWindow::MainWindow(const QString &iniFilename, QWidget *parent)
     connect(m_radioControl, &RadioControl::mscCounter, m_ensembleInfoDialog, &EnsembleInfoDialog::updateMSCstatus, Qt::QueuedConnection);
     connect(m_radioControl, &RadioControl::audioServiceSelection, m_ensembleInfoDialog, &EnsembleInfoDialog::serviceChanged, Qt::QueuedConnection);
 
+    // input statistics are collected by input FIFO and read every second
+    m_inputTelemetryTimer = new QTimer(this);
+    m_inputTelemetryTimer->setInterval(1000);
+    connect(m_inputTelemetryTimer, &QTimer::timeout, this, [this]() {
+        m_ensembleInfoDialog->updateInputTelemetry(m_inputReceiver->fifo()->telemetry().takeInterval());
+    });
+    m_inputTelemetryTimer->start();
+
     connect(m_radioControl, &RadioControl::dlDataGroup_Service, m_dlDecoder[Instance::Service], &DLDecoder::newDataGroup, Qt::QueuedConnection);
     connect(m_radioControl, &RadioControl::dlDataGroup_Announcement, m_dlDecoder[Instance::Announcement], &DLDecoder::newDataGroup, Qt::QueuedConnection);
     connect(m_radioControl, &RadioControl::audioServiceSelection, this, &MainWindow::onAudioServiceSelection, Qt::QueuedConnection);
@@ -784,6 +796,9 @@ MainWindow::~MainWindow()
     m_radioControlThread->wait();
     delete m_radioControlThread;
 
+    // dabsdr thread is finished at this point
+    delete m_inputReceiver;
+
     m_audioDecoderThread->quit();  // this deletes audiodecoder
     m_audioDecoderThread->wait();
     delete m_audioDecoderThread;
@@ -2128,6 +2143,26 @@ void MainWindow::initInputDevice(const InputDeviceId & d)
 
     // disable file recording
     m_ensembleInfoDialog->enableRecording(false);
+    m_inputDeviceRecorder->setDeviceDescription(InputDeviceDescription());
+
+    // input FIFO is allocated for each device open - memory is released when no device is used
+    if (InputDeviceId::UNDEFINED != d)
+    {
+        const SetupDialog::Settings & s = m_setupDialog->settings();
+        if (!m_inputReceiver->fifo()->alloc(s.inputFifo.chunkMs, s.inputFifo.numChunks, s.inputFifo.hugePages))
+        {
+            qCCritical(application) << "Input buffer allocation failed";
+            m_inputDevice = nullptr;   // already deleted
+            m_setupDialog->resetInputDevice();
+            initInputDevice(InputDeviceId::UNDEFINED);
+            return;
+        }
+        m_inputReceiver->fifo()->setLowLatency(s.inputFifo.lowLatency);
+    }
+    else
+    {
+        m_inputReceiver->fifo()->deallocate();
+    }
 
     switch (d)
     {
@@ -2168,7 +2203,7 @@ void MainWindow::initInputDevice(const InputDeviceId & d)
         break;
     case InputDeviceId::RTLSDR:
     {
-        m_inputDevice = new RtlSdrInput();
+        m_inputDevice = new RtlSdrInput(m_inputReceiver->fifo());
 
         // signals have to be connected before calling openDevice
 
@@ -2221,8 +2256,9 @@ void MainWindow::initInputDevice(const InputDeviceId & d)
 
             // recorder
             m_inputDeviceRecorder->setDeviceDescription(m_inputDevice->deviceDescription());
-            connect(m_inputDeviceRecorder, &InputDeviceRecorder::recording, m_inputDevice, &InputDevice::startStopRecording);
+            connect(m_inputDeviceRecorder, &InputDeviceRecorder::captureRequest, m_inputDevice, &InputDevice::startStopRecording);
             connect(m_inputDevice, &InputDevice::recordBuffer, m_inputDeviceRecorder, &InputDeviceRecorder::writeBuffer, Qt::DirectConnection);
+            m_inputDevice->startStopRecording(m_inputDeviceRecorder->isCaptureRequired());
 
             // ensemble info dialog
             connect(m_inputDevice, &InputDevice::agcGain, m_ensembleInfoDialog, &EnsembleInfoDialog::updateAgcGain);
@@ -2243,7 +2279,7 @@ void MainWindow::initInputDevice(const InputDeviceId & d)
         break;
     case InputDeviceId::RTLTCP:
     {
-        m_inputDevice = new RtlTcpInput();
+        m_inputDevice = new RtlTcpInput(m_inputReceiver->fifo());
 
         // signals have to be connected before calling openDevice
         // RTL_TCP is opened immediately and starts receiving data
@@ -2300,8 +2336,9 @@ void MainWindow::initInputDevice(const InputDeviceId & d)
 
             // recorder
             m_inputDeviceRecorder->setDeviceDescription(m_inputDevice->deviceDescription());
-            connect(m_inputDeviceRecorder, &InputDeviceRecorder::recording, m_inputDevice, &InputDevice::startStopRecording);
+            connect(m_inputDeviceRecorder, &InputDeviceRecorder::captureRequest, m_inputDevice, &InputDevice::startStopRecording);
             connect(m_inputDevice, &InputDevice::recordBuffer, m_inputDeviceRecorder, &InputDeviceRecorder::writeBuffer, Qt::DirectConnection);
+            m_inputDevice->startStopRecording(m_inputDeviceRecorder->isCaptureRequired());
 
             // ensemble info dialog
             connect(m_inputDevice, &InputDevice::agcGain, m_ensembleInfoDialog, &EnsembleInfoDialog::updateAgcGain);
@@ -2323,7 +2360,7 @@ void MainWindow::initInputDevice(const InputDeviceId & d)
     case InputDeviceId::AIRSPY:
     {
 #if HAVE_AIRSPY
-        m_inputDevice = new AirspyInput(m_setupDialog->settings().airspy.prefer4096kHz);
+        m_inputDevice = new AirspyInput(m_inputReceiver->fifo(), m_setupDialog->settings().airspy.prefer4096kHz);
 
         // signals have to be connected before calling isAvailable
 
@@ -2374,8 +2411,9 @@ void MainWindow::initInputDevice(const InputDeviceId & d)
             // ensemble info dialog
             // recorder
             m_inputDeviceRecorder->setDeviceDescription(m_inputDevice->deviceDescription());
-            connect(m_inputDeviceRecorder, &InputDeviceRecorder::recording, m_inputDevice, &InputDevice::startStopRecording);
+            connect(m_inputDeviceRecorder, &InputDeviceRecorder::captureRequest, m_inputDevice, &InputDevice::startStopRecording);
             connect(m_inputDevice, &InputDevice::recordBuffer, m_inputDeviceRecorder, &InputDeviceRecorder::writeBuffer, Qt::DirectConnection);
+            m_inputDevice->startStopRecording(m_inputDeviceRecorder->isCaptureRequired());
 
             // ensemble info dialog
             connect(m_inputDevice, &InputDevice::agcGain, m_ensembleInfoDialog, &EnsembleInfoDialog::updateAgcGain);
@@ -2402,7 +2440,7 @@ void MainWindow::initInputDevice(const InputDeviceId & d)
     case InputDeviceId::SOAPYSDR:
     {
 #if HAVE_SOAPYSDR
-        m_inputDevice = new SoapySdrInput();
+        m_inputDevice = new SoapySdrInput(m_inputReceiver->fifo());
 
         // signals have to be connected before calling isAvailable
 
@@ -2461,8 +2499,9 @@ void MainWindow::initInputDevice(const InputDeviceId & d)
             // ensemble info dialog
             // recorder
             m_inputDeviceRecorder->setDeviceDescription(m_inputDevice->deviceDescription());
-            connect(m_inputDeviceRecorder, &InputDeviceRecorder::recording, m_inputDevice, &InputDevice::startStopRecording);
+            connect(m_inputDeviceRecorder, &InputDeviceRecorder::captureRequest, m_inputDevice, &InputDevice::startStopRecording);
             connect(m_inputDevice, &InputDevice::recordBuffer, m_inputDeviceRecorder, &InputDeviceRecorder::writeBuffer, Qt::DirectConnection);
+            m_inputDevice->startStopRecording(m_inputDeviceRecorder->isCaptureRequired());
 
             // ensemble info dialog
             connect(m_inputDevice, &InputDevice::agcGain, m_ensembleInfoDialog, &EnsembleInfoDialog::updateAgcGain);
@@ -2489,7 +2528,7 @@ void MainWindow::initInputDevice(const InputDeviceId & d)
 
     case InputDeviceId::RAWFILE:
     {
-        m_inputDevice = new RawFileInput();
+        m_inputDevice = new RawFileInput(m_inputReceiver->fifo());
 
         // tuning procedure
         connect(m_radioControl, &RadioControl::tuneInputDevice, m_inputDevice, &InputDevice::tune, Qt::QueuedConnection);
@@ -2501,9 +2540,11 @@ void MainWindow::initInputDevice(const InputDeviceId & d)
 
         RawFileInputFormat format = m_setupDialog->settings().rawfile.format;
         dynamic_cast<RawFileInput*>(m_inputDevice)->setFile(m_setupDialog->settings().rawfile.file, format);
+        dynamic_cast<RawFileInput*>(m_inputDevice)->setFreeRun(m_setupDialog->settings().rawfile.freeRunEna);
 
         connect(dynamic_cast<RawFileInput*>(m_inputDevice), &RawFileInput::fileLength, m_setupDialog, &SetupDialog::onFileLength, Qt::QueuedConnection);
         connect(dynamic_cast<RawFileInput*>(m_inputDevice), &RawFileInput::fileProgress, m_setupDialog, &SetupDialog::onFileProgress, Qt::QueuedConnection);
+        connect(m_setupDialog, &SetupDialog::rawFileSeek, dynamic_cast<RawFileInput*>(m_inputDevice), &RawFileInput::seek, Qt::QueuedConnection);
 
         // we can open device now
         if (m_inputDevice->openDevice())
@@ -2616,6 +2657,8 @@ void MainWindow::loadSettings()
     s.bringWindowToForeground = settings->value("bringWindowToForegroundOnAlarm", true).toBool();
     s.noiseConcealmentLevel = settings->value("noiseConcealment", 0).toInt();
     s.xmlHeaderEna = settings->value("rawFileXmlHeader", true).toBool();
+    s.rawFileCompressionEna = settings->value("rawFileCompression", false).toBool();
+    s.rawFilePreTriggerSec = settings->value("rawFilePreTrigger", 0).toInt();
     s.spiAppEna = settings->value("spiAppEna", true).toBool();
     s.useInternet = settings->value("useInternet", true).toBool();
     s.radioDnsEna = settings->value("radioDNS", true).toBool();
@@ -2623,6 +2666,11 @@ void MainWindow::loadSettings()
     s.audioRecCaptureOutput = settings->value("audioRecCaptureOutput", false).toBool();
     s.audioRecAutoStopEna = settings->value("audioRecAutoStop", false).toBool();
 
+    s.inputFifo.chunkMs = settings->value("INPUT-FIFO/chunkMs", INPUT_CHUNK_MS_DEFAULT).toInt();
+    s.inputFifo.numChunks = settings->value("INPUT-FIFO/numChunks", INPUT_FIFO_CHUNKS_DEFAULT).toInt();
+    s.inputFifo.hugePages = settings->value("INPUT-FIFO/hugePages", false).toBool();
+    s.inputFifo.lowLatency = settings->value("INPUT-FIFO/lowLatency", false).toBool();
+
     s.uaDump.folder = settings->value("UA-STORAGE/folder", QStandardPaths::writableLocation(QStandardPaths::DownloadLocation) + "/" + appName).toString();
     s.uaDump.overwriteEna  = settings->value("UA-STORAGE/overwriteEna", false).toBool();
     s.uaDump.slsEna = settings->value("UA-STORAGE/slsEna", false).toBool();
@@ -2670,6 +2718,7 @@ void MainWindow::loadSettings()
     s.rawfile.file = settings->value("RAW-FILE/filename", QVariant(QString(""))).toString();
     s.rawfile.format = RawFileInputFormat(settings->value("RAW-FILE/format", 0).toInt());
     s.rawfile.loopEna = settings->value("RAW-FILE/loop", false).toBool();
+    s.rawfile.freeRunEna = settings->value("RAW-FILE/freeRun", false).toBool();
 
     m_setupDialog->setSettings(s);
 
@@ -2787,6 +2836,8 @@ void MainWindow::saveSettings()
     settings->setValue("language", QLocale::languageToCode(s.lang));
     settings->setValue("noiseConcealment", s.noiseConcealmentLevel);
     settings->setValue("rawFileXmlHeader", s.xmlHeaderEna);
+    settings->setValue("rawFileCompression", s.rawFileCompressionEna);
+    settings->setValue("rawFilePreTrigger", s.rawFilePreTriggerSec);
     settings->setValue("spiAppEna", s.spiAppEna);
     settings->setValue("useInternet", s.useInternet);
     settings->setValue("radioDNS", s.radioDnsEna);
@@ -2794,6 +2845,11 @@ void MainWindow::saveSettings()
     settings->setValue("audioRecCaptureOutput", s.audioRecCaptureOutput);
     settings->setValue("audioRecAutoStop", s.audioRecAutoStopEna);
 
+    settings->setValue("INPUT-FIFO/chunkMs", s.inputFifo.chunkMs);
+    settings->setValue("INPUT-FIFO/numChunks", s.inputFifo.numChunks);
+    settings->setValue("INPUT-FIFO/hugePages", s.inputFifo.hugePages);
+    settings->setValue("INPUT-FIFO/lowLatency", s.inputFifo.lowLatency);
+
     settings->setValue("UA-STORAGE/folder", s.uaDump.folder);
     settings->setValue("UA-STORAGE/overwriteEna", s.uaDump.overwriteEna);
     settings->setValue("UA-STORAGE/slsEna", s.uaDump.slsEna);
@@ -2843,6 +2899,7 @@ void MainWindow::saveSettings()
     settings->setValue("RAW-FILE/filename", s.rawfile.file);
     settings->setValue("RAW-FILE/format", int(s.rawfile.format));
     settings->setValue("RAW-FILE/loop", s.rawfile.loopEna);
+    settings->setValue("RAW-FILE/freeRun", s.rawfile.freeRunEna);
 
     if ((InputDeviceId::RAWFILE != m_inputDeviceId) && (InputDeviceId::UNDEFINED != m_inputDeviceId))
     {   // save current service and service list
@@ -160,9 +160,11 @@ private:
 
     // input device
     InputDeviceId m_inputDeviceId = InputDeviceId::UNDEFINED;
+    InputReceiver * m_inputReceiver;
     InputDevice * m_inputDevice = nullptr;
     InputDeviceId m_inputDeviceIdRequest = InputDeviceId::UNDEFINED;
     InputDeviceRecorder * m_inputDeviceRecorder = nullptr;
+    QTimer * m_inputTelemetryTimer;
 
     // audio decoder
     QThread * m_audioDecoderThread;    
@@ -24,6 +24,7 @@
  * SOFTWARE.
  */
 
+#include <chrono>
 #include <QThread>
 #include <QDate>
 #include <QTime>
@@ -39,15 +40,21 @@
 Q_LOGGING_CATEGORY(radioControl, "RadioControl", QtInfoMsg)
 //Q_LOGGING_CATEGORY(radioControl, "RadioControl", QtDebugMsg)
 
+static int64_t steadyClockNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 const uint8_t RadioControl::EEPCoderate[] =
 { // ETSI EN 300 401 V2.1.1 [6.2.1 Basic sub-channel organization] table 9 & 10
     0x14, 0x38, 0x12, 0x34,   // EEP 1-A..4-A : 1/4 3/8 1/2 3/4
     0x49, 0x47, 0x46, 0x45    // EEP 1-B..4-B : 4/9 4/7 4/6 4/5
 };
 
-RadioControl::RadioControl(QObject *parent) : QObject(parent)
+RadioControl::RadioControl(InputReceiver *input, QObject *parent) : QObject(parent)
 {
     m_dabsdrHandle = nullptr;
+    m_input = input;
     m_frequency = 0;
     m_serviceList.clear();
     m_serviceRequest.SId = m_serviceRequest.SCIdS = 0;
@@ -79,10 +86,18 @@ RadioControl::~RadioControl()
 // returns false if not successfull
 bool RadioControl::init()
 {
+    if (!m_input->isValid())
+    {
+        qCCritical(radioControl) << "Maximum number of receivers reached";
+        m_dabsdrHandle = nullptr;
+
+        return false;
+    }
+
     if (EXIT_SUCCESS == dabsdrInit(&m_dabsdrHandle))
     {
-        dabsdrRegisterInputFcn(m_dabsdrHandle, getSamples);
-        dabsdrRegisterDummyInputFcn(m_dabsdrHandle, skipSamples);
+        dabsdrRegisterInputFcn(m_dabsdrHandle, m_input->inputFcn());
+        dabsdrRegisterDummyInputFcn(m_dabsdrHandle, m_input->dummyInputFcn());
         dabsdrRegisterNotificationCb(m_dabsdrHandle, dabNotificationCb, (void *) this);
         dabsdrRegisterDynamicLabelCb(m_dabsdrHandle, dynamicLabelCb, (void*) this);
         dabsdrRegisterDataGroupCb(m_dabsdrHandle, dataGroupCb, (void*) this);
@@ -407,8 +422,12 @@ void RadioControl::start(uint32_t freq)
     if (freq)
     {   // when input device tuned, freq is passed to be set in SDR
         // when frequency is 0 then we are done (input device is in idle)
+        m_tuneInputNs = steadyClockNs();
         m_enaAutoNotification = false;
         m_frequency = freq;
+
+        // input data of previous frequency are skipped by receiver
+        m_input->setExpectedFrequency(freq);
         m_syncLevel = DABSDR_SYNC_LEVEL_NO_SYNC;
         emit signalState(uint8_t(DabSyncLevel::NoSync), 0.0);
         m_serviceList.clear();
@@ -478,6 +497,14 @@ void RadioControl::tuneService(uint32_t freq, uint32_t SId, uint8_t SCIdS)
     {
         qCInfo(radioControl, "Tuning %.3f -> %.3f MHz ...", m_frequency/1000.0, freq/1000.0);
 
+        // start of tune timing
+        m_tuneStartNs = steadyClockNs();
+        m_isTuneSyncPending = (0 != freq);
+        m_isTuneAudioPending = (0 != freq) && (0 != SId);
+
+        // any input data are accepted until input device is tuned
+        m_input->setExpectedFrequency(0);
+
         // service selection will be done after tune
         m_enaAutoNotification = false;
         m_frequency = freq;
@@ -498,6 +525,17 @@ void RadioControl::tuneService(uint32_t freq, uint32_t SId, uint8_t SCIdS)
 void RadioControl::updateSignalState(dabsdrSyncLevel_t s, int16_t snr10)
 {   
     m_syncLevel = s;
+    if (m_isTuneSyncPending && (DABSDR_SYNC_LEVEL_FIC == m_syncLevel))
+    {
+        m_isTuneSyncPending = false;
+        int64_t startNs = m_tuneStartNs;
+        qCInfo(radioControl, "Tune to %.3f MHz: input ready in %lld ms, sync in %lld ms", m_frequency/1000.0,
+               (long long) ((m_tuneInputNs - startNs) / 1000000), (long long) ((steadyClockNs() - startNs) / 1000000));
+        if (m_input->epochFrequency() == m_frequency)
+        {   // input device marks samples of new frequency
+            qCInfo(radioControl, "Sync after %.1f ms of signal", (m_input->sampleCount() - m_input->epochStartSample()) / 2048.0);
+        }
+    }
     switch (m_syncLevel)
     {
     case DABSDR_SYNC_LEVEL_NO_SYNC:
@@ -2092,6 +2130,11 @@ void RadioControl::audioDataCb(dabsdrAudioCBData_t * p, void * ctx)
 {
     RadioControl * radioCtrl = static_cast<RadioControl *>(ctx);
 
+    if (radioCtrl->m_isTuneAudioPending.exchange(false))
+    {   // first audio frame after tune
+        qCInfo(radioControl, "Tune to audio in %lld ms", (long long) ((steadyClockNs() - radioCtrl->m_tuneStartNs) / 1000000));
+    }
+
     switch (radioCtrl->m_currentService.announcement.switchState)
     {
     case AnnouncementSwitchState::NoAnnouncement:
@@ -27,6 +27,7 @@
 #ifndef RADIOCONTROL_H
 #define RADIOCONTROL_H
 
+#include <atomic>
 #include <QObject>
 #include <QMap>
 #include <QHash>
@@ -39,6 +40,8 @@
 #include "dabtables.h"
 #include "dabsdr.h"
 
+class InputReceiver;
+
 
 #define RADIO_CONTROL_UEID_INVALID  0xFF000000
 #define RADIO_CONTROL_N_CHANNELS_ENABLE  0
@@ -332,7 +335,7 @@ class RadioControl : public QObject
 {
     Q_OBJECT
 public:
-    explicit RadioControl(QObject *parent = nullptr);
+    explicit RadioControl(InputReceiver * input, QObject *parent = nullptr);
     ~RadioControl();
 
     bool init();
@@ -379,9 +382,18 @@ private:
     static const uint8_t EEPCoderate[];
 
     dabsdrHandle_t m_dabsdrHandle;
+    InputReceiver * m_input;
     dabsdrSyncLevel_t m_syncLevel;
     bool m_enaAutoNotification = false;
     uint32_t m_frequency;
+
+    // tune timing [ns of steady clock], measured from tune request to input device ready, sync and first audio frame
+    // audio is received in dabsdr thread => atomic
+    std::atomic<int64_t> m_tuneStartNs{0};
+    int64_t m_tuneInputNs = 0;
+    bool m_isTuneSyncPending = false;
+    std::atomic<bool> m_isTuneAudioPending{false};
+
     struct {
         uint32_t SId;
         uint8_t SCIdS;
@@ -67,6 +67,7 @@ SetupDialog::SetupDialog(QWidget *parent) : QDialog(parent), ui(new Ui::SetupDia
 
     // this has to be aligned with mainwindow
     ui->loopCheckbox->setChecked(false);
+    ui->freeRunCheckbox->setChecked(false);
 
     ui->statusLabel->setText("<span style=\"color:red\">"+tr("No device connected")+"</span>");
 
@@ -214,6 +215,7 @@ SetupDialog::SetupDialog(QWidget *parent) : QDialog(parent), ui(new Ui::SetupDia
 
 
     connect(ui->loopCheckbox, &QCheckBox::stateChanged, this, [=](int val) { m_settings.rawfile.loopEna = (Qt::Unchecked != val); });
+    connect(ui->freeRunCheckbox, &QCheckBox::stateChanged, this, [=](int val) { m_settings.rawfile.freeRunEna = (Qt::Unchecked != val); });
     connect(ui->fileFormatCombo, &QComboBox::currentIndexChanged, this, &SetupDialog::onRawFileFormatChanged);
 
 #if HAVE_AIRSPY
@@ -266,6 +268,16 @@ SetupDialog::SetupDialog(QWidget *parent) : QDialog(parent), ui(new Ui::SetupDia
     ui->expertCheckBox->setToolTip(tr("User interface in expert mode"));
     ui->dlPlusCheckBox->setToolTip(tr("Show Dynamic Label Plus (DL+) tags like artist, song name, etc."));
     ui->xmlHeaderCheckBox->setToolTip(tr("Include raw file XML header in IQ recording"));
+    ui->rawFileCompressionCheckBox->setToolTip(tr("Record IQ stream to compressed file (*.iqz) that can be played as raw file.\n"
+                                                  "Compression is lossless, file size depends on signal."));
+    ui->rawFilePreTriggerSpinBox->setToolTip(tr("Recent input samples are kept in memory and saved at the beginning of IQ recording.\n"
+                                                "Memory needed is about 4 MB per second for RTL-SDR, at most 1/4 of physical memory is used."));
+    ui->inputFifoChunkSpinBox->setToolTip(tr("Duration of input data chunk.\nThe change will take effect when input device is opened."));
+    ui->inputFifoDepthSpinBox->setToolTip(tr("Input buffer size in chunks. Deeper buffer helps to cope with network jitter.\nThe change will take effect when input device is opened."));
+    ui->inputFifoHugePagesCheckBox->setToolTip(tr("Allocate input buffer in huge pages if supported by the system.\nThe change will take effect when input device is opened."));
+    ui->inputFifoLowLatencyCheckBox->setToolTip(tr("RTL-SDR and RTL-TCP transfer data in short blocks independently of chunk duration.\n"
+                                                   "Tuning is faster at the cost of higher CPU load.\n"
+                                                   "The change will take effect when input device is opened."));
 
     ui->audioRecordingFolderLabel->setElideMode(Qt::ElideLeft);
 
@@ -275,6 +287,19 @@ SetupDialog::SetupDialog(QWidget *parent) : QDialog(parent), ui(new Ui::SetupDia
     connect(ui->expertCheckBox, &QCheckBox::clicked, this, &SetupDialog::onExpertModeChecked);
     connect(ui->dlPlusCheckBox, &QCheckBox::clicked, this, &SetupDialog::onDLPlusChecked);
     connect(ui->xmlHeaderCheckBox, &QCheckBox::clicked, this, &SetupDialog::onXmlHeaderChecked);
+    connect(ui->rawFileCompressionCheckBox, &QCheckBox::clicked, this, [this](bool checked) {
+        m_settings.rawFileCompressionEna = checked;
+        emit rawFileCompressionToggled(checked);
+    });
+    connect(ui->rawFilePreTriggerSpinBox, &QSpinBox::editingFinished, this, [this]() {
+        // buffer is reallocated when value is confirmed, not for every key stroke
+        int val = ui->rawFilePreTriggerSpinBox->value();
+        if (val != m_settings.rawFilePreTriggerSec)
+        {
+            m_settings.rawFilePreTriggerSec = val;
+            emit rawFilePreTriggerChanged(val);
+        }
+    });
     connect(ui->spiAppCheckBox, &QCheckBox::clicked, this, &SetupDialog::onSpiAppChecked);
     connect(ui->internetCheckBox, &QCheckBox::clicked, this, &SetupDialog::onUseInternetChecked);
     connect(ui->radioDNSCheckBox, &QCheckBox::clicked, this, &SetupDialog::onRadioDnsChecked);
@@ -282,6 +307,10 @@ SetupDialog::SetupDialog(QWidget *parent) : QDialog(parent), ui(new Ui::SetupDia
     connect(ui->audioInRecordingRadioButton, &QRadioButton::clicked, this, &SetupDialog::onAudioRecordingChecked);
     connect(ui->audioOutRecordingRadioButton, &QRadioButton::clicked, this, &SetupDialog::onAudioRecordingChecked);
     connect(ui->autoStopRecordingCheckBox, &QCheckBox::toggled, this, [this](bool checked) { m_settings.audioRecAutoStopEna = checked; });
+    connect(ui->inputFifoChunkSpinBox, &QSpinBox::valueChanged, this, [this](int val) { m_settings.inputFifo.chunkMs = val; });
+    connect(ui->inputFifoDepthSpinBox, &QSpinBox::valueChanged, this, [this](int val) { m_settings.inputFifo.numChunks = val; });
+    connect(ui->inputFifoHugePagesCheckBox, &QCheckBox::toggled, this, [this](bool checked) { m_settings.inputFifo.hugePages = checked; });
+    connect(ui->inputFifoLowLatencyCheckBox, &QCheckBox::toggled, this, [this](bool checked) { m_settings.inputFifo.lowLatency = checked; });
 
     ui->dataDumpFolderLabel->setElideMode(Qt::ElideLeft);
     ui->dumpSlsPatternEdit->setToolTip(tr("Storage path template for SLS application. Following tokens are supported:\n"
@@ -296,7 +325,14 @@ SetupDialog::SetupDialog(QWidget *parent) : QDialog(parent), ui(new Ui::SetupDia
     connect(ui->dumpSpiPatternReset, &QPushButton::clicked, this, &SetupDialog::onDataDumpResetClicked);
     connect(ui->dumpSlsPatternEdit, &QLineEdit::editingFinished, this, &SetupDialog::onDataDumpPatternEditingFinished);
     connect(ui->dumpSpiPatternEdit, &QLineEdit::editingFinished, this, &SetupDialog::onDataDumpPatternEditingFinished);
-    connect(ui->rawFileProgressBar, &QProgressBar::valueChanged, this, &SetupDialog::onRawFileProgressChanged);            
+    connect(ui->rawFileSlider, &QSlider::valueChanged, this, &SetupDialog::onRawFileProgressChanged);
+    connect(ui->rawFileSlider, &QSlider::sliderReleased, this, [this]() { emit rawFileSeek(ui->rawFileSlider->value()); });
+    connect(ui->rawFileSlider, &QSlider::actionTriggered, this, [this]() {
+        if (!ui->rawFileSlider->isSliderDown())
+        {   // click on groove, keyboard or mouse wheel - value is not updated yet, dragging seeks on release
+            emit rawFileSeek(ui->rawFileSlider->sliderPosition());
+        }
+    });
     // reset UI
     onFileLength(0);
 
@@ -393,6 +429,8 @@ void SetupDialog::setSettings(const Settings &settings)
     emit newAnnouncementSettings();
     emit noiseConcealmentLevelChanged(m_settings.noiseConcealmentLevel);
     emit xmlHeaderToggled(m_settings.xmlHeaderEna);
+    emit rawFileCompressionToggled(m_settings.rawFileCompressionEna);
+    emit rawFilePreTriggerChanged(m_settings.rawFilePreTriggerSec);
     emit audioRecordingSettings(m_settings.audioRecFolder, m_settings.audioRecCaptureOutput);
     emit uaDumpSettings(m_settings.uaDump);
     onUseInternetChecked(m_settings.useInternet);
@@ -433,18 +471,22 @@ void SetupDialog::setXmlHeader(const InputDeviceDescription &desc)
 
 void SetupDialog::onFileLength(int msec)
 {    
-    ui->rawFileProgressBar->setMinimum(0);
-    ui->rawFileProgressBar->setMaximum(msec);
-    ui->rawFileProgressBar->setValue(0);
+    ui->rawFileSlider->setMinimum(0);
+    ui->rawFileSlider->setMaximum(msec);
+    ui->rawFileSlider->setValue(0);
     onRawFileProgressChanged(0);
 
-    ui->rawFileProgressBar->setVisible(0 != msec);
+    ui->rawFileSlider->setVisible(0 != msec);
     ui->rawFileTime->setVisible(0 != msec);
 }
 
 void SetupDialog::onFileProgress(int msec)
 {
-    ui->rawFileProgressBar->setValue(msec);
+    if (ui->rawFileSlider->isSliderDown())
+    {   // user is dragging the slider
+        return;
+    }
+    ui->rawFileSlider->setValue(msec);
 }
 
 void SetupDialog::setAudioRecAutoStop(bool ena)
@@ -613,6 +655,7 @@ void SetupDialog::setUiState()
         ui->fileNameLabel->setToolTip(m_settings.rawfile.file);
     }
     ui->loopCheckbox->setChecked(m_settings.rawfile.loopEna);
+    ui->freeRunCheckbox->setChecked(m_settings.rawfile.freeRunEna);
     ui->fileFormatCombo->setCurrentIndex(static_cast<int>(m_settings.rawfile.format));
     ui->rtltcpIpAddressEdit->setText(m_settings.rtltcp.tcpAddress);
     ui->rtltcpIpPortSpinBox->setValue(m_settings.rtltcp.tcpPort);
@@ -651,6 +694,12 @@ void SetupDialog::setUiState()
     }
     ui->noiseConcealmentCombo->setCurrentIndex(index);
     ui->xmlHeaderCheckBox->setChecked(m_settings.xmlHeaderEna);
+    ui->rawFileCompressionCheckBox->setChecked(m_settings.rawFileCompressionEna);
+    ui->rawFilePreTriggerSpinBox->setValue(m_settings.rawFilePreTriggerSec);
+    ui->inputFifoChunkSpinBox->setValue(m_settings.inputFifo.chunkMs);
+    ui->inputFifoDepthSpinBox->setValue(m_settings.inputFifo.numChunks);
+    ui->inputFifoHugePagesCheckBox->setChecked(m_settings.inputFifo.hugePages);
+    ui->inputFifoLowLatencyCheckBox->setChecked(m_settings.inputFifo.lowLatency);
     ui->spiAppCheckBox->setChecked(m_settings.spiAppEna);
     ui->internetCheckBox->setChecked(m_settings.useInternet);
     ui->radioDNSCheckBox->setChecked(m_settings.radioDnsEna);
@@ -712,6 +761,7 @@ void SetupDialog::onConnectDeviceClicked()
     case InputDeviceId::RAWFILE:
         m_settings.rawfile.file = m_rawfilename;
         m_settings.rawfile.loopEna = ui->loopCheckbox->isChecked();
+        m_settings.rawfile.freeRunEna = ui->freeRunCheckbox->isChecked();
         m_settings.rawfile.format = static_cast<RawFileInputFormat>(ui->fileFormatCombo->currentIndex());
         break;
     case InputDeviceId::AIRSPY:
@@ -1125,7 +1175,7 @@ void SetupDialog::onOpenFileButtonClicked()
     {
         dir = QFileInfo(m_rawfilename).path();
     }
-    QString fileName = QFileDialog::getOpenFileName(this, tr("Open IQ stream"), dir, tr("Binary files")+" (*.bin *.s16 *.u8 *.raw *.sdr *.uff)");
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open IQ stream"), dir, tr("Binary files")+" (*.bin *.s16 *.u8 *.raw *.sdr *.uff *.iqz)");
     if (!fileName.isEmpty())
     {
         m_rawfilename = fileName;
@@ -1232,6 +1282,7 @@ void SetupDialog::onExpertModeChecked(bool checked)
     ui->airspyExpertGroup->setVisible(checked);
     ui->soapysdrExpertGroup->setVisible(checked);
     ui->dataDumpGroup->setVisible(checked);
+    ui->inputFifoGroupBox->setVisible(checked);
     if (!checked)
     {
         ui->dumpSlsCheckBox->setChecked(false);
@@ -1298,7 +1349,7 @@ void SetupDialog::onXmlHeaderChecked(bool checked)
 
 void SetupDialog::onRawFileProgressChanged(int val)
 {
-    ui->rawFileTime->setText(QString("%1 / %2 "+tr("sec")).arg(val/1000.0, 0, 'f', 1).arg(ui->rawFileProgressBar->maximum()/1000.0, 0, 'f', 1));
+    ui->rawFileTime->setText(QString("%1 / %2 "+tr("sec")).arg(val/1000.0, 0, 'f', 1).arg(ui->rawFileSlider->maximum()/1000.0, 0, 'f', 1));
 }
 
 void SetupDialog::onSpiAppChecked(bool checked)
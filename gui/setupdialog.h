@@ -61,6 +61,7 @@ public:
             QString file;
             RawFileInputFormat format;
             bool loopEna;
+            bool freeRunEna;
         } rawfile;
         struct
         {
@@ -108,6 +109,8 @@ public:
         bool dlPlusEna;
         int noiseConcealmentLevel;
         bool xmlHeaderEna;
+        bool rawFileCompressionEna;
+        int rawFilePreTriggerSec;
         bool spiAppEna;
         bool useInternet;
         bool radioDnsEna;
@@ -115,6 +118,15 @@ public:
         bool audioRecCaptureOutput;
         bool audioRecAutoStopEna;
 
+        // input FIFO parameters, applied when input device is opened
+        struct
+        {
+            int chunkMs;
+            int numChunks;
+            bool hugePages;
+            bool lowLatency;
+        } inputFifo;
+
         // this is settings for UA data dumping (storage)
         struct UADumpSettings
         {
@@ -150,10 +162,13 @@ signals:
     void applicationStyleChanged(ApplicationStyle style);
     void noiseConcealmentLevelChanged(int level);
     void xmlHeaderToggled(bool enabled);
+    void rawFileCompressionToggled(bool enabled);
+    void rawFilePreTriggerChanged(int sec);
     void spiApplicationEnabled(bool enabled);
     void spiApplicationSettingsChanged(bool useInterent, bool enaRadioDNS);
     void audioRecordingSettings(const QString &folder, bool doOutputRecording);
     void uaDumpSettings(const Settings::UADumpSettings & settings);
+    void rawFileSeek(int msec);
 protected:
     void showEvent(QShowEvent *event);
 
@@ -0,0 +1,175 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Input FIFO throughput benchmark
+// lock-free FIFO (mirrored and linear memory) is compared with original FIFO protected by mutex and condition variable
+// producer writes device-sized blocks, consumer reads blocks of OFDM symbol size like dabsdr does
+// usage: inputfifobench [MB to transfer]
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "inputfifo.h"
+
+#define BENCH_WRITE_BYTES     (16384 * 2 * sizeof(float))   // typical device transfer
+#define BENCH_READ_BYTES      (2552 * 2 * sizeof(float))    // OFDM symbol in DAB mode 1
+
+// FIFO used before lock-free FIFO: count is protected by mutex, both sides signal condition variable
+// producer waits for space here (original devices dropped data when FIFO was full)
+class LegacyFifo
+{
+public:
+    explicit LegacyFifo(uint64_t size) : m_buffer(size), m_size(size) {}
+
+    void write(const uint8_t * data, uint64_t bytes)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while ((m_size - m_count) < bytes)
+        {
+            m_condition.wait(lock);
+        }
+        lock.unlock();
+
+        uint64_t bytesTillEnd = m_size - m_head;
+        if (bytesTillEnd >= bytes)
+        {
+            memcpy(m_buffer.data() + m_head, data, bytes);
+            m_head = (m_head + bytes) % m_size;
+        }
+        else
+        {
+            memcpy(m_buffer.data() + m_head, data, bytesTillEnd);
+            memcpy(m_buffer.data(), data + bytesTillEnd, bytes - bytesTillEnd);
+            m_head = bytes - bytesTillEnd;
+        }
+
+        lock.lock();
+        m_count += bytes;
+        m_condition.notify_one();
+    }
+
+    void read(uint8_t * data, uint64_t bytes)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_count < bytes)
+        {
+            m_condition.wait(lock);
+        }
+        lock.unlock();
+
+        uint64_t bytesTillEnd = m_size - m_tail;
+        if (bytesTillEnd >= bytes)
+        {
+            memcpy(data, m_buffer.data() + m_tail, bytes);
+            m_tail = (m_tail + bytes) % m_size;
+        }
+        else
+        {
+            memcpy(data, m_buffer.data() + m_tail, bytesTillEnd);
+            memcpy(data + bytesTillEnd, m_buffer.data(), bytes - bytesTillEnd);
+            m_tail = bytes - bytesTillEnd;
+        }
+
+        lock.lock();
+        m_count -= bytes;
+        m_condition.notify_one();
+    }
+
+private:
+    std::vector<uint8_t> m_buffer;
+    uint64_t m_size;
+    uint64_t m_count = 0;
+    uint64_t m_head = 0;   // producer only
+    uint64_t m_tail = 0;   // consumer only
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+template <typename Producer, typename Consumer>
+static void measure(const char * name, uint64_t totalBytes, Producer producer, Consumer consumer)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::thread producerThread([&]()
+    {
+        for (uint64_t written = 0; written < totalBytes; written += BENCH_WRITE_BYTES)
+        {
+            producer();
+        }
+    });
+    for (uint64_t read = 0; read + BENCH_READ_BYTES <= totalBytes; read += BENCH_READ_BYTES)
+    {
+        consumer();
+    }
+    producerThread.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // one second of input is 2048000 float IQ samples
+    double mbps = (totalBytes / sec) / (1024.0 * 1024.0);
+    fprintf(stdout, "%-24s %8.1f MB/s  %6.1fx real time\n", name, mbps, (totalBytes / sec) / (2048000.0 * 2 * sizeof(float)));
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t totalBytes = uint64_t((argc > 1) ? atoi(argv[1]) : 4096) * 1024 * 1024;
+
+    std::vector<uint8_t> src(BENCH_WRITE_BYTES, 0x55);
+    std::vector<uint8_t> dst(BENCH_READ_BYTES);
+
+    ComplexFifo fifo;
+    for (bool mirrored : { true, false })
+    {
+        fifo.setMirroringEnabled(mirrored);
+        if (!fifo.alloc(INPUT_CHUNK_MS_DEFAULT, INPUT_FIFO_CHUNKS_DEFAULT, false) || (fifo.isMirrored() != mirrored))
+        {
+            fprintf(stdout, "%-24s not available\n", mirrored ? "lock-free mirrored" : "lock-free linear");
+            continue;
+        }
+        measure(mirrored ? "lock-free mirrored" : "lock-free linear", totalBytes,
+                [&]()
+                {
+                    fifo.waitForSpace(BENCH_WRITE_BYTES);
+                    memcpy(fifo.reserve(BENCH_WRITE_BYTES), src.data(), BENCH_WRITE_BYTES);
+                    fifo.commit(BENCH_WRITE_BYTES);
+                },
+                [&]()
+                {
+                    fifo.read(dst.data(), BENCH_READ_BYTES);
+                });
+    }
+
+    // same capacity as lock-free FIFO
+    LegacyFifo legacyFifo(fifo.size());
+    measure("mutex/condvar (original)", totalBytes,
+            [&]() { legacyFifo.write(src.data(), BENCH_WRITE_BYTES); },
+            [&]() { legacyFifo.read(dst.data(), BENCH_READ_BYTES); });
+
+    return 0;
+}
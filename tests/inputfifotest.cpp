@@ -0,0 +1,230 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Input FIFO stress test
+// producer and consumer threads exchange counter pattern through reserve()/commit() and readPtr()/consume()
+// while epochs are started by producer and FIFO is reset by another thread
+// usage: inputfifotest [mirrored|linear]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include "inputfifo.h"
+
+#define TEST_BYTES            (uint64_t(256) * 1024 * 1024)
+#define TEST_MAX_WRITE        (uint64_t(256) * 1024)
+#define TEST_MAX_READ         (uint64_t(65535) * 8)
+
+// one element has size of float IQ sample, counter is position of element in stream
+struct TestSample
+{
+    uint32_t tag;
+    uint32_t counter;
+};
+
+enum class TestMode
+{
+    Stream,         // no discontinuity is allowed
+    Epochs,         // producer starts epochs, consumer waits for expected epoch
+    EpochsReset,    // as Epochs and FIFO is reset concurrently by another thread
+};
+
+static int numErrors = 0;
+
+static void fail(const char * phase, const char * msg, uint64_t a, uint64_t b)
+{
+    if (numErrors++ < 10)
+    {
+        fprintf(stderr, "[%s] %s (%llu, %llu)\n", phase, msg, static_cast<unsigned long long>(a), static_cast<unsigned long long>(b));
+    }
+}
+
+static void runPhase(ComplexFifo & fifo, TestMode mode, const char * phase)
+{
+    std::atomic<bool> finished{false};
+    std::atomic<uint32_t> expectedTag{0};
+    std::atomic<uint64_t> numResets{0};
+
+    // contiguous block cannot be longer than maxSpan()
+    const uint64_t maxWrite = (fifo.maxSpan() < TEST_MAX_WRITE) ? fifo.maxSpan() : TEST_MAX_WRITE;
+    const uint64_t maxRead = (fifo.maxSpan() < TEST_MAX_READ) ? fifo.maxSpan() : TEST_MAX_READ;
+
+    // stream starts at current head, FIFO is emptied first
+    fifo.reset();
+    const uint64_t startPos = fifo.epochStart();
+
+    std::thread producer([&]()
+    {
+        std::mt19937 rng(1);
+        uint64_t pos = startPos;
+        uint32_t tag = 0;
+        uint64_t blockCntr = 0;
+        while (!finished.load(std::memory_order_acquire))
+        {
+            if ((TestMode::Stream != mode) && (0 == (++blockCntr % 16)))
+            {   // consumer expects new tag before producer starts the epoch (like RadioControl and input device)
+                expectedTag.store(++tag, std::memory_order_release);
+                fifo.startEpoch(tag);
+            }
+
+            uint64_t bytes = (1 + rng() % (maxWrite / sizeof(TestSample))) * sizeof(TestSample);
+            if (!fifo.waitForSpace(bytes))
+            {   // FIFO was reset while it is full
+                continue;
+            }
+            TestSample * ptr = reinterpret_cast<TestSample *>(fifo.reserve(bytes));
+            if (nullptr == ptr)
+            {
+                fail(phase, "Space not available after waitForSpace()", bytes, fifo.count());
+                continue;
+            }
+            for (uint64_t n = 0; n < bytes / sizeof(TestSample); ++n)
+            {
+                ptr[n].tag = tag;
+                ptr[n].counter = static_cast<uint32_t>((pos - startPos) / sizeof(TestSample) + n);
+            }
+            fifo.commit(bytes);
+            pos += bytes;
+        }
+    });
+
+    std::thread resetter([&]()
+    {
+        std::mt19937 rng(2);
+        while ((TestMode::EpochsReset == mode) && !finished.load(std::memory_order_acquire))
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(rng() % 2000));
+            fifo.reset();
+            numResets.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    std::mt19937 rng(3);
+    uint64_t readBytes = 0;
+    uint64_t nextPos = startPos;
+    uint32_t lastTag = 0;
+    uint64_t numGaps = 0;
+    while (readBytes < TEST_BYTES)
+    {
+        if (0 == (rng() % 16))
+        {   // consumer is slower for a while => FIFO gets full and producer waits for space
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        uint32_t tag = expectedTag.load(std::memory_order_acquire);
+        fifo.waitForEpoch(tag);
+
+        // data are verified in place => producer must not overwrite them before consume()
+
+        uint64_t bytes = (1 + rng() % (maxRead / sizeof(TestSample))) * sizeof(TestSample);
+        const TestSample * ptr = reinterpret_cast<const TestSample *>(fifo.readPtr(bytes));
+        uint64_t pos = fifo.readPosition();
+        if (pos < nextPos)
+        {
+            fail(phase, "Data read twice", pos, nextPos);
+        }
+        else if (pos > nextPos)
+        {
+            numGaps += 1;
+            if (TestMode::Stream == mode)
+            {
+                fail(phase, "Data lost", pos, nextPos);
+            }
+            else if ((TestMode::Epochs == mode) && (ptr[0].tag <= lastTag))
+            {   // data can be discarded only when new epoch starts
+                fail(phase, "Data lost within epoch", pos, nextPos);
+            }
+        }
+        if ((TestMode::Epochs == mode) && (ptr[0].tag < tag))
+        {
+            fail(phase, "Data of previous epoch", ptr[0].tag, tag);
+        }
+        for (uint64_t n = 0; n < bytes / sizeof(TestSample); ++n)
+        {
+            uint32_t counter = static_cast<uint32_t>((pos - startPos) / sizeof(TestSample) + n);
+            if (ptr[n].counter != counter)
+            {
+                fail(phase, "Wrong counter", ptr[n].counter, counter);
+                break;
+            }
+            if (ptr[n].tag < lastTag)
+            {
+                fail(phase, "Tag goes back", ptr[n].tag, lastTag);
+                break;
+            }
+            lastTag = ptr[n].tag;
+        }
+        fifo.consume(bytes);
+        nextPos = pos + bytes;
+        readBytes += bytes;
+    }
+
+    // reset unblocks producer waiting for space
+    finished.store(true, std::memory_order_release);
+    fifo.reset();
+    producer.join();
+    resetter.join();
+
+    fprintf(stdout, "[%s] %llu MB verified, %u epochs, %llu resets, %llu discontinuities\n", phase,
+            static_cast<unsigned long long>(readBytes >> 20), lastTag,
+            static_cast<unsigned long long>(numResets.load()), static_cast<unsigned long long>(numGaps));
+}
+
+int main(int argc, char *argv[])
+{
+    bool mirrored = !((argc > 1) && (0 == strcmp(argv[1], "linear")));
+
+    // smallest FIFO so that it is often full and wraps around frequently
+    ComplexFifo fifo;
+    fifo.setMirroringEnabled(mirrored);
+    if (!fifo.alloc(INPUT_CHUNK_MS_MIN, INPUT_FIFO_CHUNKS_MIN, false))
+    {
+        fprintf(stderr, "FIFO allocation failed\n");
+        return 1;
+    }
+    if (fifo.isMirrored() != mirrored)
+    {   // mirrored mapping is not supported on this platform
+        fprintf(stdout, "Mirrored mapping not available, test skipped\n");
+        return 0;
+    }
+    fprintf(stdout, "FIFO %s: size %llu bytes, max span %llu bytes\n", mirrored ? "mirrored" : "linear",
+            static_cast<unsigned long long>(fifo.size()), static_cast<unsigned long long>(fifo.maxSpan()));
+
+    runPhase(fifo, TestMode::Stream, "stream");
+    runPhase(fifo, TestMode::Epochs, "epochs");
+    runPhase(fifo, TestMode::EpochsReset, "epochs+reset");
+
+    if (numErrors > 0)
+    {
+        fprintf(stderr, "FAILED: %d errors\n", numErrors);
+        return 1;
+    }
+    fprintf(stdout, "PASSED\n");
+    return 0;
+}
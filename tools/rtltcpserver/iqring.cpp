@@ -0,0 +1,103 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstring>
+#include <chrono>
+#include "iqring.h"
+
+IQRing::IQRing(uint64_t size)
+{
+    m_buffer.resize(size);
+    m_writePos = 0;
+    m_isFinished = false;
+}
+
+uint8_t *IQRing::writeSpan(uint32_t &len)
+{
+    uint64_t idx = m_writePos.load(std::memory_order_relaxed) % size();
+    if (idx + len > size())
+    {   // limited by end of ring
+        len = size() - idx;
+    }
+    return &m_buffer[idx];
+}
+
+void IQRing::commit(uint32_t len)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_writePos.fetch_add(len, std::memory_order_release);
+    }
+    m_condition.notify_all();
+}
+
+void IQRing::write(const uint8_t *data, uint32_t len)
+{
+    while (len > 0)
+    {
+        uint32_t n = len;
+        uint8_t * ptr = writeSpan(n);
+        std::memcpy(ptr, data, n);
+        commit(n);
+        data += n;
+        len -= n;
+    }
+}
+
+void IQRing::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isFinished = true;
+    }
+    m_condition.notify_all();
+}
+
+bool IQRing::waitForData(uint64_t readPos, int timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_condition.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                                [this, readPos]() { return (writePos() > readPos) || m_isFinished; }) && (writePos() > readPos);
+}
+
+int IQRing::dataSpans(uint64_t readPos, uint64_t endPos, struct iovec iov[2]) const
+{
+    uint64_t idx = readPos % size();
+    uint64_t len = endPos - readPos;
+    if (idx + len <= size())
+    {   // contiguous
+        iov[0].iov_base = (void *) &m_buffer[idx];
+        iov[0].iov_len = len;
+        return 1;
+    }
+
+    // data wrap around end of ring
+    iov[0].iov_base = (void *) &m_buffer[idx];
+    iov[0].iov_len = size() - idx;
+    iov[1].iov_base = (void *) &m_buffer[0];
+    iov[1].iov_len = len - iov[0].iov_len;
+    return 2;
+}
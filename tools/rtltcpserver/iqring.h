@@ -0,0 +1,71 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IQRING_H
+#define IQRING_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <sys/uio.h>
+
+// Ring buffer shared by all clients of the server
+// single producer (IQ source) writes, each client reads from its own position
+// producer never waits for clients, client that falls behind by more than half of the ring skips data
+// positions are free running byte counters, position in buffer is counter % size()
+class IQRing
+{
+public:
+    explicit IQRing(uint64_t size);
+
+    uint64_t size() const { return m_buffer.size(); }
+    uint64_t writePos() const { return m_writePos.load(std::memory_order_acquire); }
+
+    // producer API
+    // contiguous free space at write position, len is limited by end of ring
+    uint8_t * writeSpan(uint32_t & len);
+    void commit(uint32_t len);
+    void write(const uint8_t * data, uint32_t len);
+    void finish();
+    bool isFinished() const { return m_isFinished; }
+
+    // consumer API
+    // waits until there are data behind readPos or timeout [ms] elapsed, returns true if data are available
+    bool waitForData(uint64_t readPos, int timeoutMs);
+
+    // fills iov with data between readPos and endPos (no copy), returns number of iovec entries used
+    int dataSpans(uint64_t readPos, uint64_t endPos, struct iovec iov[2]) const;
+private:
+    std::vector<uint8_t> m_buffer;
+    std::atomic<uint64_t> m_writePos;
+    std::atomic<bool> m_isFinished;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+#endif // IQRING_H
@@ -0,0 +1,360 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <thread>
+#include <QDomDocument>
+#include <QtEndian>
+#include <QLoggingCategory>
+#include "iqsource.h"
+
+Q_LOGGING_CATEGORY(iqSource, "IQSource", QtInfoMsg)
+
+#define IQSOURCE_COMPRESSED_MAGIC (0x315A5149)    // "IQZ1", lossless compressed recording (RawFileCodec)
+
+IQSource::IQSource(IQRing *ring, QObject *parent) : QThread(parent)
+{
+    m_ring = ring;
+    m_stopRequest = false;
+}
+
+void IQSource::stop()
+{
+    m_stopRequest = true;
+}
+
+FileIQSource::FileIQSource(IQRing *ring, const QString &fileName, uint32_t sampleRate, bool loop, QObject *parent) : IQSource(ring, parent)
+{
+    m_fileName = fileName;
+    m_sampleRate = sampleRate;
+    m_loop = loop;
+}
+
+FileIQSource::~FileIQSource()
+{
+    stop();
+    wait();
+    delete m_file;
+}
+
+bool FileIQSource::open()
+{
+    m_file = new QFile(m_fileName);
+    if (!m_file->open(QIODevice::ReadOnly))
+    {
+        qCCritical(iqSource) << "Unable to open file:" << m_fileName;
+        return false;
+    }
+
+    QByteArray magic = m_file->peek(sizeof(uint32_t));
+    if ((magic.size() == sizeof(uint32_t)) && (IQSOURCE_COMPRESSED_MAGIC == qFromLittleEndian<uint32_t>(magic.constData())))
+    {
+        qCCritical(iqSource) << "Compressed recordings are not supported:" << m_fileName;
+        return false;
+    }
+
+    // check XML header, the same way as RawFileInput
+    QByteArray xml;
+    int idx = 0;
+    char ch;
+    while ((idx < IQSOURCE_FILE_XML_PADDING) && m_file->getChar(&ch) && (0 != ch))
+    {   // zero indicates header padding bytes
+        xml.append(ch);
+        idx++;
+    }
+
+    uint32_t headerSampleRate = IQSOURCE_SAMPLE_RATE_DEFAULT;
+    QDomDocument xmlHeader;
+    if ((idx < IQSOURCE_FILE_XML_PADDING) && xmlHeader.setContent(xml))
+    {
+        QDomElement sampleElement = xmlHeader.documentElement().firstChildElement("Sample");
+        QDomElement rateElement = sampleElement.firstChildElement("Samplerate");
+        if (!rateElement.isNull())
+        {
+            bool isOK = false;
+            uint32_t rate = rateElement.attribute("Value", "2048000").toUInt(&isOK);
+            if (isOK)
+            {
+                headerSampleRate = ("hz" == rateElement.attribute("Unit", "Hz").toLower()) ? rate : 1000 * rate;
+            }
+            else
+            {
+                qCWarning(iqSource) << "Error in reading XML header: Samplerate";
+            }
+        }
+        QDomElement channelsElement = sampleElement.firstChildElement("Channels");
+        if (!channelsElement.isNull())
+        {
+            m_channelBits = channelsElement.attribute("Bits", "8").toInt();
+            QString container = channelsElement.attribute("Container", "uint8").toLower();
+            if ("int16" == container)
+            {
+                m_containerBits = 16;
+            }
+            else if ("uint8" != container)
+            {
+                qCCritical(iqSource) << QString("Channel container '%1' not supported").arg(container);
+                return false;
+            }
+        }
+        m_dataOffset = IQSOURCE_FILE_XML_PADDING;
+    }
+    else
+    {   // no header, raw uint8 samples
+        m_dataOffset = 0;
+    }
+
+    if (!m_file->seek(m_dataOffset))
+    {
+        qCCritical(iqSource) << "Unable to seek in file:" << m_fileName;
+        return false;
+    }
+
+    if (0 == m_sampleRate)
+    {   // rate from header or default
+        m_sampleRate = headerSampleRate;
+    }
+
+    qCInfo(iqSource, "File %s: %d bit samples, streamed at %u Hz%s", m_fileName.toLocal8Bit().constData(), m_containerBits,
+           m_sampleRate, m_loop ? " in loop" : "");
+
+    return true;
+}
+
+void FileIQSource::command(RtlTcpCommand cmd, uint32_t param)
+{   // file cannot be tuned
+    qCDebug(iqSource, "Command 0x%02X (%u) ignored", static_cast<int>(cmd), param);
+}
+
+void FileIQSource::run()
+{
+    const qint64 blockIQ = qMax(qint64(1), qint64(m_sampleRate) * IQSOURCE_FILE_PERIOD_MS / 1000);
+    auto nextTime = std::chrono::steady_clock::now();
+    bool rewound = false;
+    while (!m_stopRequest)
+    {
+        qint64 numIQ = blockIQ;
+        while (numIQ > 0)
+        {
+            uint32_t len = numIQ * 2;
+            uint8_t * dest = m_ring->writeSpan(len);
+            qint64 read = readBlock(dest, len / 2);
+            if (read <= 0)
+            {   // end of file
+                if (!m_loop || rewound || !m_file->seek(m_dataOffset))
+                {
+                    qCInfo(iqSource) << "End of file";
+                    goto source_exit;
+                }
+                qCDebug(iqSource) << "Restarting file";
+                rewound = true;
+                continue;
+            }
+            rewound = false;
+            m_ring->commit(read * 2);
+            numIQ -= read;
+        }
+
+        // real time pacing
+        nextTime += std::chrono::milliseconds(IQSOURCE_FILE_PERIOD_MS);
+        std::this_thread::sleep_until(nextTime);
+    }
+
+source_exit:
+    m_ring->finish();
+}
+
+qint64 FileIQSource::readBlock(uint8_t *dest, qint64 numIQ)
+{
+    if (8 == m_containerBits)
+    {   // samples are sent as they are
+        qint64 bytes = m_file->read((char *) dest, numIQ * 2);
+        return (bytes > 0) ? (bytes / 2) : bytes;
+    }
+
+    // int16 => uint8 with offset 128
+    m_buffer.resize(numIQ * 2 * sizeof(int16_t));
+    qint64 bytes = m_file->read((char *) m_buffer.data(), m_buffer.size());
+    if (bytes <= 0)
+    {
+        return bytes;
+    }
+    qint64 numRead = bytes / (2 * sizeof(int16_t));
+    const int16_t * src = (const int16_t *) m_buffer.data();
+    const int shift = qBound(0, m_channelBits - 8, 8);
+    for (qint64 n = 0; n < 2 * numRead; ++n)
+    {
+        dest[n] = static_cast<uint8_t>(qBound(0, (src[n] >> shift) + 128, 255));
+    }
+    return numRead;
+}
+
+RtlSdrIQSource::RtlSdrIQSource(IQRing *ring, uint32_t deviceIndex, uint32_t sampleRate, uint32_t frequency, QObject *parent) : IQSource(ring, parent)
+{
+    m_deviceIndex = deviceIndex;
+    m_sampleRate = (0 == sampleRate) ? IQSOURCE_SAMPLE_RATE_DEFAULT : sampleRate;
+    m_frequency = frequency;
+}
+
+RtlSdrIQSource::~RtlSdrIQSource()
+{
+    if (nullptr != m_device)
+    {
+        stop();
+        wait();
+        rtlsdr_close(m_device);
+    }
+}
+
+bool RtlSdrIQSource::open()
+{
+    if (rtlsdr_open(&m_device, m_deviceIndex) < 0)
+    {
+        qCCritical(iqSource) << "Failed to open RTL-SDR device" << m_deviceIndex;
+        m_device = nullptr;
+        return false;
+    }
+    qCInfo(iqSource) << "Opened RTL-SDR device:" << rtlsdr_get_device_name(m_deviceIndex);
+
+    if (rtlsdr_set_sample_rate(m_device, m_sampleRate) < 0)
+    {
+        qCCritical(iqSource) << "Failed to set sample rate" << m_sampleRate;
+        return false;
+    }
+    if ((0 != m_frequency) && (rtlsdr_set_center_freq(m_device, m_frequency) < 0))
+    {
+        qCWarning(iqSource) << "Failed to set frequency" << m_frequency;
+    }
+
+    // automatic gain until client sets gain
+    rtlsdr_set_tuner_gain_mode(m_device, 0);
+
+    int numGains = rtlsdr_get_tuner_gains(m_device, nullptr);
+    if (numGains > 0)
+    {
+        m_gains.resize(numGains);
+        rtlsdr_get_tuner_gains(m_device, m_gains.data());
+    }
+
+    rtlsdr_reset_buffer(m_device);
+
+    return true;
+}
+
+void RtlSdrIQSource::stop()
+{
+    IQSource::stop();
+    if (nullptr != m_device)
+    {
+        rtlsdr_cancel_async(m_device);
+    }
+}
+
+uint32_t RtlSdrIQSource::tunerType() const
+{
+    return rtlsdr_get_tuner_type(m_device);
+}
+
+uint32_t RtlSdrIQSource::tunerGainCount() const
+{
+    return m_gains.size();
+}
+
+void RtlSdrIQSource::run()
+{
+    if (!m_stopRequest)
+    {   // blocks until rtlsdr_cancel_async() is called
+        rtlsdr_read_async(m_device, readCallback, (void *) this, IQSOURCE_RTLSDR_NUM_BUFFERS, IQSOURCE_RTLSDR_BUFFER_LEN);
+    }
+    m_ring->finish();
+}
+
+void RtlSdrIQSource::readCallback(unsigned char *buf, uint32_t len, void *ctx)
+{   // samples are copied once to shared ring, clients send them from there
+    static_cast<RtlSdrIQSource *>(ctx)->m_ring->write(buf, len & ~1u);
+}
+
+void RtlSdrIQSource::command(RtlTcpCommand cmd, uint32_t param)
+{
+    int ret = 0;
+    switch (cmd)
+    {
+    case RtlTcpCommand::SET_FREQ:
+        ret = rtlsdr_set_center_freq(m_device, param);
+        qCInfo(iqSource) << "Frequency" << param << "Hz";
+        break;
+    case RtlTcpCommand::SET_SAMPLE_RATE:
+        ret = rtlsdr_set_sample_rate(m_device, param);
+        qCInfo(iqSource) << "Sample rate" << param << "Hz";
+        break;
+    case RtlTcpCommand::SET_GAIN_MODE:
+        ret = rtlsdr_set_tuner_gain_mode(m_device, param);
+        break;
+    case RtlTcpCommand::SET_GAIN:
+        ret = rtlsdr_set_tuner_gain(m_device, param);
+        break;
+    case RtlTcpCommand::SET_FREQ_CORR:
+        ret = rtlsdr_set_freq_correction(m_device, static_cast<int>(param));
+        break;
+    case RtlTcpCommand::SET_IF_GAIN:
+        ret = rtlsdr_set_tuner_if_gain(m_device, param >> 16, static_cast<int16_t>(param & 0xFFFF));
+        break;
+    case RtlTcpCommand::SET_TEST_MODE:
+        ret = rtlsdr_set_testmode(m_device, param);
+        break;
+    case RtlTcpCommand::SET_AGC_MODE:
+        ret = rtlsdr_set_agc_mode(m_device, param);
+        break;
+    case RtlTcpCommand::SET_DIRECT_SAMPLING:
+        ret = rtlsdr_set_direct_sampling(m_device, param);
+        break;
+    case RtlTcpCommand::SET_OFFSET_TUNING:
+        ret = rtlsdr_set_offset_tuning(m_device, param);
+        break;
+    case RtlTcpCommand::SET_RTL_XTAL_FREQ:
+        ret = rtlsdr_set_xtal_freq(m_device, param, 0);
+        break;
+    case RtlTcpCommand::SET_TUNER_XTAL_FREQ:
+        ret = rtlsdr_set_xtal_freq(m_device, 0, param);
+        break;
+    case RtlTcpCommand::SET_GAIN_IDX:
+        if (param < m_gains.size())
+        {
+            ret = rtlsdr_set_tuner_gain(m_device, m_gains[param]);
+        }
+        break;
+    case RtlTcpCommand::SET_BIAS_TEE:
+        ret = rtlsdr_set_bias_tee(m_device, param);
+        break;
+    default:
+        qCDebug(iqSource, "Unknown command 0x%02X", static_cast<int>(cmd));
+        break;
+    }
+    if (0 != ret)
+    {
+        qCWarning(iqSource, "Command 0x%02X (%u) failed", static_cast<int>(cmd), param);
+    }
+}
@@ -0,0 +1,135 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IQSOURCE_H
+#define IQSOURCE_H
+
+#include <QThread>
+#include <QFile>
+#include <QString>
+#include <atomic>
+#include <vector>
+#include <rtl-sdr.h>
+#include "iqring.h"
+
+#define IQSOURCE_SAMPLE_RATE_DEFAULT (2048000)
+#define IQSOURCE_FILE_XML_PADDING    (2048)      // the same as RawFileInput
+#define IQSOURCE_FILE_PERIOD_MS      (10)        // file is streamed in blocks of this duration
+#define IQSOURCE_RTLSDR_NUM_BUFFERS  (15)        // librtlsdr async buffers
+#define IQSOURCE_RTLSDR_BUFFER_LEN   (16*16384)  // librtlsdr async buffer length [bytes]
+
+// rtl_tcp commands, the same as used by RtlTcpInput
+enum class RtlTcpCommand
+{
+    SET_FREQ             = 0x01,
+    SET_SAMPLE_RATE      = 0x02,
+    SET_GAIN_MODE        = 0x03,
+    SET_GAIN             = 0x04,
+    SET_FREQ_CORR        = 0x05,
+    SET_IF_GAIN          = 0x06,
+    SET_TEST_MODE        = 0x07,
+    SET_AGC_MODE         = 0x08,
+    SET_DIRECT_SAMPLING  = 0x09,
+    SET_OFFSET_TUNING    = 0x0A,
+    SET_RTL_XTAL_FREQ    = 0x0B,
+    SET_TUNER_XTAL_FREQ  = 0x0C,
+    SET_GAIN_IDX         = 0x0D,
+    SET_BIAS_TEE         = 0x0E
+};
+
+// Source of uint8 IQ samples written to ring buffer, source runs in its own thread
+class IQSource : public QThread
+{
+    Q_OBJECT
+public:
+    explicit IQSource(IQRing * ring, QObject *parent = nullptr);
+    virtual bool open() = 0;
+    virtual void stop();
+
+    // dongle info sent to clients
+    virtual uint32_t tunerType() const = 0;
+    virtual uint32_t tunerGainCount() const = 0;
+
+    // rtl_tcp command received from controlling client
+    virtual void command(RtlTcpCommand cmd, uint32_t param) = 0;
+protected:
+    IQRing * m_ring;
+    std::atomic<bool> m_stopRequest;
+};
+
+// Raw IQ file (RawFileInput format with optional XML header) streamed in real time
+// int16 files are converted to uint8 as rtl_tcp protocol supports uint8 samples only
+class FileIQSource : public IQSource
+{
+    Q_OBJECT
+public:
+    explicit FileIQSource(IQRing * ring, const QString & fileName, uint32_t sampleRate, bool loop, QObject *parent = nullptr);
+    ~FileIQSource();
+    bool open() override;
+    uint32_t tunerType() const override { return RTLSDR_TUNER_R820T; }
+    uint32_t tunerGainCount() const override { return 29; }
+    void command(RtlTcpCommand cmd, uint32_t param) override;
+protected:
+    void run() override;
+private:
+    QFile * m_file = nullptr;
+    QString m_fileName;
+    uint32_t m_sampleRate;              // 0 means value from XML header (or default)
+    bool m_loop;
+    qint64 m_dataOffset = 0;
+    int m_containerBits = 8;
+    int m_channelBits = 8;
+    std::vector<uint8_t> m_buffer;      // used for int16 files only
+
+    void parseXmlHeader(const QByteArray & xml);
+    qint64 readBlock(uint8_t * dest, qint64 numIQ);
+};
+
+// Locally attached RTL-SDR device
+class RtlSdrIQSource : public IQSource
+{
+    Q_OBJECT
+public:
+    explicit RtlSdrIQSource(IQRing * ring, uint32_t deviceIndex, uint32_t sampleRate, uint32_t frequency, QObject *parent = nullptr);
+    ~RtlSdrIQSource();
+    bool open() override;
+    void stop() override;
+    uint32_t tunerType() const override;
+    uint32_t tunerGainCount() const override;
+    void command(RtlTcpCommand cmd, uint32_t param) override;
+protected:
+    void run() override;
+private:
+    rtlsdr_dev_t * m_device = nullptr;
+    uint32_t m_deviceIndex;
+    uint32_t m_sampleRate;
+    uint32_t m_frequency;
+    std::vector<int> m_gains;
+
+    static void readCallback(unsigned char *buf, uint32_t len, void *ctx);
+};
+
+#endif // IQSOURCE_H
@@ -0,0 +1,113 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <csignal>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include "iqring.h"
+#include "iqsource.h"
+#include "rtltcpserver.h"
+
+static void signalHandler(int)
+{
+    QCoreApplication::quit();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication::setApplicationName("rtltcpserver");
+
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QObject::tr("rtl_tcp compatible IQ server: streams raw IQ file or local RTL-SDR device to several clients"));
+    parser.addHelpOption();
+
+    QCommandLineOption fileOption(QStringList() << "f" << "file",
+                                  QObject::tr("Raw IQ file (optionally with XML header) to stream. Local RTL-SDR device is used if not specified."), "file");
+    parser.addOption(fileOption);
+    QCommandLineOption loopOption(QStringList() << "l" << "loop",
+                                  QObject::tr("Restart file from beginning when end is reached."));
+    parser.addOption(loopOption);
+    QCommandLineOption deviceOption(QStringList() << "d" << "device",
+                                    QObject::tr("RTL-SDR device index."), "index", "0");
+    parser.addOption(deviceOption);
+    QCommandLineOption frequencyOption(QStringList() << "F" << "frequency",
+                                       QObject::tr("Initial RTL-SDR frequency [Hz], clients usually tune by command."), "Hz", "0");
+    parser.addOption(frequencyOption);
+    QCommandLineOption sampleRateOption(QStringList() << "s" << "samplerate",
+                                        QObject::tr("Sample rate [Hz]. File is streamed at this rate (value from XML header is used if not specified)."), "Hz", "0");
+    parser.addOption(sampleRateOption);
+    QCommandLineOption addressOption(QStringList() << "a" << "address",
+                                     QObject::tr("Listen address."), "address", "127.0.0.1");
+    parser.addOption(addressOption);
+    QCommandLineOption portOption(QStringList() << "p" << "port",
+                                  QObject::tr("Listen port."), "port", "1234");
+    parser.addOption(portOption);
+    QCommandLineOption clientsOption(QStringList() << "n" << "clients",
+                                     QObject::tr("Maximum number of clients."), "number", QString::number(RTLTCPSERVER_MAX_CLIENTS));
+    parser.addOption(clientsOption);
+
+    parser.process(a);
+
+    // client disconnection is handled using writev() return value
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+
+    IQRing ring(RTLTCPSERVER_RING_SIZE);
+    IQSource * source;
+    if (parser.isSet(fileOption))
+    {
+        source = new FileIQSource(&ring, parser.value(fileOption), parser.value(sampleRateOption).toUInt(), parser.isSet(loopOption));
+    }
+    else
+    {
+        source = new RtlSdrIQSource(&ring, parser.value(deviceOption).toUInt(), parser.value(sampleRateOption).toUInt(), parser.value(frequencyOption).toUInt());
+    }
+
+    int ret = 1;
+    if (source->open())
+    {
+        RtlTcpServer server(source, &ring, parser.value(clientsOption).toInt());
+        if (server.listen(parser.value(addressOption), parser.value(portOption).toInt()))
+        {
+            QObject::connect(source, &QThread::finished, &a, &QCoreApplication::quit);
+            server.start();
+            source->start(QThread::HighPriority);
+
+            ret = a.exec();
+
+            source->stop();
+            source->wait();
+        }
+        server.stop();
+        server.wait();
+    }
+    delete source;
+
+    return ret;
+}
@@ -0,0 +1,384 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QtEndian>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include "rtltcpserver.h"
+
+Q_LOGGING_CATEGORY(rtlTcpServer, "RtlTcpServer", QtInfoMsg)
+
+RtlTcpServerClient::RtlTcpServerClient(int sock, const QString &peer, RtlTcpServer *server, IQRing *ring, QObject *parent) : QThread(parent)
+{
+    m_sock = sock;
+    m_peer = peer;
+    m_server = server;
+    m_ring = ring;
+    m_stopRequest = false;
+    m_readPos = 0;
+    m_bytesSent = 0;
+    m_bytesDropped = 0;
+}
+
+RtlTcpServerClient::~RtlTcpServerClient()
+{
+    stop();
+    wait();
+    if (m_sock >= 0)
+    {
+        ::close(m_sock);
+    }
+}
+
+void RtlTcpServerClient::stop()
+{
+    m_stopRequest = true;
+}
+
+void RtlTcpServerClient::run()
+{
+    if (!sendDongleInfo())
+    {
+        qCWarning(rtlTcpServer) << m_peer << "failed to send dongle info";
+        return;
+    }
+
+    // socket is non-blocking from now on, writev() sends only what fits to socket buffer
+    int flags = fcntl(m_sock, F_GETFL, 0);
+    if ((flags < 0) || (fcntl(m_sock, F_SETFL, flags | O_NONBLOCK) < 0))
+    {
+        qCWarning(rtlTcpServer, "Error fcntl(..., F_SETFL) (%s)", strerror(errno));
+        return;
+    }
+
+    // client starts with the most recent samples
+    m_readPos = m_ring->writePos();
+
+    while (!m_stopRequest)
+    {
+        uint64_t writePos = m_ring->writePos();
+        if (writePos - m_readPos > m_ring->size() / 2)
+        {   // client is too slow, data would be overwritten while sending
+            // skip to most recent samples, IQ alignment is kept
+            uint64_t drop = (writePos - m_readPos) & ~uint64_t(1);
+            m_readPos += drop;
+            m_bytesDropped += drop;
+            qCWarning(rtlTcpServer, "%s: client too slow, %llu bytes dropped", m_peer.toLatin1().constData(), (unsigned long long) drop);
+        }
+
+        if (writePos == m_readPos)
+        {   // nothing to send
+            if (m_ring->isFinished())
+            {   // source finished
+                break;
+            }
+            m_ring->waitForData(m_readPos, 100);
+            if (!readCommands())
+            {
+                break;
+            }
+            continue;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = m_sock;
+        pfd.events = POLLIN | POLLOUT;
+        pfd.revents = 0;
+        int ret = ::poll(&pfd, 1, 100);
+        if (ret < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            qCWarning(rtlTcpServer, "%s: poll error (%s)", m_peer.toLatin1().constData(), strerror(errno));
+            break;
+        }
+        if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))
+        {   // disconnected
+            break;
+        }
+        if ((pfd.revents & POLLIN) && !readCommands())
+        {
+            break;
+        }
+        if (pfd.revents & POLLOUT)
+        {   // zero copy send from shared ring
+            struct iovec iov[2];
+            int iovcnt = m_ring->dataSpans(m_readPos, qMin(writePos, m_readPos + RTLTCPSERVER_MAX_SEND), iov);
+            ssize_t sent = ::writev(m_sock, iov, iovcnt);
+            if (sent < 0)
+            {
+                if ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno))
+                {
+                    continue;
+                }
+                qCInfo(rtlTcpServer, "%s: send error (%s)", m_peer.toLatin1().constData(), strerror(errno));
+                break;
+            }
+
+            // source keeps writing during writev() => sent data could be overwritten meanwhile
+            // data are intact only if source cannot reach them yet, including the block it is just writing
+            uint64_t validPos = m_ring->writePos() + RTLTCPSERVER_WRITE_MARGIN;
+            if (validPos > m_readPos + m_ring->size())
+            {   // overwritten bytes were sent instead of original samples => they are counted as dropped
+                uint64_t overwritten = qMin(uint64_t(sent), validPos - m_ring->size() - m_readPos);
+                m_bytesDropped += overwritten;
+                qCWarning(rtlTcpServer, "%s: client too slow, %llu bytes overwritten while sending", m_peer.toLatin1().constData(),
+                          (unsigned long long) overwritten);
+            }
+            m_readPos += sent;
+            m_bytesSent += sent;
+        }
+    }
+
+    ::close(m_sock);
+    m_sock = -1;
+}
+
+bool RtlTcpServerClient::sendDongleInfo()
+{
+    struct
+    {
+        char magic[4];
+        uint32_t tunerType;
+        uint32_t tunerGainCount;
+    } dongleInfo;
+
+    std::memcpy(dongleInfo.magic, "RTL0", 4);
+    dongleInfo.tunerType = qToBigEndian<uint32_t>(m_server->tunerType());
+    dongleInfo.tunerGainCount = qToBigEndian<uint32_t>(m_server->tunerGainCount());
+
+    const char * data = (const char *) &dongleInfo;
+    size_t toSend = sizeof(dongleInfo);
+    while (toSend > 0)
+    {
+        ssize_t ret = ::send(m_sock, data, toSend, 0);
+        if (ret < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += ret;
+        toSend -= ret;
+    }
+    return true;
+}
+
+bool RtlTcpServerClient::readCommands()
+{
+    while (true)
+    {
+        ssize_t ret = ::recv(m_sock, (char *) m_cmdBuffer + m_cmdLen, sizeof(m_cmdBuffer) - m_cmdLen, MSG_DONTWAIT);
+        if (0 == ret)
+        {   // disconnected
+            return false;
+        }
+        else if (ret < 0)
+        {
+            return (EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno);
+        }
+
+        m_cmdLen += ret;
+        if (sizeof(m_cmdBuffer) == m_cmdLen)
+        {   // command is 1 byte command ID + 4 bytes parameter (big endian)
+            m_server->command(this, static_cast<RtlTcpCommand>(m_cmdBuffer[0]), qFromBigEndian<uint32_t>(m_cmdBuffer + 1));
+            m_cmdLen = 0;
+        }
+    }
+}
+
+RtlTcpServer::RtlTcpServer(IQSource *source, IQRing *ring, int maxClients, QObject *parent) : QThread(parent)
+{
+    m_source = source;
+    m_ring = ring;
+    m_maxClients = maxClients;
+    m_stopRequest = false;
+}
+
+RtlTcpServer::~RtlTcpServer()
+{
+    stop();
+    wait();
+    if (m_listenSock >= 0)
+    {
+        ::close(m_listenSock);
+    }
+}
+
+bool RtlTcpServer::listen(const QString &address, int port)
+{
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    struct addrinfo *result;
+    int s = getaddrinfo(address.isEmpty() ? nullptr : address.toLatin1().constData(), QString::number(port).toLatin1().constData(), &hints, &result);
+    if (s != 0)
+    {
+        qCCritical(rtlTcpServer) << "getaddrinfo error:" << gai_strerror(s);
+        return false;
+    }
+
+    for (struct addrinfo *rp = result; rp != nullptr; rp = rp->ai_next)
+    {
+        int sfd = ::socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+        if (sfd < 0)
+        {
+            continue;
+        }
+
+        int reuse = 1;
+        setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if ((0 == ::bind(sfd, rp->ai_addr, rp->ai_addrlen)) && (0 == ::listen(sfd, m_maxClients)))
+        {
+            m_listenSock = sfd;
+            break;
+        }
+        ::close(sfd);
+    }
+    freeaddrinfo(result);
+
+    if (m_listenSock < 0)
+    {
+        qCCritical(rtlTcpServer, "Unable to listen on %s:%d (%s)", address.toLatin1().constData(), port, strerror(errno));
+        return false;
+    }
+
+    qCInfo(rtlTcpServer, "Listening on %s:%d", address.toLatin1().constData(), port);
+    return true;
+}
+
+void RtlTcpServer::stop()
+{
+    m_stopRequest = true;
+}
+
+void RtlTcpServer::command(RtlTcpServerClient *client, RtlTcpCommand cmd, uint32_t param)
+{
+    QMutexLocker locker(&m_clientsMutex);
+    if (!m_clients.isEmpty() && (m_clients.first() == client))
+    {
+        m_source->command(cmd, param);
+    }
+    else
+    {
+        qCDebug(rtlTcpServer, "%s: command 0x%02X ignored, client does not control the source",
+                client->peer().toLatin1().constData(), static_cast<int>(cmd));
+    }
+}
+
+void RtlTcpServer::run()
+{
+    while (!m_stopRequest)
+    {
+        removeFinishedClients(false);
+
+        struct pollfd pfd;
+        pfd.fd = m_listenSock;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if ((::poll(&pfd, 1, 200) <= 0) || (0 == (pfd.revents & POLLIN)))
+        {   // timeout or error
+            continue;
+        }
+
+        struct sockaddr_storage addr;
+        socklen_t addrLen = sizeof(addr);
+        int sock = ::accept(m_listenSock, (struct sockaddr *) &addr, &addrLen);
+        if (sock < 0)
+        {
+            continue;
+        }
+
+        char host[NI_MAXHOST];
+        char service[NI_MAXSERV];
+        QString peer;
+        if (0 == getnameinfo((struct sockaddr *) &addr, addrLen, host, sizeof(host), service, sizeof(service), NI_NUMERICHOST | NI_NUMERICSERV))
+        {
+            peer = QString("%1:%2").arg(host, service);
+        }
+
+        QMutexLocker locker(&m_clientsMutex);
+        if (m_clients.size() >= m_maxClients)
+        {
+            qCWarning(rtlTcpServer) << "Maximum number of clients reached, refusing" << peer;
+            ::close(sock);
+            continue;
+        }
+
+        RtlTcpServerClient * client = new RtlTcpServerClient(sock, peer, this, m_ring);
+        m_clients.append(client);
+        qCInfo(rtlTcpServer, "Client %s connected%s", peer.toLatin1().constData(),
+               (m_clients.size() == 1) ? ", it controls the source" : "");
+        client->start(QThread::HighPriority);
+    }
+
+    removeFinishedClients(true);
+}
+
+void RtlTcpServer::removeFinishedClients(bool all)
+{
+    QList<RtlTcpServerClient *> finished;
+    {   // clients are deleted without lock, they can call command() until finished
+        QMutexLocker locker(&m_clientsMutex);
+        bool controllerChanged = false;
+        for (int n = m_clients.size() - 1; n >= 0; --n)
+        {
+            if (all || m_clients.at(n)->isFinished())
+            {
+                finished.append(m_clients.takeAt(n));
+                controllerChanged = (0 == n);
+            }
+        }
+        if (controllerChanged && !m_clients.isEmpty())
+        {
+            qCInfo(rtlTcpServer, "Client %s controls the source", m_clients.first()->peer().toLatin1().constData());
+        }
+    }
+
+    for (auto client : finished)
+    {
+        client->stop();
+        client->wait();
+        qCInfo(rtlTcpServer, "Client %s disconnected: %llu kB sent, %llu kB dropped", client->peer().toLatin1().constData(),
+               (unsigned long long) (client->bytesSent() / 1024), (unsigned long long) (client->bytesDropped() / 1024));
+        delete client;
+    }
+}
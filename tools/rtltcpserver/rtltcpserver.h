@@ -0,0 +1,106 @@
+/*
+ * This file is part of the AbracaDABra project
+ *
+ * MIT License
+ *
+  * Copyright (c) 2019-2023 Petr Kopecký <xkejpi (at) gmail (dot) com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTLTCPSERVER_H
+#define RTLTCPSERVER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QList>
+#include <QString>
+#include <atomic>
+#include "iqring.h"
+#include "iqsource.h"
+
+#define RTLTCPSERVER_RING_SIZE      (16*1024*1024)  // shared ring [bytes], ~4 sec at 2048 kHz
+#define RTLTCPSERVER_MAX_SEND       (1024*1024)     // maximum number of bytes per writev() call
+#define RTLTCPSERVER_WRITE_MARGIN   (1024*1024)     // maximum block written by source to ring before commit [bytes]
+#define RTLTCPSERVER_MAX_CLIENTS    (8)
+
+class RtlTcpServer;
+
+// Client connection, sends samples from shared ring and receives commands
+class RtlTcpServerClient : public QThread
+{
+    Q_OBJECT
+public:
+    explicit RtlTcpServerClient(int sock, const QString & peer, RtlTcpServer * server, IQRing * ring, QObject *parent = nullptr);
+    ~RtlTcpServerClient();
+    void stop();
+    const QString & peer() const { return m_peer; }
+    uint64_t bytesSent() const { return m_bytesSent; }
+    uint64_t bytesDropped() const { return m_bytesDropped; }
+protected:
+    void run() override;
+private:
+    int m_sock;
+    QString m_peer;
+    RtlTcpServer * m_server;
+    IQRing * m_ring;
+    std::atomic<bool> m_stopRequest;
+    uint64_t m_readPos;
+
+    uint8_t m_cmdBuffer[5];
+    int m_cmdLen = 0;
+
+    std::atomic<uint64_t> m_bytesSent;
+    std::atomic<uint64_t> m_bytesDropped;
+
+    bool sendDongleInfo();
+    bool readCommands();
+};
+
+// rtl_tcp compatible server, streams IQ source to several clients
+// first connected client controls the source, commands from other clients are ignored
+class RtlTcpServer : public QThread
+{
+    Q_OBJECT
+public:
+    explicit RtlTcpServer(IQSource * source, IQRing * ring, int maxClients = RTLTCPSERVER_MAX_CLIENTS, QObject *parent = nullptr);
+    ~RtlTcpServer();
+    bool listen(const QString & address, int port);
+    void stop();
+
+    // used by clients
+    void command(RtlTcpServerClient * client, RtlTcpCommand cmd, uint32_t param);
+    uint32_t tunerType() const { return m_source->tunerType(); }
+    uint32_t tunerGainCount() const { return m_source->tunerGainCount(); }
+protected:
+    void run() override;
+private:
+    IQSource * m_source;
+    IQRing * m_ring;
+    int m_maxClients;
+    int m_listenSock = -1;
+    std::atomic<bool> m_stopRequest;
+
+    QMutex m_clientsMutex;
+    QList<RtlTcpServerClient *> m_clients;     // in order of connection, first one is controlling the source
+
+    void removeFinishedClients(bool all);
+};
+
+#endif // RTLTCPSERVER_H